@@ -0,0 +1,141 @@
+/*
+ * ChannelStatistics.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CHANNELSTATISTICS_H_
+#define SRC_CHANNELSTATISTICS_H_
+
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * Running summary statistics of a single measurement channel.
+ * Updated with every stored value in constant time, using Welford's algorithm for the variance.
+ */
+class ChannelStatistics {
+public:
+	ChannelStatistics() {
+		reset();
+	}
+
+	/**
+	 * Removes all values from these statistics.
+	 */
+	void reset() {
+		count = 0;
+		mean = 0;
+		m2 = 0;
+		min = INFINITY;
+		max = -INFINITY;
+		min_time = 0;
+		max_time = 0;
+	}
+
+	/**
+	 * Adds a value to these statistics.
+	 *
+	 * @param value		The measured value.
+	 * @param timestamp	The time at which the value was measured, in milliseconds since the recording start.
+	 */
+	void update(const float value, const float timestamp) {
+		count++;
+		const float delta = value - mean;
+		mean += delta / count;
+		m2 += delta * (value - mean);
+
+		if (value < min) {
+			min = value;
+			min_time = timestamp;
+		}
+
+		if (value > max) {
+			max = value;
+			max_time = timestamp;
+		}
+	}
+
+	/**
+	 * Gets the number of values added to these statistics.
+	 *
+	 * @return	The number of values.
+	 */
+	uint32_t getCount() const {
+		return count;
+	}
+
+	float getMin() const {
+		return min;
+	}
+
+	/**
+	 * Gets the time of the first occurrence of the min value.
+	 *
+	 * @return	The time of the min value in milliseconds since the recording start.
+	 */
+	float getMinTime() const {
+		return min_time;
+	}
+
+	float getMax() const {
+		return max;
+	}
+
+	/**
+	 * Gets the time of the first occurrence of the max value.
+	 *
+	 * @return	The time of the max value in milliseconds since the recording start.
+	 */
+	float getMaxTime() const {
+		return max_time;
+	}
+
+	float getMean() const {
+		return mean;
+	}
+
+	/**
+	 * Gets the population variance of the values.
+	 *
+	 * @return	The variance, or 0 if there are no values.
+	 */
+	float getVariance() const {
+		return count == 0 ? 0 : m2 / count;
+	}
+
+	/**
+	 * Gets the root mean square of the values.
+	 * Calculated from the mean and variance, so it doesn't need its own sum.
+	 *
+	 * @return	The root mean square.
+	 */
+	float getRms() const {
+		return sqrtf(mean * mean + getVariance());
+	}
+
+private:
+	uint32_t count;
+	float mean;
+	float m2;
+	float min;
+	float max;
+	float min_time;
+	float max_time;
+};
+
+#endif /* SRC_CHANNELSTATISTICS_H_ */
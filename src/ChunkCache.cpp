@@ -0,0 +1,224 @@
+/*
+ * ChunkCache.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ChunkCache.h"
+#include <algorithm>
+#include <string.h>
+
+void ChunkCache::reset(char *memory, const uint16_t chunks) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->memory = memory;
+	this->chunks.assign(memory ? chunks : 0, Chunk { NULL, 0, 0, 0 });
+	unused.clear();
+	released.clear();
+	for (uint16_t i = this->chunks.size(); i > 0; i--) {
+		unused.push_back(i - 1);
+	}
+}
+
+ChunkCache::Reader* ChunkCache::open(const std::string &key,
+		const Renderer renderer, bool &created) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (chunks.empty()) {
+		return NULL;
+	}
+
+	Reader *reader = new Reader();
+	for (File *file : files) {
+		if (file->key != key
+				|| (file->rendered > 0 && getChunk(file, 0) < 0)) {
+			continue;
+		}
+
+		// Released chunks are reused in order, so if the first chunk is cached all the others are as well.
+		for (uint32_t i = 0; i < file->rendered; i++) {
+			const int32_t chunk = getChunk(file, i);
+			if (chunks[chunk].pending++ == 0) {
+				released.remove(chunk);
+				file->held++;
+			}
+		}
+
+		file->readers++;
+		reader->file = file;
+		created = false;
+		return reader;
+	}
+
+	File *file = new File(key, renderer);
+	file->readers = 1;
+	files.push_back(file);
+	reader->file = file;
+	created = true;
+	return reader;
+}
+
+size_t ChunkCache::read(Reader *reader, char *buffer, const size_t maxlen,
+		bool &done) {
+	std::lock_guard<std::mutex> lock(mutex);
+	File *file = reader->file;
+	done = false;
+	if (reader->chunk >= file->rendered) {
+		done = file->complete;
+		return 0;
+	}
+
+	const uint16_t chunk = getChunk(file, reader->chunk);
+	const size_t length = std::min(maxlen,
+			chunks[chunk].length - reader->offset);
+	memcpy(buffer, memory + chunk * CHUNK_SIZE + reader->offset, length);
+	reader->offset += length;
+	if (reader->offset == chunks[chunk].length) {
+		pass(chunk);
+		reader->chunk++;
+		reader->offset = 0;
+	}
+	return length;
+}
+
+void ChunkCache::close(Reader *reader) {
+	std::lock_guard<std::mutex> lock(mutex);
+	File *file = reader->file;
+	for (uint32_t i = reader->chunk; i < file->rendered; i++) {
+		pass(getChunk(file, i));
+	}
+
+	file->readers--;
+	if (file->readers == 0 && !file->rendering) {
+		deleteFile(file);
+	}
+	delete reader;
+}
+
+ChunkCache::RenderResult ChunkCache::render(File *file) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (file->readers == 0) {
+		file->rendering = false;
+		deleteFile(file);
+		return RENDER_DONE;
+	}
+
+	// Limit the read-ahead of a single file, so concurrent downloads of other files can't starve.
+	if (file->held >= std::max(chunks.size() / 2, (size_t) 1)) {
+		return RENDER_FULL;
+	}
+
+	uint16_t chunk;
+	if (!unused.empty()) {
+		chunk = unused.back();
+		unused.pop_back();
+	} else if (!released.empty()) {
+		chunk = released.front();
+		released.pop_front();
+	} else {
+		return RENDER_FULL;
+	}
+	chunks[chunk].file = NULL;
+	lock.unlock();
+
+	// The chunk isn't reachable by anyone else, so it can be written without holding the lock.
+	const size_t length = file->renderer(memory + chunk * CHUNK_SIZE,
+			CHUNK_SIZE);
+
+	lock.lock();
+	if (length == 0) {
+		unused.push_back(chunk);
+		file->complete = true;
+		file->rendering = false;
+		if (file->readers == 0) {
+			deleteFile(file);
+		}
+		return RENDER_DONE;
+	}
+
+	if (file->window.empty()) {
+		file->window_start = file->rendered;
+	}
+	file->window.push_back(chunk);
+	chunks[chunk] = Chunk { file, file->rendered++, length, file->readers };
+	if (file->readers > 0) {
+		file->held++;
+	} else {
+		released.push_back(chunk);
+	}
+	return RENDER_CHUNK;
+}
+
+ChunkCache::File* ChunkCache::getFile(const Reader *reader) {
+	return reader->file;
+}
+
+uint16_t ChunkCache::getUsedChunks() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	uint16_t used = 0;
+	for (const Chunk &chunk : chunks) {
+		if (chunk.file && chunk.pending > 0) {
+			used++;
+		}
+	}
+	return used;
+}
+
+size_t ChunkCache::getFiles() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return files.size();
+}
+
+int32_t ChunkCache::getChunk(File *file, const uint32_t index) {
+	// Drop the chunks at the start of the window that were reused for other data.
+	while (!file->window.empty()
+			&& (chunks[file->window.front()].file != file
+					|| chunks[file->window.front()].index != file->window_start)) {
+		file->window.pop_front();
+		file->window_start++;
+	}
+
+	if (index < file->window_start
+			|| index - file->window_start >= file->window.size()) {
+		return -1;
+	}
+
+	const uint16_t chunk = file->window[index - file->window_start];
+	if (chunks[chunk].file != file || chunks[chunk].index != index) {
+		return -1;
+	}
+	return chunk;
+}
+
+void ChunkCache::pass(const uint16_t chunk) {
+	Chunk &data = chunks[chunk];
+	if (--data.pending == 0) {
+		data.file->held--;
+		released.push_back(chunk);
+	}
+}
+
+void ChunkCache::deleteFile(File *file) {
+	for (uint16_t chunk : file->window) {
+		if (chunks[chunk].file == file) {
+			chunks[chunk].file = NULL;
+			released.remove(chunk);
+			unused.push_back(chunk);
+		}
+	}
+
+	files.remove(file);
+	delete file;
+}
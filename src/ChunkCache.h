@@ -0,0 +1,286 @@
+/*
+ * ChunkCache.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CHUNKCACHE_H_
+#define SRC_CHUNKCACHE_H_
+
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * A shared cache of rendered file chunks, so concurrent downloads of the same file only render it once.
+ *
+ * Each file is rendered in fixed size chunks by a single renderer, and every reader streams from the cached chunks at its own pace.
+ * A chunk is released once all readers of its file have passed it, but its data stays valid until the chunk is reused.
+ * Released chunks are reused in the order they were released, so a reader joining a file late can start from its cached start.
+ * All methods are thread safe.
+ */
+class ChunkCache {
+public:
+	/**
+	 * A function writing the next part of a file to the given buffer.
+	 * Gets the buffer and its size, and returns the number of bytes written, or 0 at the end of the file.
+	 */
+	typedef std::function<size_t(char*, size_t)> Renderer;
+
+	/**
+	 * A file being rendered into the cache.
+	 */
+	struct File;
+
+	/**
+	 * The state of a single reader of a file.
+	 */
+	struct Reader;
+
+	/**
+	 * The results of rendering a chunk.
+	 */
+	enum RenderResult {
+		/**
+		 * The next chunk of the file was rendered.
+		 */
+		RENDER_CHUNK,
+		/**
+		 * No chunk could be rendered, because there was no free chunk.
+		 * Try again once a reader made progress.
+		 */
+		RENDER_FULL,
+		/**
+		 * The file is completely rendered, or doesn't have any readers left.
+		 * Rendering it must not be attempted again.
+		 */
+		RENDER_DONE
+	};
+
+	/**
+	 * The size of a single chunk in bytes.
+	 */
+	static const size_t CHUNK_SIZE = 4096;
+
+	/**
+	 * Creates a new ChunkCache without any memory.
+	 */
+	ChunkCache() {
+	}
+
+	/**
+	 * Sets the memory to store the chunks in.
+	 * Must be called before any file is opened.
+	 *
+	 * @param memory	The chunk memory. Has to be at least chunks * CHUNK_SIZE bytes.
+	 * @param chunks	The number of chunks fitting into the memory.
+	 */
+	void reset(char *memory, const uint16_t chunks);
+
+	/**
+	 * Opens a reader for the file with the given key.
+	 * Joins a file with the same key that is still being read, if its first chunk is still cached.
+	 * Otherwise a new file is created, which the caller has to render using render.
+	 *
+	 * @param key		The key identifying the file content.
+	 * @param renderer	The function rendering the file, if a new one has to be created.
+	 * @param created	A reference to write whether a new file was created to.
+	 * @return	The new reader, which has to be closed using close.
+	 * 			NULL if the cache has no memory.
+	 */
+	Reader* open(const std::string &key, const Renderer renderer,
+			bool &created);
+
+	/**
+	 * Copies the next bytes of the file of a reader to the given buffer.
+	 *
+	 * @param reader	The reader to advance.
+	 * @param buffer	The buffer to write to.
+	 * @param maxlen	The max number of bytes to copy.
+	 * @param done		A reference set to true if the end of the file was reached.
+	 * @return	The number of bytes copied.
+	 * 			0 if the reader has to wait for the next chunk to be rendered, or the file ended.
+	 */
+	size_t read(Reader *reader, char *buffer, const size_t maxlen, bool &done);
+
+	/**
+	 * Closes a reader, releasing all chunks only it still needed.
+	 * The reader must not be used afterwards.
+	 *
+	 * @param reader	The reader to close.
+	 */
+	void close(Reader *reader);
+
+	/**
+	 * Renders the next chunk of a file created by open.
+	 * Called repeatedly by a single task per file, until it returns RENDER_DONE.
+	 * The file must not be used after that.
+	 *
+	 * @param file	The file to render.
+	 * @return	The result of the render attempt.
+	 */
+	RenderResult render(File *file);
+
+	/**
+	 * Gets the file a reader reads from.
+	 *
+	 * @param reader	The reader to get the file of.
+	 * @return	The file of the reader.
+	 */
+	static File* getFile(const Reader *reader);
+
+	/**
+	 * Gets the number of chunks currently holding data still needed by a reader.
+	 *
+	 * @return	The number of chunks in use.
+	 */
+	uint16_t getUsedChunks() const;
+
+	/**
+	 * Gets the total number of chunks of this cache.
+	 *
+	 * @return	The number of chunks.
+	 */
+	uint16_t getChunks() const {
+		return chunks.size();
+	}
+
+	/**
+	 * Gets the number of files currently being read.
+	 *
+	 * @return	The number of open files.
+	 */
+	size_t getFiles() const;
+
+private:
+	/**
+	 * A single chunk of cached file data.
+	 */
+	struct Chunk {
+		/**
+		 * The file this chunk belongs to, or NULL if it doesn't contain valid data.
+		 */
+		File *file;
+
+		/**
+		 * The index of this chunk in its file.
+		 */
+		uint32_t index;
+
+		/**
+		 * The number of valid bytes in this chunk.
+		 */
+		size_t length;
+
+		/**
+		 * The number of readers of the file that haven't passed this chunk yet.
+		 */
+		uint16_t pending;
+	};
+
+	char *memory = NULL;
+	std::vector<Chunk> chunks;
+
+	/**
+	 * Chunks without valid data.
+	 */
+	std::vector<uint16_t> unused;
+
+	/**
+	 * Chunks with valid data no reader needs anymore, in the order they were released.
+	 */
+	std::list<uint16_t> released;
+
+	std::list<File*> files;
+
+	mutable std::mutex mutex;
+
+	/**
+	 * Gets the chunk holding the given part of a file.
+	 *
+	 * @param file	The file to get the chunk of.
+	 * @param index	The index of the chunk in the file.
+	 * @return	The index of the chunk in this cache, or -1 if it isn't cached.
+	 */
+	int32_t getChunk(File *file, const uint32_t index);
+
+	/**
+	 * Marks a chunk as passed by one reader, releasing it if it was the last one.
+	 *
+	 * @param chunk	The index of the chunk in this cache.
+	 */
+	void pass(const uint16_t chunk);
+
+	/**
+	 * Deletes a file without readers or a renderer, invalidating its cached chunks.
+	 * The chunks are reused before other released chunks, since nobody can join the file anymore.
+	 *
+	 * @param file	The file to delete.
+	 */
+	void deleteFile(File *file);
+};
+
+struct ChunkCache::File {
+	File(const std::string &key, const Renderer renderer) :
+			key(key), renderer(renderer) {
+	}
+
+	const std::string key;
+	const Renderer renderer;
+
+	/**
+	 * The cache chunks of the parts of the file, starting with the part window_start.
+	 * Chunks that were reused for other data are removed lazily.
+	 */
+	std::deque<uint16_t> window;
+	uint32_t window_start = 0;
+
+	/**
+	 * The number of chunks rendered so far.
+	 */
+	uint32_t rendered = 0;
+
+	/**
+	 * The number of rendered chunks that are still needed by a reader.
+	 */
+	uint16_t held = 0;
+
+	uint16_t readers = 0;
+	bool complete = false;
+	bool rendering = true;
+};
+
+struct ChunkCache::Reader {
+	File *file;
+
+	/**
+	 * The index of the chunk of the file to read next.
+	 */
+	uint32_t chunk = 0;
+
+	/**
+	 * The number of bytes of the current chunk already read.
+	 */
+	size_t offset = 0;
+};
+
+#endif /* SRC_CHUNKCACHE_H_ */
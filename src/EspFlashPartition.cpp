@@ -0,0 +1,77 @@
+/*
+ * EspFlashPartition.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EspFlashPartition.h"
+
+EspFlashPartition::EspFlashPartition(const char *label) :
+		label(label) {
+}
+
+EspFlashPartition::~EspFlashPartition() {
+	unmap();
+}
+
+bool EspFlashPartition::begin() {
+	partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+			ESP_PARTITION_SUBTYPE_ANY, label);
+	return partition != NULL;
+}
+
+size_t EspFlashPartition::getSize() const {
+	return partition == NULL ? 0 : partition->size;
+}
+
+size_t EspFlashPartition::getSectorSize() const {
+	return SPI_FLASH_SEC_SIZE;
+}
+
+bool EspFlashPartition::erase(const size_t offset, const size_t length) {
+	return partition != NULL
+			&& esp_partition_erase_range(partition, offset, length) == ESP_OK;
+}
+
+bool EspFlashPartition::write(const size_t offset, const void *data,
+		const size_t length) {
+	return partition != NULL
+			&& esp_partition_write(partition, offset, data, length) == ESP_OK;
+}
+
+bool EspFlashPartition::read(const size_t offset, void *data,
+		const size_t length) const {
+	return partition != NULL
+			&& esp_partition_read(partition, offset, data, length) == ESP_OK;
+}
+
+const void* EspFlashPartition::map() {
+	if (mapped == NULL && partition != NULL
+			&& esp_partition_mmap(partition, 0, partition->size,
+					SPI_FLASH_MMAP_DATA, &mapped, &mmap_handle) != ESP_OK) {
+		mapped = NULL;
+	}
+
+	return mapped;
+}
+
+void EspFlashPartition::unmap() {
+	if (mapped != NULL) {
+		spi_flash_munmap(mmap_handle);
+		mapped = NULL;
+	}
+}
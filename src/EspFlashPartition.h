@@ -0,0 +1,62 @@
+/*
+ * EspFlashPartition.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_ESPFLASHPARTITION_H_
+#define SRC_ESPFLASHPARTITION_H_
+
+#include "FlashPartition.h"
+#include <esp_partition.h>
+
+/**
+ * A FlashPartition backed by a data partition of the ESP32 partition table.
+ */
+class EspFlashPartition: public FlashPartition {
+public:
+	/**
+	 * Creates a new EspFlashPartition for the data partition with the given label.
+	 *
+	 * @param label	The name of the partition in the partition table.
+	 */
+	EspFlashPartition(const char *label);
+	virtual ~EspFlashPartition();
+
+	/**
+	 * Looks up the partition in the partition table.
+	 *
+	 * @return	True if the partition exists.
+	 */
+	bool begin();
+
+	size_t getSize() const;
+	size_t getSectorSize() const;
+	bool erase(const size_t offset, const size_t length);
+	bool write(const size_t offset, const void *data, const size_t length);
+	bool read(const size_t offset, void *data, const size_t length) const;
+	const void* map();
+	void unmap();
+
+private:
+	const char *label;
+	const esp_partition_t *partition = NULL;
+	const void *mapped = NULL;
+	spi_flash_mmap_handle_t mmap_handle = 0;
+};
+
+#endif /* SRC_ESPFLASHPARTITION_H_ */
@@ -0,0 +1,78 @@
+/*
+ * EventIndex.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EventIndex.h"
+
+void EventIndex::reset(float *memory, const uint32_t capacity,
+		const EventSettings &settings) {
+	events = (SensorEvent*) memory;
+	EventIndex::capacity = memory == NULL ? 0 : capacity;
+	EventIndex::settings = settings;
+	dropped = 0;
+	for (uint8_t sensor = 0; sensor < SENSORS; sensor++) {
+		active[sensor] = UINT32_MAX;
+	}
+	count.store(0, std::memory_order_release);
+}
+
+void EventIndex::update(const uint8_t sensor, const uint32_t index,
+		const float timestamp, const float magnitude) {
+	if (sensor >= SENSORS || settings.thresholds[sensor] <= 0) {
+		return;
+	}
+
+	const float threshold = settings.thresholds[sensor];
+	uint32_t &event = active[sensor];
+	if (event == UINT32_MAX) {
+		if (magnitude < threshold) {
+			return;
+		}
+
+		const uint32_t stored = count.load(std::memory_order_relaxed);
+		if (stored >= capacity) {
+			// Dropped events are still tracked, so their end isn't detected as a new event.
+			dropped++;
+			event = capacity;
+			return;
+		}
+
+		events[stored] = { index, timestamp, magnitude, 1, sensor, 0 };
+		count.store(stored + 1, std::memory_order_release);
+		event = stored;
+		return;
+	}
+
+	if (magnitude < threshold * (1 - settings.hysteresis)) {
+		event = UINT32_MAX;
+		return;
+	} else if (event == capacity) {
+		return;
+	}
+
+	SensorEvent &current = events[event];
+	if (current.samples < UINT16_MAX) {
+		current.samples++;
+	}
+	if (magnitude > current.peak) {
+		current.index = index;
+		current.timestamp = timestamp;
+		current.peak = magnitude;
+	}
+}
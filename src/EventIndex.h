@@ -0,0 +1,192 @@
+/*
+ * EventIndex.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_EVENTINDEX_H_
+#define SRC_EVENTINDEX_H_
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A detected event, like an impact or a shock, of a single sensor.
+ */
+struct SensorEvent {
+	/**
+	 * The index of the sample with the peak magnitude, in the stream of the sensor.
+	 */
+	uint32_t index;
+
+	/**
+	 * The timestamp of the peak, in milliseconds since the start of the recording.
+	 */
+	float timestamp;
+
+	/**
+	 * The peak magnitude of the event.
+	 */
+	float peak;
+
+	/**
+	 * The number of samples the magnitude stayed above the release level, saturating at UINT16_MAX.
+	 */
+	uint16_t samples;
+
+	/**
+	 * The index of the sensor, 0 for the accelerometer, 1 for the gyroscope, and 2 for the magnetometer.
+	 */
+	uint8_t sensor;
+
+	uint8_t reserved;
+};
+
+/**
+ * The thresholds of the event detection of a recording.
+ */
+struct EventSettings {
+	/**
+	 * The magnitude starting an event, for each sensor. 0 disables the detection for that sensor.
+	 */
+	float thresholds[3];
+
+	/**
+	 * The fraction of the threshold the magnitude has to fall by to end an event.
+	 * Keeps a noisy signal hovering around the threshold from creating many events.
+	 */
+	float hysteresis;
+};
+
+/**
+ * Detects threshold crossings of sensor magnitudes while recording, and stores them in a compact fixed size index.
+ * An event starts when the magnitude of a sensor exceeds its threshold,
+ * and ends when it falls below the threshold reduced by the hysteresis.
+ * Each event is stored once it starts, and its peak is updated until it ends.
+ *
+ * Events are added by a single task, and can be read by any number of others at the same time.
+ */
+class EventIndex {
+public:
+	/**
+	 * The number of sensors with their own detector.
+	 */
+	static const uint8_t SENSORS = 3;
+
+	/**
+	 * Creates a new EventIndex without any storage.
+	 */
+	EventIndex() {
+	}
+
+	EventIndex(const EventIndex &other) = delete;
+	EventIndex& operator=(const EventIndex &other) = delete;
+
+	/**
+	 * Calculates the number of floats required for an index.
+	 *
+	 * @param capacity	The max number of events.
+	 * @return	The number of floats to reserve for the index.
+	 */
+	static size_t getSize(const uint32_t capacity) {
+		return capacity * sizeof(SensorEvent) / sizeof(float);
+	}
+
+	/**
+	 * Removes all events from this index, and sets its thresholds.
+	 *
+	 * @param memory	A pointer to getSize(capacity) floats to use as storage.
+	 * 					NULL to disable this index.
+	 * @param capacity	The max number of events.
+	 * @param settings	The thresholds to detect events with.
+	 */
+	void reset(float *memory, const uint32_t capacity,
+			const EventSettings &settings);
+
+	/**
+	 * Updates the detector of a sensor with a new sample. May only be called by a single task.
+	 *
+	 * @param sensor	The index of the sensor the magnitude is of.
+	 * @param index		The index of the sample in the stream of the sensor.
+	 * @param timestamp	The timestamp of the sample in milliseconds.
+	 * @param magnitude	The magnitude of the sample.
+	 */
+	void update(const uint8_t sensor, const uint32_t index,
+			const float timestamp, const float magnitude);
+
+	/**
+	 * Gets the number of events stored so far.
+	 *
+	 * @return	The number of events.
+	 */
+	uint32_t getCount() const {
+		return count.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Gets the max number of events this index can store.
+	 *
+	 * @return	The capacity of this index.
+	 */
+	uint32_t getCapacity() const {
+		return capacity;
+	}
+
+	/**
+	 * Gets the number of events that didn't fit into this index anymore.
+	 *
+	 * @return	The number of dropped events.
+	 */
+	uint32_t getDropped() const {
+		return dropped;
+	}
+
+	/**
+	 * Gets the thresholds this index detects events with.
+	 *
+	 * @return	The settings passed to reset.
+	 */
+	const EventSettings& getSettings() const {
+		return settings;
+	}
+
+	/**
+	 * Gets a stored event. The peak of the last events may still change, if they didn't end yet.
+	 *
+	 * @param event	The index of the event, in the order they were detected in.
+	 * @return	The event.
+	 */
+	SensorEvent getEvent(const uint32_t event) const {
+		return events[event];
+	}
+
+private:
+	SensorEvent *events = NULL;
+	uint32_t capacity = 0;
+	std::atomic<uint32_t> count { 0 };
+	volatile uint32_t dropped = 0;
+	EventSettings settings = { };
+
+	/**
+	 * The index of the event in progress for each sensor, or UINT32_MAX if there is none.
+	 * The index is capacity for events that were dropped.
+	 */
+	uint32_t active[SENSORS] = { UINT32_MAX, UINT32_MAX, UINT32_MAX };
+};
+
+#endif /* SRC_EVENTINDEX_H_ */
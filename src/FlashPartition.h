@@ -0,0 +1,96 @@
+/*
+ * FlashPartition.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_FLASHPARTITION_H_
+#define SRC_FLASHPARTITION_H_
+
+#include <stddef.h>
+
+/**
+ * A flash partition that can be erased, written, read, and memory mapped.
+ * Abstracted so code using it can be tested against a partition image file.
+ */
+class FlashPartition {
+public:
+	virtual ~FlashPartition() {
+	}
+
+	/**
+	 * Gets the size of this partition.
+	 *
+	 * @return	The size in bytes, or 0 if this partition isn't available.
+	 */
+	virtual size_t getSize() const = 0;
+
+	/**
+	 * Gets the size of the smallest area that can be erased.
+	 * Erase offsets and lengths have to be multiples of this.
+	 *
+	 * @return	The erase sector size in bytes.
+	 */
+	virtual size_t getSectorSize() const = 0;
+
+	/**
+	 * Erases a range of this partition, setting all its bits.
+	 *
+	 * @param offset	The offset of the first byte to erase. A multiple of the sector size.
+	 * @param length	The number of bytes to erase. A multiple of the sector size.
+	 * @return	True if erasing succeeded.
+	 */
+	virtual bool erase(const size_t offset, const size_t length) = 0;
+
+	/**
+	 * Writes data to an erased range of this partition.
+	 *
+	 * @param offset	The offset to write the data to.
+	 * @param data		The data to write.
+	 * @param length	The number of bytes to write.
+	 * @return	True if writing succeeded.
+	 */
+	virtual bool write(const size_t offset, const void *data,
+			const size_t length) = 0;
+
+	/**
+	 * Reads data from this partition.
+	 *
+	 * @param offset	The offset to read from.
+	 * @param data		The buffer to read the data into.
+	 * @param length	The number of bytes to read.
+	 * @return	True if reading succeeded.
+	 */
+	virtual bool read(const size_t offset, void *data,
+			const size_t length) const = 0;
+
+	/**
+	 * Maps the whole partition into the address space, so it can be read without copying it.
+	 * Calling this again while the partition is mapped returns the existing mapping.
+	 *
+	 * @return	A pointer to the first byte of the partition, or NULL if mapping failed.
+	 */
+	virtual const void* map() = 0;
+
+	/**
+	 * Removes the mapping created by map.
+	 * Pointers returned by map may not be used afterwards.
+	 */
+	virtual void unmap() = 0;
+};
+
+#endif /* SRC_FLASHPARTITION_H_ */
@@ -0,0 +1,76 @@
+/*
+ * FrameBacklog.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameBacklog.h"
+#include <algorithm>
+#include <string.h>
+
+void FrameBacklog::reset(uint8_t *memory, const size_t size) {
+	FrameBacklog::memory = memory;
+	FrameBacklog::size = memory == NULL ? 0 : size;
+	head = 0;
+	tail = 0;
+	used.store(0, std::memory_order_release);
+	high_water.store(0, std::memory_order_relaxed);
+}
+
+bool FrameBacklog::push(const uint8_t *data, const size_t length) {
+	const size_t used = this->used.load(std::memory_order_acquire);
+	if (length > size - used) {
+		return false;
+	}
+
+	// The data may wrap around the end of the memory.
+	const size_t first = std::min(length, size - head);
+	memcpy(memory + head, data, first);
+	memcpy(memory, data + first, length - first);
+	head = (head + length) % size;
+
+	const size_t now_used = this->used.fetch_add(length,
+			std::memory_order_acq_rel) + length;
+	if (now_used > high_water.load(std::memory_order_relaxed)) {
+		high_water.store(now_used, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+size_t FrameBacklog::copy(const size_t offset, uint8_t *buffer,
+		const size_t length) const {
+	const size_t used = this->used.load(std::memory_order_acquire);
+	if (offset >= used) {
+		return 0;
+	}
+
+	const size_t copied = std::min(length, used - offset);
+	const size_t start = (tail + offset) % size;
+	const size_t first = std::min(copied, size - start);
+	memcpy(buffer, memory + start, first);
+	memcpy(buffer + first, memory, copied - first);
+	return copied;
+}
+
+void FrameBacklog::consume(const size_t length) {
+	if (length == 0) {
+		return;
+	}
+
+	tail = (tail + length) % size;
+	used.fetch_sub(length, std::memory_order_acq_rel);
+}
@@ -0,0 +1,126 @@
+/*
+ * FrameBacklog.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_FRAMEBACKLOG_H_
+#define SRC_FRAMEBACKLOG_H_
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A byte ring buffer passing stream frames from exactly one producer to exactly one consumer.
+ * Used to absorb network stalls while streaming, so its memory is a large region in PSRAM.
+ *
+ * Frames are pushed whole or not at all, and the consumer copies them out before consuming them.
+ * So a frame whose sending failed can be sent again.
+ */
+class FrameBacklog {
+public:
+	/**
+	 * Creates a new FrameBacklog without any memory.
+	 */
+	FrameBacklog() {
+	}
+
+	FrameBacklog(const FrameBacklog &other) = delete;
+	FrameBacklog& operator=(const FrameBacklog &other) = delete;
+
+	/**
+	 * Sets the memory of this backlog, and removes all data from it.
+	 * Must not be called while the producer or the consumer are using it.
+	 *
+	 * @param memory	The memory to store the data in. NULL to disable the backlog.
+	 * @param size		The size of the memory in bytes.
+	 */
+	void reset(uint8_t *memory, const size_t size);
+
+	/**
+	 * Appends data to the end of this backlog. May only be called by the producer.
+	 *
+	 * @param data		The data to append.
+	 * @param length	The number of bytes to append.
+	 * @return	False if there wasn't enough free space, in which case nothing was appended.
+	 */
+	bool push(const uint8_t *data, const size_t length);
+
+	/**
+	 * Copies data from the start of this backlog, without removing it. May only be called by the consumer.
+	 *
+	 * @param offset	The number of bytes from the start of the backlog to skip.
+	 * @param buffer	The buffer to copy the data to.
+	 * @param length	The max number of bytes to copy.
+	 * @return	The number of bytes copied.
+	 */
+	size_t copy(const size_t offset, uint8_t *buffer, const size_t length) const;
+
+	/**
+	 * Removes data from the start of this backlog. May only be called by the consumer.
+	 *
+	 * @param length	The number of bytes to remove. At most getUsed().
+	 */
+	void consume(const size_t length);
+
+	/**
+	 * Gets the number of bytes currently in this backlog.
+	 *
+	 * @return	The number of used bytes.
+	 */
+	size_t getUsed() const {
+		return used.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Gets the max number of bytes that were in this backlog at the same time since the last reset.
+	 *
+	 * @return	The high-water mark in bytes.
+	 */
+	size_t getHighWater() const {
+		return high_water.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Gets the size of the memory of this backlog.
+	 *
+	 * @return	The capacity in bytes.
+	 */
+	size_t getSize() const {
+		return size;
+	}
+
+private:
+	uint8_t *memory = NULL;
+	size_t size = 0;
+
+	/**
+	 * The offset the next byte is written to. Only used by the producer.
+	 */
+	size_t head = 0;
+
+	/**
+	 * The offset of the first byte in the backlog. Only used by the consumer.
+	 */
+	size_t tail = 0;
+
+	std::atomic<size_t> used { 0 };
+	std::atomic<size_t> high_water { 0 };
+};
+
+#endif /* SRC_FRAMEBACKLOG_H_ */
@@ -0,0 +1,165 @@
+/*
+ * HimemRegion.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HimemRegion.h"
+#include <math.h>
+
+#if CONFIG_SPIRAM_BANKSWITCH_ENABLE
+static const size_t BANK_FLOATS = ESP_HIMEM_BLKSZ / sizeof(float);
+#else
+static const size_t BANK_FLOATS = 0x8000 / sizeof(float);
+#endif
+
+/**
+ * The bank of a window that doesn't have a bank mapped.
+ */
+static const size_t NO_BANK = (size_t) -1;
+
+HimemRegion::~HimemRegion() {
+#if CONFIG_SPIRAM_BANKSWITCH_ENABLE
+	for (uint8_t i = 0; i < window_count; i++) {
+		if (windows[i].data != NULL) {
+			esp_himem_unmap(range, windows[i].data, ESP_HIMEM_BLKSZ);
+		}
+	}
+
+	if (memory != NULL) {
+		esp_himem_free(memory);
+	}
+
+	if (range != NULL) {
+		esp_himem_free_map_range(range);
+	}
+#endif
+}
+
+size_t HimemRegion::begin() {
+	std::lock_guard<std::mutex> lock(mutex);
+#if CONFIG_SPIRAM_BANKSWITCH_ENABLE
+	if (size > 0) {
+		return size;
+	}
+
+	const size_t bytes = esp_himem_get_free_size() / ESP_HIMEM_BLKSZ
+			* ESP_HIMEM_BLKSZ;
+	if (bytes == 0) {
+		return 0;
+	}
+
+	// The reserved address space may be smaller than the default number of windows.
+	for (window_count = WINDOWS; window_count > 0; window_count--) {
+		if (esp_himem_alloc_map_range(window_count * ESP_HIMEM_BLKSZ, &range)
+				== ESP_OK) {
+			break;
+		}
+	}
+
+	if (window_count == 0) {
+		range = NULL;
+		return 0;
+	}
+
+	if (esp_himem_alloc(bytes, &memory) != ESP_OK) {
+		memory = NULL;
+		esp_himem_free_map_range(range);
+		range = NULL;
+		window_count = 0;
+		return 0;
+	}
+
+	for (uint8_t i = 0; i < window_count; i++) {
+		windows[i] = { NO_BANK, NULL, 0 };
+	}
+	size = bytes / sizeof(float);
+#endif
+	return size;
+}
+
+void HimemRegion::read(size_t offset, const size_t count, const size_t step,
+		float *values) {
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t bank = NO_BANK;
+	const float *window = NULL;
+	for (size_t i = 0; i < count; i++, offset += step) {
+		if (offset / BANK_FLOATS != bank) {
+			bank = offset / BANK_FLOATS;
+			window = map(bank);
+		}
+
+		values[i] = window == NULL ? NAN : window[offset % BANK_FLOATS];
+	}
+}
+
+void HimemRegion::write(size_t offset, const size_t count, const size_t step,
+		const float *values) {
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t bank = NO_BANK;
+	float *window = NULL;
+	for (size_t i = 0; i < count; i++, offset += step) {
+		if (offset / BANK_FLOATS != bank) {
+			bank = offset / BANK_FLOATS;
+			window = map(bank);
+		}
+
+		if (window != NULL) {
+			window[offset % BANK_FLOATS] = values[i];
+		}
+	}
+}
+
+float* HimemRegion::map(const size_t bank) {
+	if (window_count == 0 || bank >= (size + BANK_FLOATS - 1) / BANK_FLOATS) {
+		return NULL;
+	}
+
+	Window *least_used = windows;
+	for (uint8_t i = 0; i < window_count; i++) {
+		if (windows[i].bank == bank) {
+			windows[i].last_use = ++uses;
+			return windows[i].data;
+		} else if (windows[i].last_use < least_used->last_use) {
+			least_used = windows + i;
+		}
+	}
+
+#if CONFIG_SPIRAM_BANKSWITCH_ENABLE
+	if (least_used->data != NULL) {
+		esp_himem_unmap(range, least_used->data, ESP_HIMEM_BLKSZ);
+		least_used->data = NULL;
+	}
+
+	void *data;
+	if (esp_himem_map(memory, range, bank * ESP_HIMEM_BLKSZ,
+			(least_used - windows) * ESP_HIMEM_BLKSZ, ESP_HIMEM_BLKSZ, 0, &data)
+			!= ESP_OK) {
+		least_used->bank = NO_BANK;
+		least_used->last_use = 0;
+		return NULL;
+	}
+
+	least_used->bank = bank;
+	least_used->data = (float*) data;
+	least_used->last_use = ++uses;
+	maps++;
+	return least_used->data;
+#else
+	return NULL;
+#endif
+}
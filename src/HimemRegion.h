@@ -0,0 +1,116 @@
+/*
+ * HimemRegion.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_HIMEMREGION_H_
+#define SRC_HIMEMREGION_H_
+
+#include "PagedMemory.h"
+#include <mutex>
+#include <sdkconfig.h>
+#include <stdint.h>
+#if CONFIG_SPIRAM_BANKSWITCH_ENABLE
+#include <esp32/himem.h>
+#endif
+
+/**
+ * The PSRAM of 8 MB modules beyond the 4 MB the ESP32 can map directly, accessed using the himem API.
+ *
+ * The memory is split into banks of 32 KiB, a few of which are mapped into windows at a time.
+ * Values are copied through the window of their bank, which is mapped in place of the least recently used one if necessary.
+ * Since samples are mostly written and exported sequentially, almost all accesses hit an already mapped window.
+ *
+ * Without himem support in the sdkconfig, or on modules without more than 4 MB of PSRAM, this region is empty.
+ */
+class HimemRegion: public PagedMemory {
+public:
+	/**
+	 * The max number of banks mapped at the same time.
+	 */
+	static const uint8_t WINDOWS = 4;
+
+	/**
+	 * Creates a new HimemRegion without any memory.
+	 */
+	HimemRegion() {
+	}
+
+	HimemRegion(const HimemRegion &other) = delete;
+	HimemRegion& operator=(const HimemRegion &other) = delete;
+
+	~HimemRegion();
+
+	/**
+	 * Allocates all the free himem, and reserves the address space for the windows.
+	 *
+	 * @return	The number of floats in this region. 0 if there is no himem.
+	 */
+	size_t begin();
+
+	void read(const size_t offset, const size_t count, const size_t step,
+			float *values) override;
+
+	void write(const size_t offset, const size_t count, const size_t step,
+			const float *values) override;
+
+	size_t getSize() const override {
+		return size;
+	}
+
+	/**
+	 * Gets the number of times a bank had to be mapped, as an indicator of how well the windows are used.
+	 *
+	 * @return	The number of bank switches since boot.
+	 */
+	uint32_t getMaps() const {
+		return maps;
+	}
+
+private:
+	/**
+	 * A part of the address space a bank can be mapped into.
+	 */
+	struct Window {
+		size_t bank;
+		float *data;
+		uint32_t last_use;
+	};
+
+	/**
+	 * Gets the window a bank is mapped into, and maps it if it isn't mapped yet.
+	 * Must only be called while holding the mutex.
+	 *
+	 * @param bank	The index of the bank to map.
+	 * @return	A pointer to the first float of the bank, or NULL if it couldn't be mapped.
+	 */
+	float* map(const size_t bank);
+
+#if CONFIG_SPIRAM_BANKSWITCH_ENABLE
+	esp_himem_handle_t memory = NULL;
+	esp_himem_rangehandle_t range = NULL;
+#endif
+	size_t size = 0;
+	Window windows[WINDOWS];
+	uint8_t window_count = 0;
+	uint32_t uses = 0;
+	volatile uint32_t maps = 0;
+	std::mutex mutex;
+};
+
+#endif /* SRC_HIMEMREGION_H_ */
@@ -0,0 +1,139 @@
+/*
+ * LSM9DS1Driver.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LSM9DS1Driver.h"
+#ifdef LSM9DS1_I2C
+#include <Wire.h>
+#elif defined(LSM9DS1_SPI)
+#include <SPI.h>
+#endif
+
+LSM9DS1Driver::LSM9DS1Driver(const uint8_t sensor) :
+		sensor(sensor) {
+}
+
+bool LSM9DS1Driver::begin() {
+#ifdef LSM9DS1_I2C
+	// The other sensors would respond on the same addresses.
+	if (sensor > 0) {
+		return false;
+	}
+
+	Wire.begin();
+	Wire.setClock(400000);
+#elif defined(LSM9DS1_SPI)
+	pinMode(LSM9DS1_XGCS[sensor], OUTPUT);
+	digitalWrite(LSM9DS1_XGCS[sensor], HIGH);
+	pinMode(LSM9DS1_MCS[sensor], OUTPUT);
+	digitalWrite(LSM9DS1_MCS[sensor], HIGH);
+	SPI.begin(LSM9DS1_SCK, LSM9DS1_MISO, LSM9DS1_MOSI);
+#endif
+
+	// Software reset both devices, keeping the register address auto increment enabled.
+	write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG8, 0b00000101);
+	write8(LSM9DS1_MAG, LSM9DS1_REGISTER_CTRL_REG2_M, 0b00001100);
+	delay(10);
+
+	if (read8(LSM9DS1_XG, LSM9DS1_REGISTER_WHO_AM_I_XG) != 0b01101000
+			|| read8(LSM9DS1_MAG, LSM9DS1_REGISTER_WHO_AM_I_M) != 0b00111101) {
+		return false;
+	}
+
+	// Block data updates, and auto increment the register address.
+	write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG8, 0b01000100);
+
+	// Enable all accelerometer axes, and run both sensors at 952Hz until the data rate is set.
+	// The full scale bits of 0 select ±245 dps and ±2 g.
+	write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG5_XL, 0b00111000);
+	write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG1_G, 0b11000000);
+	write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG6_XL, 0b11000000);
+
+	// ±4 gauss, continuous conversion, and block data updates for the magnetometer.
+	write8(LSM9DS1_MAG, LSM9DS1_REGISTER_CTRL_REG2_M, 0);
+	write8(LSM9DS1_MAG, LSM9DS1_REGISTER_CTRL_REG3_M, 0);
+	write8(LSM9DS1_MAG, LSM9DS1_REGISTER_CTRL_REG5_M, 0b01000000);
+	return true;
+}
+
+uint8_t LSM9DS1Driver::read8(const LSM9DS1Device device, const uint8_t reg) {
+	uint8_t value;
+	readBuffer(device, reg, &value, 1);
+	return value;
+}
+
+void LSM9DS1Driver::write8(const LSM9DS1Device device, const uint8_t reg,
+		const uint8_t value) {
+#ifdef LSM9DS1_I2C
+	Wire.beginTransmission(
+			device == LSM9DS1_XG ? LSM9DS1_ADDRESS_XG : LSM9DS1_ADDRESS_MAG);
+	Wire.write(reg);
+	Wire.write(value);
+	Wire.endTransmission();
+#elif defined(LSM9DS1_SPI)
+	const uint8_t cs =
+			device == LSM9DS1_XG ? LSM9DS1_XGCS[sensor] : LSM9DS1_MCS[sensor];
+	SPI.beginTransaction(SPISettings(LSM9DS1_SPI_CLOCK, MSBFIRST, SPI_MODE3));
+	digitalWrite(cs, LOW);
+	SPI.transfer(reg & 0b01111111);
+	SPI.transfer(value);
+	digitalWrite(cs, HIGH);
+	SPI.endTransaction();
+#endif
+}
+
+void LSM9DS1Driver::readBuffer(const LSM9DS1Device device, const uint8_t reg,
+		uint8_t *buffer, const uint8_t length) {
+#ifdef LSM9DS1_I2C
+	// The magnetometer only increments the register address if the MSB of the sub address is set.
+	const uint8_t address =
+			device == LSM9DS1_XG ? LSM9DS1_ADDRESS_XG : LSM9DS1_ADDRESS_MAG;
+	Wire.beginTransmission(address);
+	Wire.write(device == LSM9DS1_MAG && length > 1 ? reg | 0b10000000 : reg);
+	Wire.endTransmission(false);
+	Wire.requestFrom(address, length);
+	for (uint8_t i = 0; i < length; i++) {
+		buffer[i] = Wire.read();
+	}
+#elif defined(LSM9DS1_SPI)
+	// The MSB selects a read, and the magnetometer increments the address only if bit 6 is set.
+	const uint8_t cs =
+			device == LSM9DS1_XG ? LSM9DS1_XGCS[sensor] : LSM9DS1_MCS[sensor];
+	uint8_t command = 0b10000000 | reg;
+	if (device == LSM9DS1_MAG && length > 1) {
+		command |= 0b01000000;
+	}
+
+	SPI.beginTransaction(SPISettings(LSM9DS1_SPI_CLOCK, MSBFIRST, SPI_MODE3));
+	digitalWrite(cs, LOW);
+	SPI.transfer(command);
+	SPI.transfer(buffer, length);
+	digitalWrite(cs, HIGH);
+	SPI.endTransaction();
+#endif
+}
+
+void LSM9DS1Driver::readAxes(const LSM9DS1Device device, const uint8_t reg,
+		int16_t *values) {
+	uint8_t buffer[6];
+	readBuffer(device, reg, buffer, 6);
+	for (uint8_t i = 0; i < 3; i++) {
+		values[i] = (int16_t) (buffer[i * 2] | (buffer[i * 2 + 1] << 8));
+	}
+}
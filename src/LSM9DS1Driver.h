@@ -0,0 +1,186 @@
+/*
+ * LSM9DS1Driver.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_LSM9DS1DRIVER_H_
+#define SRC_LSM9DS1DRIVER_H_
+
+#include "SensorSource.h"
+#include <Arduino.h>
+
+//#define LSM9DS1_I2C // uncomment to use I2C to connect to the lsm9ds1, which only supports a single sensor
+
+#ifndef LSM9DS1_I2C
+#define LSM9DS1_SPI
+#else
+#undef LSM9DS1_SPI
+#endif
+
+#define LSM9DS1_DRDY // comment out if the INT1 pin of the lsm9ds1 isn't connected
+
+// The pins of the shared SPI bus. With I2C, 22 is SCL and 21 SDA.
+const uint8_t LSM9DS1_SCK = 22;
+const uint8_t LSM9DS1_MISO = 32;
+const uint8_t LSM9DS1_MOSI = 21;
+
+// The chip select pins of the accelerometer/gyroscope and the magnetometer of each sensor on the shared SPI bus.
+const uint8_t LSM9DS1_XGCS[MAX_SENSORS] = { 27, 25, 13 };
+const uint8_t LSM9DS1_MCS[MAX_SENSORS] = { 26, 14, 15 };
+
+// The data ready pin of the first sensor, which paces the others.
+const uint8_t LSM9DS1_INT1 = 33;
+
+// The I2C addresses of the accelerometer/gyroscope and the magnetometer.
+const uint8_t LSM9DS1_ADDRESS_XG = 0x6B;
+const uint8_t LSM9DS1_ADDRESS_MAG = 0x1E;
+
+// The max SPI clock of the LSM9DS1.
+const uint32_t LSM9DS1_SPI_CLOCK = 10000000;
+
+// Accelerometer and gyroscope registers of the LSM9DS1.
+const uint8_t LSM9DS1_REGISTER_INT1_CTRL = 0x0C;
+const uint8_t LSM9DS1_REGISTER_WHO_AM_I_XG = 0x0F;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG1_G = 0x10;
+const uint8_t LSM9DS1_REGISTER_OUT_X_L_G = 0x18;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG5_XL = 0x1F;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG6_XL = 0x20;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG8 = 0x22;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG9 = 0x23;
+const uint8_t LSM9DS1_REGISTER_OUT_X_L_XL = 0x28;
+const uint8_t LSM9DS1_REGISTER_FIFO_CTRL = 0x2E;
+const uint8_t LSM9DS1_REGISTER_FIFO_SRC = 0x2F;
+
+// Magnetometer registers of the LSM9DS1.
+const uint8_t LSM9DS1_REGISTER_WHO_AM_I_M = 0x0F;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG1_M = 0x20;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG2_M = 0x21;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG3_M = 0x22;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG4_M = 0x23;
+const uint8_t LSM9DS1_REGISTER_CTRL_REG5_M = 0x24;
+const uint8_t LSM9DS1_REGISTER_OUT_X_L_M = 0x28;
+
+// The sensitivities at the ranges set by LSM9DS1Driver::begin, ±2 g, ±245 dps, and ±4 gauss.
+const float LSM9DS1_ACCEL_MG_LSB = 0.061;
+const float LSM9DS1_GYRO_DPS_DIGIT = 0.00875;
+const float LSM9DS1_MAG_MGAUSS = 0.14;
+
+/**
+ * The two devices of the LSM9DS1, which have separate addresses and chip selects.
+ */
+enum LSM9DS1Device {
+	LSM9DS1_XG, LSM9DS1_MAG
+};
+
+/**
+ * A minimal driver for one LSM9DS1, using the hardware SPI peripheral or Wire.
+ * Each output register block is read in a single auto incrementing transaction.
+ * The values are returned as raw register values, converting them is left to the consumer.
+ */
+class LSM9DS1Driver {
+public:
+	/**
+	 * Creates a new driver for one of the sensors on the SPI bus.
+	 *
+	 * @param sensor	The index of the sensor, selecting its chip select pins.
+	 */
+	LSM9DS1Driver(const uint8_t sensor);
+
+	/**
+	 * Resets the LSM9DS1, checks its identification registers, and sets up its ranges.
+	 * Enables block data updates, so the bytes of a value are always from the same conversion.
+	 *
+	 * @return	False if the LSM9DS1 didn't respond.
+	 */
+	bool begin();
+
+	/**
+	 * Reads a single register.
+	 *
+	 * @param device	The device to read the register of.
+	 * @param reg		The address of the register.
+	 * @return	The value of the register.
+	 */
+	uint8_t read8(const LSM9DS1Device device, const uint8_t reg);
+
+	/**
+	 * Writes a single register.
+	 *
+	 * @param device	The device to write the register of.
+	 * @param reg		The address of the register.
+	 * @param value		The value to write.
+	 */
+	void write8(const LSM9DS1Device device, const uint8_t reg,
+			const uint8_t value);
+
+	/**
+	 * Reads the three axes of the gyroscope, OUT_X_L_G to OUT_Z_H_G.
+	 *
+	 * @param gyro	The array to write the raw values to.
+	 */
+	void readGyro(int16_t *gyro) {
+		readAxes(LSM9DS1_XG, LSM9DS1_REGISTER_OUT_X_L_G, gyro);
+	}
+
+	/**
+	 * Reads the three axes of the accelerometer, OUT_X_L_XL to OUT_Z_H_XL.
+	 *
+	 * @param accel	The array to write the raw values to.
+	 */
+	void readAccel(int16_t *accel) {
+		readAxes(LSM9DS1_XG, LSM9DS1_REGISTER_OUT_X_L_XL, accel);
+	}
+
+	/**
+	 * Reads the three axes of the magnetometer, OUT_X_L_M to OUT_Z_H_M.
+	 *
+	 * @param mag	The array to write the raw values to.
+	 */
+	void readMag(int16_t *mag) {
+		readAxes(LSM9DS1_MAG, LSM9DS1_REGISTER_OUT_X_L_M, mag);
+	}
+
+private:
+	/**
+	 * The index of this sensor on the SPI bus.
+	 */
+	const uint8_t sensor;
+
+	/**
+	 * Reads consecutive registers in a single transaction.
+	 *
+	 * @param device	The device to read the registers of.
+	 * @param reg		The address of the first register.
+	 * @param buffer	The buffer to write the register values to.
+	 * @param length	The number of registers to read.
+	 */
+	void readBuffer(const LSM9DS1Device device, const uint8_t reg,
+			uint8_t *buffer, const uint8_t length);
+
+	/**
+	 * Reads the little endian values of the three axes of a sensor.
+	 *
+	 * @param device	The device to read the values from.
+	 * @param reg		The address of the low byte of the x axis.
+	 * @param values	The array to write the three values to.
+	 */
+	void readAxes(const LSM9DS1Device device, const uint8_t reg,
+			int16_t *values);
+};
+
+#endif /* SRC_LSM9DS1DRIVER_H_ */
@@ -21,376 +21,2814 @@
 #include "LSM9DS1Handler.h"
 #include "WebserverHandler.h"
 #include <sstream>
+#include "LowPassFilter.h"
+#include "Spectrum.h"
 #include <Adafruit_AHRS_Madgwick.h>
+#include <Adafruit_AHRS_Mahony.h>
 
-LSM9DS1Handler::LSM9DS1Handler(uint32_t max_measurements) :
-		measurements_max(max_measurements), data_size(
-				max_measurements * VALUES_PER_MEASUREMENT * sizeof(float)),
-				eventGroup(xEventGroupCreate()) {
+LSM9DS1Handler::LSM9DS1Handler(Metrics *metrics) :
+		metrics(metrics), streamer(metrics), eventGroup(xEventGroupCreate()) {
 }
 
 LSM9DS1Handler::~LSM9DS1Handler() {
+	prerender.reset();
+	delete[] prerender_buffer;
+	sessions.clear();
+	current.reset();
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		recordings[sensor].reset();
+	}
+	calculation.reset();
 	free(data);
+	free(csv_cache_data);
 	vTaskDelete(eventGroup);
 }
 
 void LSM9DS1Handler::begin() {
-	data = (float*) ps_malloc(data_size);
+	// The csv cache is small, so allocate it first to keep the largest block for the recordings.
+	csv_cache_data = (char*) ps_malloc(
+			CSV_CACHE_CHUNKS * ChunkCache::CHUNK_SIZE);
+	if (csv_cache_data == NULL) {
+		Serial.println("Failed to allocate the csv cache, downloads won't be shared!");
+	}
+	csv_cache.reset(csv_cache_data, CSV_CACHE_CHUNKS);
+
+	// Modules with 8 MB of PSRAM only map 4 MB directly, the rest is used through himem.
+	const size_t largest = ESP.getMaxAllocPsram();
+	size_t size = 0;
+	if (largest > PSRAM_RESERVE) {
+		size = (largest - PSRAM_RESERVE) / sizeof(float);
+		data = (float*) ps_malloc(size * sizeof(float));
+	}
+	if (data == NULL) {
+		Serial.println("Failed to allocate the recording memory!");
+	}
+	allocator.reset(data, size);
+	himem_allocator.reset(himem.begin());
+
+	Serial.print("Using ");
+	Serial.print(allocator.getSize() * sizeof(float));
+	Serial.print(" bytes of PSRAM and ");
+	Serial.print(himem_allocator.getSize() * sizeof(float));
+	Serial.println(" bytes of himem for recordings.");
+
+	// Without the sensor, recordings and exports can still be tested with the synthetic source.
+	for (uint8_t attempt = 1; !lsm_sources[0].begin(); attempt++) {
+		if (attempt >= SENSOR_BEGIN_ATTEMPTS) {
+			Serial.println("No LSM9DS1 found, using the synthetic sensor source.");
+			sources[0] = &synthetic_sources[0];
+			break;
+		}
+		Serial.println("Failed to initialize the LSM9DS1. Check your wiring!");
+		delay(1000);
+	}
+
+	// The other sensors are optional, and recorded together with the first one if they are connected.
+	if (lsm_sources[0].isAvailable()) {
+		for (uint8_t sensor = 1; sensor < MAX_SENSORS; sensor++) {
+			if (lsm_sources[sensor].begin()) {
+				sources[sensor_count++] = &lsm_sources[sensor];
+			}
+		}
+	}
+
+	// Recordings and streams are limited to the rates the bus and the storage can actually sustain.
+	probeThroughput();
+
+	if (flash_partition.begin()) {
+		restoreRecording();
+	} else {
+		Serial.println("No recording partition found, recordings can't be persisted.");
+	}
+
+	// Reading and storing the samples are split, so PSRAM and flash cache stalls can't delay reads.
+	xTaskCreatePinnedToCore(storageTask, "lsm9ds1 storage", 4096, this,
+			STORAGE_PRIORITY, &storage_task, STORAGE_CORE);
+	xTaskCreatePinnedToCore(readerTask, "lsm9ds1 reader", 4096, this,
+			READER_PRIORITY, &acquisition_task, READER_CORE);
+	metrics->watchTask("lsm9ds1 storage", storage_task);
+	metrics->watchTask("lsm9ds1 reader", acquisition_task);
+#ifdef LSM9DS1_DRDY
+	pinMode(LSM9DS1_INT1, INPUT_PULLDOWN);
+	attachInterruptArg(LSM9DS1_INT1, onDataReady, this, RISING);
+#endif
+}
+
+void LSM9DS1Handler::readSample() {
+	bool done = true;
+	for (uint8_t sensor = 0; sensor < active_sensors; sensor++) {
+		done = done && read_samples[sensor] >= measurements;
+	}
+
+	if (!measuring || done) {
+		// Only cleared once the probe is done, so the sources can't be changed while they are probed.
+		if (probe_requested && !measuring) {
+			probeThroughput();
+			probe_requested = false;
+			return;
+		}
+
+		reader_idle_count.fetch_add(1);
+		xEventGroupWaitBits(eventGroup, MEASURE_START_BIT, pdTRUE, pdTRUE,
+				500 / portTICK_PERIOD_MS);
+		return;
+	}
+
+	if (!data_rate_set) {
+		// Draining the FIFOs in bursts keeps the per sample overhead from limiting the rate of multiple sensors.
+		fifo = active_sensors > 1
+				&& (channels & (CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE));
+		for (uint8_t sensor = 0; sensor < active_sensors; sensor++) {
+			fifo = fifo && sources[sensor]->hasFifo();
+		}
+
+		for (uint8_t sensor = 0; sensor < active_sensors; sensor++) {
+			odr_interval_us = sources[sensor]->setDataRate(channels, frequency);
+			sources[sensor]->setFifo(fifo);
+		}
+		data_rate_set = true;
+	}
+
+	if (fifo) {
+		drainFifos();
+		return;
+	}
+
+	if (isDataReadyDriven()) {
+		// Wait for the next conversion. If an edge was missed the pin stays high until the data is read.
+		const TickType_t timeout = max(odr_interval_us * 2 / 1000 / portTICK_PERIOD_MS, (uint32_t) 1);
+		if (ulTaskNotifyTake(pdTRUE, timeout) == 0
+				&& digitalRead(LSM9DS1_INT1) == LOW) {
+			return;
+		}
+	}
+
+	// The other sensors are read right after the first one, each with its own timestamp.
+	const uint64_t start_us = micros();
+	for (uint8_t sensor = 0; sensor < active_sensors; sensor++) {
+		if (read_samples[sensor] < measurements) {
+			readSensor(sensor, sensor == 0 ? start_us : micros());
+		}
+	}
+
+	// Without the data ready interrupt the measurements are timed by waiting.
+	// Whole ticks are slept, so the lower priority tasks on this core can run, and only the rest is busy waited.
+	// A timeout of n ticks expires after n - 1 to n tick periods, so it never overshoots the remaining time.
+	if (!isDataReadyDriven()) {
+		const uint64_t target_us = start_us + measuring_time_target;
+		const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+		uint64_t now_us = micros();
+		while (measuring && now_us + tick_us <= target_us) {
+			// Woken early by stopReader, or a data ready signal that isn't used.
+			ulTaskNotifyTake(pdTRUE, (target_us - now_us) / tick_us);
+			now_us = micros();
+		}
+
+		if (measuring && now_us < target_us) {
+			delayMicroseconds(target_us - now_us);
+		}
+	}
+}
+
+void LSM9DS1Handler::drainFifos() {
+	vTaskDelay(max(FIFO_DRAIN_INTERVAL_MS / portTICK_PERIOD_MS, (uint32_t) 1));
+
+	for (uint8_t sensor = 0; sensor < active_sensors; sensor++) {
+		if (read_samples[sensor] >= measurements) {
+			continue;
+		}
+
+		// The newest conversion was taken just before draining, the older ones one ODR interval apart each.
+		// If the sensor clock runs fast, they are spread over the time since the last drain, to keep the timestamps ordered.
+		const uint8_t level = sources[sensor]->getFifoLevel();
+		const uint64_t drain_us = micros();
+		uint64_t interval_us = odr_interval_us;
+		if (level * interval_us > drain_us - last_drain_us[sensor]) {
+			interval_us = (drain_us - last_drain_us[sensor]) / (level + 1);
+		}
+
+		for (uint8_t i = 0; i < level; i++) {
+			readSensor(sensor, drain_us - (level - 1 - i) * interval_us);
+		}
+		last_drain_us[sensor] = drain_us;
+	}
+}
+
+void LSM9DS1Handler::readSensor(const uint8_t sensor, const uint64_t start_us) {
+	RawSample sample;
+	sample.timestamp = (start_us - measurement_start_us) / 1000.0;
+	sample.time_us = (uint32_t) (start_us - measurement_start_us);
+	sample.flags = 0;
+	sample.sensor = sensor;
+
+	// Conversions faster than the target frequency have to be read to clear the data ready signal, but aren't stored.
+	const bool store = read_samples[sensor] == 0
+			|| start_us - last_sample_us[sensor] + odr_interval_us / 2
+					>= measuring_time_target;
+
+	// A separate magnetometer is only read when it has a new measurement.
+	bool read_mag = false;
+	if (separate_mag) {
+		if (start_us - last_mag_read[sensor] >= mag_interval_us) {
+			read_mag = true;
+			last_mag_read[sensor] += mag_interval_us;
+			if (start_us - last_mag_read[sensor] >= mag_interval_us) {
+				last_mag_read[sensor] = start_us;
+			}
+		}
+	} else {
+		read_mag = store && (channels & CHANNEL_MAGNETOMETER);
+	}
+
+	// Only read the recorded sensors.
+	const uint8_t sensors = (channels
+			& (CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE))
+			| (read_mag ? CHANNEL_MAGNETOMETER : 0);
+	if (sensors != 0) {
+		sources[sensor]->read(sensors, sample.accel, sample.gyro, sample.mag);
+	}
+
+	if (read_mag) {
+		sample.flags |= RawSample::MAG;
+	}
+
+	if (store) {
+		sample.flags |= RawSample::STORE;
+	}
+
+	// Samples that don't fit into the ring are counted as overflows, and lost.
+	// The following conversion, or the next one from the FIFO, is stored instead, leaving a gap in the recording.
+	if (sample.flags == 0) {
+		return;
+	} else if (!ring.push(sample)) {
+		if (store) {
+			lost_samples++;
+		}
+	} else if (store) {
+		last_sample_us[sensor] = start_us;
+		read_samples[sensor]++;
+	}
+}
+
+void LSM9DS1Handler::storeSamples() {
+	RawSample sample;
+	if (!ring.pop(sample)) {
+		if (measuring) {
+			// Partial frames are sent while the ring is empty, so slow streams don't stall.
+			if (streaming) {
+				streamer.poll((uint32_t) (micros() - measurement_start_us));
+			}
+			vTaskDelay(1);
+		} else if (reader_start_pending) {
+			startPendingReader();
+			vTaskDelay(1);
+		} else {
+			xEventGroupWaitBits(eventGroup, STORE_START_BIT, pdTRUE, pdTRUE,
+					500 / portTICK_PERIOD_MS);
+		}
+		return;
+	}
+
+	std::shared_ptr<RecordingSession> sessions[MAX_SENSORS];
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+			sessions[sensor] = recordings[sensor];
+		}
+	}
+
+	do {
+		// Samples left over from an aborted recording are dropped.
+		if (measuring && streaming) {
+			if (sample.flags & RawSample::STORE) {
+				float measurement[SampleStream::MAX_STRIDE];
+				convertSample(sample, measurement);
+				streamer.add(sample.time_us, measurement + 1);
+			}
+		} else if (measuring && sample.sensor < MAX_SENSORS
+				&& sessions[sample.sensor]) {
+			storeSample(*sessions[sample.sensor], sample);
+		}
+	} while (ring.pop(sample));
+
+	// The recording ends once every sensor stored all its measurements.
+	const std::shared_ptr<RecordingSession> &session = sessions[0];
+	bool done = measuring && session;
+	uint32_t stored_all = 0;
+	uint8_t sensors = 0;
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		if (sessions[sensor]) {
+			const uint32_t stored = sessions[sensor]->samples.getStored();
+			done = done && stored >= measurements;
+			stored_all += stored;
+			sensors++;
+		}
+	}
+
+	if (done) {
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		if (recordings[0] == session) {
+			endRecording();
+		}
+	}
+
+	// Published once per batch, so the web server tasks never see a partially stored one.
+	RecordingStatus status = { };
+	if (measuring && session) {
+		status.session = session->id;
+		status.stored = session->samples.getStored();
+		status.measuring_time = session->measuring_time;
+		status.sensors = sensors;
+		status.stored_all = stored_all;
+	}
+	recording_status.write(status);
+}
+
+void LSM9DS1Handler::storeSample(RecordingSession &session,
+		const RawSample &raw) {
+	const float timestamp = raw.timestamp;
+	SampleStream &samples = session.samples;
+	SampleStream &mag_samples = session.mag_samples;
+	ChannelStatistics *statistics = session.statistics;
+
+	if (separate_mag && (raw.flags & RawSample::MAG)) {
+		float mag_measurement[4];
+		mag_measurement[0] = timestamp;
+		for (uint8_t i = 0; i < 3; i++) {
+			mag_measurement[i + 1] = raw.mag[i] * MAG_SCALE;
+		}
+
+		const uint32_t mag_stored = mag_samples.getStored();
+		if (mag_samples.append(mag_measurement)) {
+			detectEvents(session.events, CHANNEL_MAGNETOMETER, mag_measurement,
+					mag_stored);
+			for (uint8_t i = 0; i < 3; i++) {
+				statistics[6 + i].update(mag_measurement[i + 1], timestamp);
+			}
+			session.mag_overview.update();
+		}
+	}
+
+	if (!(raw.flags & RawSample::STORE)) {
+		return;
+	}
+
+	// The sample is assembled in internal RAM, and then written to its columns in PSRAM.
+	float measurement[SampleStream::MAX_STRIDE];
+	convertSample(raw, measurement);
+
+	const uint32_t stored = samples.getStored();
+	if (!samples.append(measurement)) {
+		return;
+	}
+	session.overview.update();
+	detectEvents(session.events,
+			separate_mag ? channels & ~CHANNEL_MAGNETOMETER : channels,
+			measurement, stored);
+
+	// The sensors are stored in the same order as their statistics, skipping the ones not recorded.
+	uint8_t index = 1;
+	for (uint8_t sensor = 0; index < samples.getStride(); sensor++) {
+		if (channels & (1 << sensor)) {
+			for (uint8_t i = 0; i < 3; i++) {
+				statistics[sensor * 3 + i].update(measurement[index++],
+						timestamp);
+			}
+		}
+	}
+
+	if (stored > 0) {
+		const uint32_t measurements_avg_count = min(stored + 1,
+				(uint32_t) 10);
+
+		const float last_measurements_time_ms = samples.getTimestamp(stored)
+				- samples.getTimestamp(stored + 1 - measurements_avg_count);
+
+		session.measuring_time = round(
+				last_measurements_time_ms * 1000
+						/ (measurements_avg_count - 1));
+	}
+}
+
+void LSM9DS1Handler::detectEvents(EventIndex &events, const uint8_t channels,
+		const float *measurement, const uint32_t index) {
+	// The sensors are stored in the same order as their statistics, skipping the ones not recorded.
+	const float *values = measurement + 1;
+	for (uint8_t sensor = 0; sensor < EventIndex::SENSORS; sensor++) {
+		if (!(channels & (1 << sensor))) {
+			continue;
+		}
+
+		if (events.getSettings().thresholds[sensor] > 0) {
+			float magnitude = sqrtf(
+					values[0] * values[0] + values[1] * values[1]
+							+ values[2] * values[2]);
+			if (sensor == 0) {
+				magnitude = fabsf(magnitude - SENSORS_GRAVITY_STANDARD);
+			}
+			events.update(sensor, index, measurement[0], magnitude);
+		}
+		values += 3;
+	}
+}
+
+uint8_t LSM9DS1Handler::convertSample(const RawSample &raw,
+		float *measurement, const uint8_t channels,
+		const bool separate_mag) const {
+	measurement[0] = raw.timestamp;
+	uint8_t index = 1;
+	if (channels & CHANNEL_ACCELEROMETER) {
+		for (uint8_t i = 0; i < 3; i++) {
+			measurement[index++] = raw.accel[i] * ACCEL_SCALE;
+		}
+	}
+
+	if (channels & CHANNEL_GYROSCOPE) {
+		for (uint8_t i = 0; i < 3; i++) {
+			measurement[index++] = raw.gyro[i] * GYRO_SCALE;
+		}
+	}
+
+	if (!separate_mag && (channels & CHANNEL_MAGNETOMETER)) {
+		for (uint8_t i = 0; i < 3; i++) {
+			measurement[index++] = raw.mag[i] * MAG_SCALE;
+		}
+	}
+	return index;
+}
+
+void LSM9DS1Handler::readerTask(void *handler) {
+	while (true) {
+		((LSM9DS1Handler*) handler)->readSample();
+	}
+}
+
+void LSM9DS1Handler::storageTask(void *handler) {
+	while (true) {
+		((LSM9DS1Handler*) handler)->storeSamples();
+	}
+}
+
+void LSM9DS1Handler::loop() {
+	if (!calculation) {
+		// Calculate the sessions in the order they were recorded in.
+		{
+			std::lock_guard<std::mutex> lock(sessions_mutex);
+			for (const std::shared_ptr<RecordingSession> &session : sessions) {
+				if (session->state == SESSION_CALCULATING) {
+					calculation = session;
+					break;
+				}
+			}
+		}
+
+		if (!calculation) {
+			// Pre-render the csvs of the current session while there is nothing else to do.
+			if (prerenderCsv()) {
+				delay(1);
+				return;
+			}
+
+			xEventGroupWaitBits(eventGroup, CALCULATE_START_BIT, pdTRUE, pdTRUE,
+					500 / portTICK_PERIOD_MS);
+			return;
+		}
+
+		calculation_progress = { };
+		calculation_progress.session = calculation->id;
+		calculation_progress.start = millis();
+		calculation_status.write(calculation_progress);
+	}
+
+	// Nobody can download a session that was deleted while calculating.
+	if (calculation.use_count() == 1) {
+		calculation.reset();
+		calculation_progress.session = 0;
+		calculation_status.write(calculation_progress);
+		return;
+	}
+
+	TRACE_SPAN(TRACE_LOOP);
+	const std::shared_ptr<const RecordingSession> session = calculation;
+	size_t size = 0;
+	const SampleStream *stream;
+	ValueGenerator content_generator;
+	std::vector<const char*> headers;
+
+	// The required channels for each file, in the order they are calculated in.
+	static const uint8_t required_channels[] = { 0, CHANNEL_ACCELEROMETER,
+			CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE, CHANNEL_GYROSCOPE,
+			CHANNEL_MAGNETOMETER };
+
+	const uint8_t calculated = calculation_progress.calculated;
+	if (calculated < MEASUREMENT_CSVS && calculation_progress.file != calculated) {
+		calculation_progress.file = (MeasurementCsv) calculated;
+		calculation_status.write(calculation_progress);
+	}
+
+	if (!getCsvGenerator(session, (MeasurementCsv) calculated, stream,
+			content_generator, headers)) {
+		Serial.print("Trying to calculate size for unknown measurements csv with id ");
+		Serial.print(calculated);
+		Serial.println('.');
+		calculation->state = SESSION_READY;
+		calculation.reset();
+		calculation_progress.session = 0;
+		calculation_status.write(calculation_progress);
+		return;
+	}
+
+	// Files for sensors that weren't recorded can't be downloaded, so they have no size.
+	const uint64_t start_us = micros();
+	if (session->isRecorded(required_channels[calculated])) {
+		size = getMeasurementCsvSize(*stream, { 0, stream->getStored(), 0 },
+				content_generator, headers);
+	}
+
+	// Generating the full file measures the export throughput without the network.
+	calculation_progress.times[calculated] = micros() - start_us;
+	calculation_progress.sizes[calculated] = size;
+	calculation->csv_sizes[calculated] = size;
+	calculation_progress.calculated++;
+	if (calculation_progress.calculated >= MEASUREMENT_CSVS) {
+		calculation->state = SESSION_READY;
+		calculation.reset();
+		calculation_progress.session = 0;
+	}
+	calculation_status.write(calculation_progress);
+}
+
+bool LSM9DS1Handler::getCsvGenerator(
+		const std::shared_ptr<const RecordingSession> session,
+		const MeasurementCsv csv, const SampleStream *&samples,
+		ValueGenerator &generator, std::vector<const char*> &headers) const {
+	samples = &session->samples;
+	switch (csv) {
+	case CSV_ALL:
+		generator = getAllGenerator(session);
+		headers = getAllHeaders(*session);
+		break;
+	case CSV_ACCELEROMETER:
+		generator = getDataContentGenerator(session,
+				session->getChannelIndex(CHANNEL_ACCELEROMETER), 3);
+		headers = { "Acceleration X(m/s^2)", "Acceleration Y(m/s^2)",
+				"Acceleration Z(m/s^2)" };
+		break;
+	case CSV_LINEAR_ACCELERATION:
+		generator = getLinearAccelerationGenerator(session);
+		headers = { "Linear Acceleration X(m/s^2)",
+				"Linear Acceleration Y(m/s^2)",
+				"Linear Acceleration Z(m/s^2)" };
+		break;
+	case CSV_GYROSCOPE:
+		generator = getDataContentGenerator(session,
+				session->getChannelIndex(CHANNEL_GYROSCOPE), 3);
+		headers = { "Rotation X(rad/s)", "Rotation Y(rad/s)",
+				"Rotation Z(rad/s)" };
+		break;
+	case CSV_MAGNETOMETER:
+		if (session->separate_mag) {
+			samples = &session->mag_samples;
+			generator = getDataContentGenerator(session,
+					session->mag_samples, 1, 3);
+		} else {
+			generator = getDataContentGenerator(session,
+					session->getChannelIndex(CHANNEL_MAGNETOMETER), 3);
+		}
+		headers = { "Magnetic X(uT)", "Magnetic Y(uT)", "Magnetic Z(uT)" };
+		break;
+	default:
+		return false;
+	}
+
+	headers = getSensorHeaders(*session, headers);
+	return true;
+}
+
+bool LSM9DS1Handler::prerenderCsv() {
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		// Only render while nothing is being recorded, so the acquisition gets all the PSRAM bandwidth.
+		if (recordings[0] || recording_pending || !current
+				|| current->state != SESSION_READY) {
+			prerender.reset();
+			return false;
+		}
+
+		if (prerender
+				&& (prerender->session != current
+						|| prerender->file.lock()
+								!= current->rendered[prerender->csv])) {
+			prerender.reset();
+		}
+
+		if (!prerender && prerender_failed != current->id) {
+			for (uint8_t csv = 0; csv < MEASUREMENT_CSVS; csv++) {
+				const size_t size = current->csv_sizes[csv];
+				if (size == 0 || current->rendered[csv]) {
+					continue;
+				}
+
+				float *slot = allocator.allocate(
+						(size + sizeof(float) - 1) / sizeof(float));
+				if (slot == NULL) {
+					// Don't retry every loop, the free memory only grows when a session is deleted.
+					prerender_failed = current->id;
+					break;
+				}
+
+				prerender.reset(new PrerenderJob());
+				prerender->session = current;
+				prerender->csv = (MeasurementCsv) csv;
+				current->rendered[csv] = std::make_shared<RenderedCsv>(
+						&allocator, slot, size);
+				prerender->file = current->rendered[csv];
+				getCsvGenerator(current, prerender->csv, prerender->samples,
+						prerender->generator, prerender->headers);
+				prerender->position = 0;
+				break;
+			}
+		}
+
+		if (!prerender) {
+			return false;
+		}
+	}
+
+	if (prerender_buffer == NULL) {
+		prerender_buffer = new char[ChunkCache::CHUNK_SIZE];
+	}
+
+	// Render into internal RAM without holding a reference to the file, so a new recording can reclaim its memory at any time.
+	const SampleRange range = { 0, prerender->samples->getStored(), 0 };
+	const size_t length = generateMeasurementCsv(',', prerender->position,
+			*prerender->samples, range, prerender->generator,
+			prerender->headers, prerender_buffer, ChunkCache::CHUNK_SIZE);
+
+	std::lock_guard<std::mutex> lock(sessions_mutex);
+	std::shared_ptr<RenderedCsv> file = prerender->file.lock();
+	if (!file) {
+		prerender.reset();
+		return true;
+	}
+
+	if (file->rendered + length > file->size
+			|| (length == 0 && !file->isComplete())) {
+		Serial.print("Pre-rendered ");
+		Serial.print(MEASUREMENT_CSV_NAMES[prerender->csv]);
+		Serial.println(" doesn't match its calculated size!");
+		prerender->session->rendered[prerender->csv].reset();
+		prerender_failed = prerender->session->id;
+		prerender.reset();
+		return true;
+	}
+
+	memcpy(file->data + file->rendered, prerender_buffer, length);
+	file->rendered += length;
+	if (file->isComplete()) {
+		prerender.reset();
+	}
+	return true;
+}
+
+void LSM9DS1Handler::dropRenderedCsvs() {
+	std::lock_guard<std::mutex> lock(sessions_mutex);
+	for (const std::shared_ptr<RecordingSession> &session : sessions) {
+		for (uint8_t csv = 0; csv < MEASUREMENT_CSVS; csv++) {
+			session->rendered[csv].reset();
+		}
+	}
+	prerender_failed = 0;
+}
+
+const std::shared_ptr<const RenderedCsv> LSM9DS1Handler::getRenderedCsv(
+		const RecordingSession &session, const MeasurementCsv csv) const {
+	std::lock_guard<std::mutex> lock(sessions_mutex);
+	const std::shared_ptr<RenderedCsv> file = session.rendered[csv];
+	if (file && file->isComplete()) {
+		return file;
+	}
+	return nullptr;
+}
+
+bool LSM9DS1Handler::measure(uint32_t measurements, uint16_t freq,
+		uint8_t channels) {
+	// Erasing and writing the flash disables the cache of both cores, which would stall the reader task.
+	if (isPersisting()) {
+		Serial.println("Can't start a recording while a recording is persisted.");
+		return false;
+	}
+
+	channels &= CHANNEL_ALL;
+	if (channels == 0) {
+		channels = CHANNEL_ALL;
+	}
+
+	// The magnetometer gets its own stream at its own rate, unless it is the only sensor recorded.
+	const bool separate_mag = (channels & CHANNEL_MAGNETOMETER)
+			&& channels != CHANNEL_MAGNETOMETER;
+
+	uint8_t values = 1;
+	for (uint8_t channel = CHANNEL_ACCELEROMETER; channel <= CHANNEL_MAGNETOMETER;
+			channel <<= 1) {
+		if (channels & channel) {
+			values += 3;
+		}
+	}
+
+	if (separate_mag) {
+		values -= 3;
+	}
+
+	// Rates the bus can't sustain would silently record fewer measurements per second than requested.
+	freq = max((uint16_t) 1, freq);
+	const uint16_t max_freq = getMaxFrequency(channels);
+	if (freq > max_freq) {
+		Serial.print("Limiting the measuring frequency to the measured max of ");
+		Serial.print(max_freq);
+		Serial.println("hz.");
+		freq = max_freq;
+	}
+
+	const uint16_t mag_frequency = min(freq, MAG_ODR);
+	const uint16_t stream_mag_frequency = separate_mag ? mag_frequency : 0;
+
+	// The backlog of a running stream is released asynchronously, so it may not be available yet.
+	endStream();
+
+	// A recording still in progress is kept as a session of its own.
+	// Its samples still in flight are dropped, so none of them end up in the new sessions.
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		if (recordings[0]) {
+			endRecording();
+		}
+		stopReader();
+		recording_pending = true;
+	}
+
+	// Pre-rendered csvs only use otherwise spare memory, so they make room for the new recording.
+	// The loop doesn't render new ones until the new sessions are published, so they can't take it back.
+	dropRenderedCsvs();
+
+	// Every sensor is recorded into a session of its own, with the same capacity.
+	const uint8_t sensors = sensor_count;
+	bool paged;
+	measurements = fitSession(measurements, values, freq, stream_mag_frequency,
+			paged, sensors);
+	if (measurements == 0) {
+		Serial.println("Not enough free memory for a new recording session.");
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		recording_pending = false;
+		return false;
+	}
+
+	// Sessions created before a failed allocation release their memory when they go out of scope.
+	std::shared_ptr<RecordingSession> created[MAX_SENSORS];
+	for (uint8_t sensor = 0; sensor < sensors; sensor++) {
+		created[sensor] = createSession(measurements, values, channels, freq,
+				stream_mag_frequency, paged);
+		if (!created[sensor]) {
+			Serial.println("Failed to allocate a new recording session.");
+			std::lock_guard<std::mutex> lock(sessions_mutex);
+			recording_pending = false;
+			return false;
+		}
+
+		created[sensor]->sensor = sensor;
+		created[sensor]->sensors = sensors;
+		created[sensor]->group = created[0]->id;
+	}
+
+	// The reader task may still be finishing its last sample, so the storage task starts it once it stopped.
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		for (uint8_t sensor = 0; sensor < sensors; sensor++) {
+			sessions.push_back(created[sensor]);
+			recordings[sensor] = created[sensor];
+		}
+		current = created[0];
+		recording_pending = false;
+		reader_config = { channels, sensors, separate_mag, freq, mag_frequency,
+				measurements };
+		reader_start_pending = true;
+	}
+
+	xEventGroupSetBits(eventGroup, STORE_START_BIT);
+	return true;
+}
+
+std::shared_ptr<RecordingSession> LSM9DS1Handler::createSession(
+		const uint32_t measurements, const uint8_t values,
+		const uint8_t channels, const uint16_t frequency,
+		const uint16_t mag_frequency, const bool paged) {
+	const uint32_t mag_capacity = getMagCapacity(measurements, frequency,
+			mag_frequency);
+	const size_t streams_size = getStreamsSize(measurements, values,
+			mag_capacity);
+	const size_t size = getIndexesSize(measurements, values, mag_capacity)
+			+ (paged ? 0 : streams_size);
+	float *slot = allocator.allocate(size);
+	size_t paged_offset = SlotAllocator::NO_SLOT;
+	if (slot != NULL && paged) {
+		paged_offset = himem_allocator.allocateOffset(streams_size);
+		if (paged_offset == SlotAllocator::NO_SLOT) {
+			allocator.release(slot);
+			slot = NULL;
+		}
+	}
+
+	if (slot == NULL) {
+		return nullptr;
+	}
+
+	uint32_t id;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		id = next_session_id++;
+	}
+
+	std::shared_ptr<RecordingSession> session;
+	float *overview_data;
+	if (paged) {
+		session = std::make_shared<RecordingSession>(id, &allocator, slot, size,
+				&himem_allocator, paged_offset, streams_size);
+		session->samples.reset(&himem, paged_offset, values, measurements);
+		session->mag_samples.reset(&himem,
+				paged_offset + SampleStream::getSize(measurements, values), 4,
+				mag_capacity);
+		overview_data = slot;
+	} else {
+		session = std::make_shared<RecordingSession>(id, &allocator, slot,
+				size);
+		session->samples.reset(slot, values, measurements);
+		float *mag_data = slot + SampleStream::getSize(measurements, values);
+		session->mag_samples.reset(mag_data, 4, mag_capacity);
+		overview_data = mag_data + SampleStream::getSize(mag_capacity, 4);
+	}
+	session->channels = channels;
+	session->separate_mag = mag_frequency > 0;
+	session->frequency = frequency;
+	session->measurements = measurements;
+	session->measuring_time = 1000000 / frequency;
+	session->group = id;
+
+	session->overview.reset(overview_data, &session->samples);
+	float *mag_overview_data = overview_data
+			+ OverviewPyramid::getSize(measurements, values);
+	session->mag_overview.reset(mag_overview_data, &session->mag_samples);
+	session->events.reset(
+			mag_overview_data + OverviewPyramid::getSize(mag_capacity, 4),
+			MAX_EVENTS, event_settings);
+
+	session->start = millis();
+	return session;
+}
+
+void LSM9DS1Handler::stopReader() {
+	measuring = false;
+	reader_stop_count = reader_idle_count.load();
+	reader_start_pending = false;
+
+	// Wake both tasks, in case they wait for a data ready signal, the next sample time, or a new recording.
+	xEventGroupSetBits(eventGroup, MEASURE_START_BIT | STORE_START_BIT);
+	xTaskNotifyGive(acquisition_task);
+}
+
+void LSM9DS1Handler::startPendingReader() {
+	std::lock_guard<std::mutex> lock(sessions_mutex);
+	// The storage task drops everything it pops while nothing is measured, so an empty ring has no old samples left.
+	if (!reader_start_pending || !isReaderStopped() || ring.available() > 0) {
+		return;
+	}
+
+	channels = reader_config.channels;
+	active_sensors = reader_config.sensors;
+	separate_mag = reader_config.separate_mag;
+	mag_frequency = reader_config.mag_frequency;
+	mag_interval_us = 1000000 / mag_frequency;
+	frequency = reader_config.frequency;
+	measuring_time_target = 1000000 / frequency;
+	measurements = reader_config.measurements;
+
+	resetReader();
+	reader_start_pending = false;
+	measuring = true;
+	xEventGroupSetBits(eventGroup, MEASURE_START_BIT);
+}
+
+void LSM9DS1Handler::resetReader() {
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		read_samples[sensor] = 0;
+		last_sample_us[sensor] = 0;
+		last_mag_read[sensor] = 0;
+	}
+
+	data_rate_set = false;
+	lost_samples = 0;
+	ring.resetStatistics();
+	measurement_start_us = micros();
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		last_drain_us[sensor] = measurement_start_us;
+	}
+}
+
+void LSM9DS1Handler::endRecording() {
+	stopReader();
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		std::shared_ptr<RecordingSession> &recording = recordings[sensor];
+		if (!recording) {
+			continue;
+		}
+
+		recording->duration = millis() - recording->start;
+		const uint32_t stored = recording->samples.getStored();
+		if (stored > 0) {
+			recording->measuring_time = (uint64_t) recording->duration * 1000
+					/ stored;
+		}
+		recording->state = SESSION_CALCULATING;
+		recording.reset();
+	}
+	xEventGroupSetBits(eventGroup, CALCULATE_START_BIT);
+}
+
+bool LSM9DS1Handler::isRecording(
+		const std::shared_ptr<RecordingSession> &session) const {
+	if (!session) {
+		return false;
+	}
+
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		if (recordings[sensor] == session) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint8_t LSM9DS1Handler::getConnectedSensors() const {
+	uint8_t connected = 0;
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		if (lsm_sources[sensor].isAvailable()) {
+			connected++;
+		}
+	}
+	return connected;
+}
+
+size_t LSM9DS1Handler::getStreamsSize(const uint32_t measurements,
+		const uint8_t values, const uint32_t mag_capacity) {
+	return SampleStream::getSize(measurements, values)
+			+ SampleStream::getSize(mag_capacity, 4);
+}
+
+size_t LSM9DS1Handler::getIndexesSize(const uint32_t measurements,
+		const uint8_t values, const uint32_t mag_capacity) {
+	return OverviewPyramid::getSize(measurements, values)
+			+ OverviewPyramid::getSize(mag_capacity, 4)
+			+ EventIndex::getSize(MAX_EVENTS);
+}
+
+uint32_t LSM9DS1Handler::getMagCapacity(const uint32_t measurements,
+		const uint16_t frequency, const uint16_t mag_frequency) {
+	return mag_frequency > 0 ?
+			ceil((float) measurements * mag_frequency / frequency) + 2 : 0;
+}
+
+uint32_t LSM9DS1Handler::fitSession(const uint32_t measurements,
+		const uint8_t values, const uint16_t frequency,
+		const uint16_t mag_frequency, bool &paged, const uint8_t sessions) const {
+	const size_t available = allocator.getLargestFree();
+	const size_t paged_available = himem_allocator.getLargestFree();
+
+	// Finds the largest number of measurements fitting into the given free extents.
+	auto fit = [=](const bool in_himem) -> uint32_t {
+		// Less values per measurement means more measurements fit into the largest free extent.
+		const float mag_values = 4.0 * mag_frequency / frequency;
+		uint32_t low = 0;
+		uint32_t high = min(
+				(uint32_t) ((in_himem ? paged_available : available)
+						/ (values + mag_values) / sessions), measurements) + 1;
+		while (high - low > 1) {
+			const uint32_t middle = low + (high - low) / 2;
+			const uint32_t mag_capacity = getMagCapacity(middle, frequency,
+					mag_frequency);
+			const size_t streams = getStreamsSize(middle, values, mag_capacity)
+					* sessions;
+			const size_t pyramids = getIndexesSize(middle, values, mag_capacity)
+					* sessions;
+			if (in_himem ?
+					streams <= paged_available && pyramids <= available :
+					streams + pyramids <= available) {
+				low = middle;
+			} else {
+				high = middle;
+			}
+		}
+		return low;
+	};
+
+	const uint32_t direct = fit(false);
+	paged = false;
+	if (direct < measurements && paged_available > 0) {
+		const uint32_t paged_measurements = fit(true);
+		if (paged_measurements > direct) {
+			paged = true;
+			return paged_measurements;
+		}
+	}
+
+	return direct;
+}
+
+uint32_t LSM9DS1Handler::getMaxMeasurements() const {
+	bool paged;
+	return fitSession(UINT32_MAX, VALUES_PER_MEASUREMENT, 1, 0, paged);
+}
+
+void LSM9DS1Handler::resetMeasurements() {
+	std::lock_guard<std::mutex> lock(sessions_mutex);
+	if (!current) {
+		return;
+	}
+
+	if (isRecording(current)) {
+		endRecording();
+	}
+
+	for (std::vector<std::shared_ptr<RecordingSession>>::iterator it =
+			sessions.begin(); it != sessions.end(); it++) {
+		if (*it == current) {
+			sessions.erase(it);
+			break;
+		}
+	}
+	current.reset();
+}
+
+std::shared_ptr<RecordingSession> LSM9DS1Handler::getSession(
+		AsyncWebServerRequest *request) const {
+	std::shared_ptr<RecordingSession> session;
+	if (!request->hasArg("session") || request->arg("session").length() == 0) {
+		{
+			std::lock_guard<std::mutex> lock(sessions_mutex);
+			session = current;
+		}
+
+		if (!session) {
+			request->send(404, "text/plain", "There is no recording session.");
+		}
+		return session;
+	}
+
+	const uint32_t id = request->arg("session").toInt();
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		for (const std::shared_ptr<RecordingSession> &candidate : sessions) {
+			if (candidate->id == id) {
+				session = candidate;
+				break;
+			}
+		}
+	}
+
+	if (!session) {
+		std::ostringstream message;
+		message << "There is no recording session with id " << id << '.';
+		request->send(404, "text/plain", message.str().c_str());
+	}
+	return session;
+}
+
+const std::vector<const char*> LSM9DS1Handler::getAllHeaders(
+		const RecordingSession &session) const {
+	std::vector<const char*> headers;
+	if (session.isRecorded(CHANNEL_ACCELEROMETER)) {
+		headers.insert(headers.end(), { "Acceleration X(m/s^2)",
+				"Acceleration Y(m/s^2)", "Acceleration Z(m/s^2)" });
+	}
+
+	if (session.isRecorded(CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE)) {
+		headers.insert(headers.end(), { "Linear Acceleration X(m/s^2)",
+				"Linear Acceleration Y(m/s^2)", "Linear Acceleration Z(m/s^2)" });
+	}
+
+	if (session.isRecorded(CHANNEL_GYROSCOPE)) {
+		headers.insert(headers.end(), { "Rotation X(rad/s)",
+				"Rotation Y(rad/s)", "Rotation Z(rad/s)" });
+	}
+
+	if (session.isRecorded(CHANNEL_MAGNETOMETER)) {
+		headers.insert(headers.end(), { "Magnetic X(uT)", "Magnetic Y(uT)",
+				"Magnetic Z(uT)" });
+	}
+
+	return headers;
+}
+
+void IRAM_ATTR LSM9DS1Handler::onDataReady(void *handler) {
+	BaseType_t higher_priority_task_woken = pdFALSE;
+	vTaskNotifyGiveFromISR(((LSM9DS1Handler*) handler)->acquisition_task,
+			&higher_priority_task_woken);
+	if (higher_priority_task_woken) {
+		portYIELD_FROM_ISR();
+	}
+}
+
+const std::vector<const char*> LSM9DS1Handler::getSensorHeaders(
+		const RecordingSession &session,
+		const std::vector<const char*> &headers) const {
+	if (session.sensors < 2) {
+		return headers;
+	}
+
+	// The prefixed headers are kept for the lifetime of the program, there are only a few dozen combinations.
+	static std::set<std::string> prefixed_headers;
+	static std::mutex prefixed_mutex;
+	std::vector<const char*> prefixed;
+	std::lock_guard<std::mutex> lock(prefixed_mutex);
+	for (const char *header : headers) {
+		std::ostringstream name;
+		name << "Sensor " << (uint16_t) session.sensor << ' ' << header;
+		prefixed.push_back(prefixed_headers.insert(name.str()).first->c_str());
+	}
+	return prefixed;
+}
+
+const ValueGenerator LSM9DS1Handler::getAllGenerator(
+		const std::shared_ptr<const RecordingSession> session,
+		const FusionAlgorithm algorithm, const bool magnetometer) const {
+	std::vector<ValueGenerator> generators;
+	if (session->isRecorded(CHANNEL_ACCELEROMETER)) {
+		generators.push_back(
+				getDataContentGenerator(session,
+						session->getChannelIndex(CHANNEL_ACCELEROMETER)));
+	}
+
+	if (session->isRecorded(CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE)) {
+		generators.push_back(
+				getLinearAccelerationGenerator(session, algorithm,
+						magnetometer));
+	}
+
+	// The gyroscope and magnetometer values are always stored after the accelerometer values.
+	const uint8_t gyromag_index =
+			session->isRecorded(CHANNEL_ACCELEROMETER) ? 4 : 1;
+	const uint8_t gyromag_channels = session->samples.getStride()
+			- gyromag_index;
+	if (gyromag_channels > 0) {
+		generators.push_back(
+				getDataContentGenerator(session, gyromag_index,
+						gyromag_channels));
+	}
+
+	if (session->separate_mag) {
+		generators.push_back(getMagnetometerGenerator(session));
+	}
+
+	return [generators](float *values, const uint32_t position) -> uint8_t {
+		uint8_t count = 0;
+		for (const ValueGenerator &generator : generators) {
+			count += generator(values + count, position);
+		}
+
+		return count;
+	};
+}
+
+const ValueGenerator LSM9DS1Handler::getLinearAccelerationGenerator(
+		const std::shared_ptr<const RecordingSession> session,
+		const FusionAlgorithm algorithm, const bool magnetometer) const {
+	// Tell the filter a lower sample rate to reduce smoothing.
+	std::shared_ptr<OrientationFilter> filter = std::make_shared<
+			OrientationFilter>(algorithm,
+			round(1000000.0 / session->measuring_time) / 20);
+
+	// Linear acceleration requires the accelerometer and gyroscope to be recorded.
+	// The magnetometer is optional, the filter falls back to 6DOF updates without it.
+	std::shared_ptr<uint32_t> mag_cursor = std::make_shared<uint32_t>(0);
+
+	return [session, filter, mag_cursor, magnetometer](float *values, const uint32_t position) -> uint8_t {
+		// The accelerometer values are followed by the gyroscope values, in the units the filter expects.
+		float measurement[6];
+		session->samples.getValues(position, 1, 6, measurement);
+
+		float mag[3];
+		const bool has_mag = magnetometer
+				&& session->getMagnetometerValues(position, *mag_cursor, mag);
+		filter->update(measurement, measurement + 3, has_mag ? mag : NULL);
+
+		filter->getGravity(values);
+		for (uint8_t i = 0; i < 3; i++) {
+			values[i] = measurement[i] - values[i];
+		}
+		return 3;
+	};
+}
+
+bool LSM9DS1Handler::getFusionArgs(AsyncWebServerRequest *request,
+		FusionAlgorithm &algorithm, bool &magnetometer) const {
+	algorithm = FUSION_MADGWICK;
+	if (request->hasArg("fusion")) {
+		const String name = request->arg("fusion");
+		algorithm = FUSION_ALGORITHMS;
+		for (uint8_t i = 0; i < FUSION_ALGORITHMS; i++) {
+			if (name == OrientationFilter::ALGORITHM_NAMES[i]) {
+				algorithm = (FusionAlgorithm) i;
+				break;
+			}
+		}
+
+		if (algorithm == FUSION_ALGORITHMS) {
+			request->send(400, "text/plain",
+					"Unknown fusion algorithm, expected madgwick or mahony.");
+			return false;
+		}
+	}
+
+	magnetometer = !request->hasArg("magnetometer")
+			|| request->arg("magnetometer") != "false";
+	return true;
+}
+
+const ValueGenerator LSM9DS1Handler::getMagnetometerGenerator(
+		const std::shared_ptr<const RecordingSession> session) const {
+	std::shared_ptr<uint32_t> cursor = std::make_shared<uint32_t>(0);
+
+	return [session, cursor](float *values, const uint32_t position) -> uint8_t {
+		if (!session->getMagnetometerValues(position, *cursor, values)) {
+			for (uint8_t i = 0; i < 3; i++) {
+				values[i] = NAN;
+			}
+		}
+
+		return 3;
+	};
+}
+
+const ValueGenerator LSM9DS1Handler::getDataContentGenerator(
+		const std::shared_ptr<const RecordingSession> session,
+		const SampleStream &samples, const uint8_t index,
+		uint8_t channels) const {
+	channels = min((uint8_t) (samples.getStride() - index), channels);
+
+	// The stream is part of the session, so it lives as long as the session reference.
+	const SampleStream *stream = &samples;
+	return [session, stream, index, channels](float *values, const uint32_t position) -> uint8_t {
+		stream->getValues(position, index, channels, values);
+		return channels;
+	};
+}
+
+const ValueGenerator LSM9DS1Handler::getDecimatingGenerator(
+		const ValueGenerator generator, const uint16_t factor) const {
+	struct DecimationState {
+		std::unique_ptr<LowPassFilter> filter;
+		uint32_t next = 0;
+	};
+	std::shared_ptr<DecimationState> state = std::make_shared<DecimationState>();
+
+	return [generator, factor, state](float *values, const uint32_t position) -> uint8_t {
+		if (!state->filter) {
+			state->next = position;
+		} else if (position < state->next) {
+			return generator(values, position);
+		}
+
+		// Every sample has to pass through the filter, but only the requested ones get written.
+		uint8_t count = 0;
+		for (uint32_t i = state->next; i <= position; i++) {
+			count = generator(values, i);
+			if (!state->filter) {
+				// Filter out everything above 80% of the nyquist frequency of the output rate.
+				state->filter.reset(new LowPassFilter(count, 0.4 / factor));
+				state->filter->reset(values);
+			}
+			state->filter->update(values, values);
+		}
+		state->next = position + 1;
+
+		return count;
+	};
+}
+
+void LSM9DS1Handler::sendNotRecorded(AsyncWebServerRequest *request,
+		const char *sensors) const {
+	std::ostringstream message;
+	message << "This file requires " << sensors
+			<< " data, which isn't part of the selected recording session.";
+	request->send(409, "text/plain", message.str().c_str());
+}
+
+void LSM9DS1Handler::sendMeasurementsCsv(AsyncWebServerRequest *request,
+		const std::shared_ptr<const RecordingSession> session,
+		const SampleStream &samples,
+		const ValueGeneratorFactory generator_factory,
+		const std::vector<const char*> value_headers, const size_t content_len,
+		const std::shared_ptr<const RenderedCsv> rendered) const {
+	const std::vector<const char*> headers = getSensorHeaders(*session,
+			value_headers);
+	const uint32_t stored = session->samples.getStored();
+	if (stored == 0 || session->state != SESSION_READY) {
+		metrics->rejectDownload();
+		AsyncWebServerResponse *response = request->beginResponse_P(503,
+				"text/html", unavailable_html);
+		if (session->state == SESSION_RECORDING) {
+			std::ostringstream converter;
+			const uint32_t remaining_measuring_time = (session->measurements
+					- stored) * session->measuring_time / 1000000;
+			converter << remaining_measuring_time;
+			response->addHeader("Retry-After", converter.str().c_str());
+		} else {
+			response->addHeader("Retry-After", "5");
+		}
+		request->send(response);
+		return;
+	}
+
+	uint8_t separator_char = ',';
+	if (request->hasArg("separator")) {
+		separator_char = request->arg("separator")[0];
+	}
+
+	// Downsample to the requested rate, if it is lower than the recorded one.
+	uint16_t step = 1;
+	if (request->hasArg("rate")) {
+		const float rate = request->arg("rate").toFloat();
+		if (rate > 0) {
+			step = max(1.0f, roundf(samples.getRate() / rate));
+		}
+	}
+
+	const SampleRange range = getSampleRange(request, *session, samples);
+	const bool full = range.start == 0 && range.end == samples.getStored();
+	auto createGenerator = [this, generator_factory, step]() -> ValueGenerator {
+		return step > 1 ?
+				getDecimatingGenerator(generator_factory(), step) :
+				generator_factory();
+	};
+
+	// The size of the full csv is calculated after recording, small slices are measured using a separate generator.
+	// That blocks the web server task, so it is limited by the generated values, not the output lines.
+	size_t length = 0;
+	if (full && step == 1) {
+		length = content_len;
+	} else if (!full
+			&& (uint64_t) (range.end - range.warmup) * headers.size()
+					<= CSV_SIZED_SLICE_VALUES) {
+		length = getMeasurementCsvSize(samples, range, createGenerator(),
+				headers, step);
+	}
+
+	// Pre-rendered csvs only have to be copied.
+	if (rendered && full && step == 1 && separator_char == ',') {
+		metrics->startDownload(request);
+		request->send(request->beginResponse("text/csv", rendered->size,
+				metrics->countSent(request,
+						[rendered](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+							const size_t length = min(maxLen, rendered->size - index);
+							memcpy(buffer, rendered->data + index, length);
+							return length;
+						})));
+		return;
+	}
+
+	// Full csvs are rendered once into the csv cache, and every client downloading them at the same time streams from there.
+	if (full && step == 1) {
+		std::ostringstream key;
+		key << session->id << request->url().c_str() << (char) separator_char
+				<< request->arg("fusion").c_str()
+				<< request->arg("magnetometer").c_str();
+
+		const ValueGenerator generator = createGenerator();
+		const SampleStream *stream = &samples;
+		std::shared_ptr<uint32_t> position = std::make_shared<uint32_t>(
+				range.start);
+		bool created = false;
+		ChunkCache::Reader *reader = csv_cache.open(key.str(),
+				[this, session, stream, range, generator, headers, separator_char, position](
+						char *buffer, size_t maxlen) -> size_t {
+					return generateMeasurementCsv(separator_char, *position,
+							*stream, range, generator, headers, buffer, maxlen);
+				}, created);
+
+		if (reader != NULL) {
+			if (created) {
+				ChunkRendererParameter *parameter = new ChunkRendererParameter {
+						&csv_cache, ChunkCache::getFile(reader), metrics };
+				if (xTaskCreate(chunkRenderer, "chunk renderer",
+						CSV_GENERATOR_STACK_SIZE, parameter, 1, NULL) != pdPASS) {
+					// Without readers the file is deleted by the first render attempt.
+					csv_cache.close(reader);
+					csv_cache.render(parameter->file);
+					delete parameter;
+					metrics->rejectDownload();
+					request->send(500, "text/plain",
+							"Failed to start generating the csv.");
+					return;
+				}
+			}
+
+			std::shared_ptr<CsvCacheReader> cache_reader = std::make_shared<
+					CsvCacheReader>(&csv_cache, reader);
+			AwsResponseFiller filler = metrics->countSent(request,
+					[cache_reader](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+						bool done;
+						const size_t read = cache_reader->cache->read(
+								cache_reader->reader, (char*) buffer, maxLen,
+								done);
+						return read > 0 || done ? read : RESPONSE_TRY_AGAIN;
+					});
+
+			metrics->startDownload(request);
+			if (length > 0) {
+				request->send(request->beginResponse("text/csv", length, filler));
+			} else {
+				request->send(request->beginChunkedResponse("text/csv", filler));
+			}
+			return;
+		}
+	}
+
+	BufferStream *stream = new BufferStream(20000);
+	EventGroupHandle_t eventGroup = xEventGroupCreate();
+	stream->setEventGroup(eventGroup);
+	const size_t maxlen = 2000;
+	char *buffer = new char[maxlen];
+	std::shared_ptr<CsvGeneratorParameter> parameter = std::make_shared<
+			CsvGeneratorParameter>(this, stream, maxlen, buffer, session,
+			&samples, range, createGenerator(), headers, length,
+			separator_char, step);
+	parameter->endpoint = metrics->getEndpoint(request);
+	TaskHandle_t handle;
+	xTaskCreate(csvGenerator, "csv generator", CSV_GENERATOR_STACK_SIZE,
+			parameter.get(), 1, &handle);
+
+	metrics->startDownload(request);
+	Metrics *metrics = LSM9DS1Handler::metrics;
+	metrics->onDisconnect(request, [handle, parameter, metrics]() {
+		if (parameter->buffer_len > 0) {
+			parameter->buffer_len = 0;
+			metrics->recordStack("csv generator", handle);
+			vTaskDelete(handle);
+			vEventGroupDelete(parameter->stream->getEventGroup());
+		}
+	});
+
+	if (length > 0) {
+		request->send(*stream, "text/csv", length);
+		return;
+	}
+
+	// The size of downsampled csvs and large slices isn't known in advance, so they are sent using chunked encoding.
+	AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+			[parameter](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+				// Check whether generating is done first, so no data written in between gets lost.
+				const bool done = parameter->buffer_len == 0;
+				const size_t available = parameter->stream->available();
+				if (available > 0) {
+					return parameter->stream->readBytes(buffer, min(available, maxLen));
+				} else if (done) {
+					return 0;
+				} else {
+					return RESPONSE_TRY_AGAIN;
+				}
+			});
+	request->send(response);
+}
+
+void LSM9DS1Handler::sendMeasurementsJson(
+		AsyncWebServerRequest *request) const {
+	// Without a session argument this also responds if there is no current session, for the recording page.
+	std::shared_ptr<const RecordingSession> session;
+	if (request->hasArg("session")) {
+		session = getSession(request);
+		if (!session) {
+			return;
+		}
+	} else {
+		session = getCurrentSession();
+	}
+
+	// The session being recorded is read from the snapshot of the storage task, finished ones don't change anymore.
+	char *measurements = new char[300];
+	uint32_t measuring_time = 0;
+	uint32_t stored = 0;
+	uint32_t stored_all = 0;
+	if (session && session->state == SESSION_RECORDING) {
+		const RecordingStatus status = recording_status.read();
+		measuring_time = uint32_t(millis() - session->start);
+		stored = status.session == session->id ? status.stored : 0;
+		stored_all = status.session == session->id ? status.stored_all : 0;
+	} else if (session) {
+		measuring_time = session->duration;
+		stored = session->samples.getStored();
+
+		// The aggregate rate covers all sessions of the sensors recorded together.
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		for (const std::shared_ptr<RecordingSession> &other : sessions) {
+			if (other->group == session->group) {
+				stored_all += other->samples.getStored();
+			}
+		}
+	}
+	sprintf(measurements,
+			"{\"session\": %u, \"measurements\": %u, \"time\": %u, \"sensors\": %u, \"aggregate_rate\": %u, \"ring_capacity\": %u, \"ring_high_water\": %u, \"ring_overflows\": %u, \"lost\": %u}",
+			session ? session->id : 0, stored, measuring_time,
+			session ? session->sensors : 0,
+			measuring_time == 0 ?
+					0 : (uint32_t) ((uint64_t) stored_all * 1000 / measuring_time),
+			ring.getCapacity(), ring.getHighWater(), ring.getOverflows(),
+			lost_samples);
+	AsyncWebServerResponse *response = request->beginResponse(200, "application/json", measurements);
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+	delete[] measurements;
+}
+
+void LSM9DS1Handler::sendCalculationsJson(
+		AsyncWebServerRequest *request) const {
+	const CalculationStatus status = calculation_status.read();
+	std::ostringstream calculations;
+	const uint32_t calculating_time = millis() - status.start;
+	calculations << "{\"session\": " << status.session << ", \"calculated\": "
+			<< (uint16_t) status.calculated << ", \"file\": \""
+			<< MEASUREMENT_CSV_NAMES[status.file] << "\", \"time\": "
+			<< calculating_time << ", \"files\": [";
+
+	// The generation throughput of each file calculated so far, in bytes per second.
+	for (uint8_t i = 0; i < status.calculated && i < MEASUREMENT_CSVS; i++) {
+		calculations << (i > 0 ? ", " : "") << "{\"name\": \""
+				<< MEASUREMENT_CSV_NAMES[i] << "\", \"size\": "
+				<< status.sizes[i] << ", \"time_us\": " << status.times[i]
+				<< ", \"throughput\": "
+				<< (status.times[i] == 0 ?
+						0 : (uint64_t) status.sizes[i] * 1000000
+								/ status.times[i]) << '}';
+	}
+	calculations << "]}";
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", calculations.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
+
+void LSM9DS1Handler::sendSummaryJson(AsyncWebServerRequest *request) const {
+	const std::shared_ptr<const RecordingSession> session = getSession(request);
+	if (!session) {
+		return;
+	}
+
+	std::ostringstream summary;
+	summary << "{\"session\": " << session->id << ", \"measurements\": "
+			<< session->samples.getStored() << ", \"values\": [";
+
+	bool first = true;
+	for (uint8_t i = 0; i < SENSOR_VALUES; i++) {
+		const ChannelStatistics &channel = session->statistics[i];
+		if (channel.getCount() == 0) {
+			continue;
+		}
+
+		if (!first) {
+			summary << ", ";
+		}
+		first = false;
+
+		summary << "{\"name\": \"" << SENSOR_VALUE_NAMES[i]
+				<< "\", \"unit\": \"" << SENSOR_VALUE_UNITS[i]
+				<< "\", \"count\": " << channel.getCount() << ", \"min\": "
+				<< channel.getMin() << ", \"min_time\": "
+				<< channel.getMinTime() << ", \"max\": " << channel.getMax()
+				<< ", \"max_time\": " << channel.getMaxTime()
+				<< ", \"mean\": " << channel.getMean() << ", \"variance\": "
+				<< channel.getVariance() << ", \"rms\": " << channel.getRms()
+				<< '}';
+	}
+	summary << "]}";
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", summary.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
+
+void LSM9DS1Handler::sendSpectrumJson(AsyncWebServerRequest *request) {
+	const std::shared_ptr<const RecordingSession> session = getSession(request);
+	if (!session) {
+		return;
+	} else if (session->samples.getStored() == 0
+			|| session->state != SESSION_READY || spectrum_calculating) {
+		AsyncWebServerResponse *response = request->beginResponse_P(503,
+				"text/html", unavailable_html);
+		response->addHeader("Retry-After", "5");
+		request->send(response);
+		return;
+	}
+
+	uint8_t value = SENSOR_VALUES;
+	if (request->hasArg("channel")) {
+		const String channel = request->arg("channel");
+		for (uint8_t i = 0; i < SENSOR_VALUES; i++) {
+			if (channel == SPECTRUM_CHANNEL_NAMES[i]
+					|| channel == SENSOR_VALUE_NAMES[i]) {
+				value = i;
+				break;
+			}
+		}
+	}
+
+	if (value == SENSOR_VALUES) {
+		request->send(400, "text/plain",
+				"Missing or unknown channel, expected one of ax, ay, az, gx, gy, gz, mx, my, or mz.");
+		return;
+	}
+
+	const SensorChannel channel = (SensorChannel) (1 << (value / 3));
+	if (!session->isRecorded(channel)) {
+		sendNotRecorded(request, channel == CHANNEL_ACCELEROMETER ?
+				"accelerometer" : channel == CHANNEL_GYROSCOPE ?
+						"gyroscope" : "magnetometer");
+		return;
+	}
+
+	uint16_t nfft = 1024;
+	if (request->hasArg("nfft")) {
+		nfft = request->arg("nfft").toInt();
+	}
+
+	if (nfft < 16 || nfft > SPECTRUM_MAX_NFFT || (nfft & (nfft - 1)) != 0) {
+		std::ostringstream message;
+		message << "nfft has to be a power of two between 16 and "
+				<< SPECTRUM_MAX_NFFT << '.';
+		request->send(400, "text/plain", message.str().c_str());
+		return;
+	}
+
+	const SampleStream *stream = &session->samples;
+	uint8_t index = session->getChannelIndex(channel) + value % 3;
+	if (channel == CHANNEL_MAGNETOMETER && session->separate_mag) {
+		stream = &session->mag_samples;
+		index = 1 + value % 3;
+	}
+
+	const SampleRange range = getSampleRange(request, *session, *stream);
+	const uint32_t start = range.start;
+	const uint32_t end = range.end;
+	if (end - start < nfft) {
+		std::ostringstream message;
+		message << "The selected range only contains " << end - start
+				<< " samples, but at least nfft(" << nfft
+				<< ") are required.";
+		request->send(400, "text/plain", message.str().c_str());
+		return;
+	}
+
+	spectrum_calculating = true;
+	std::shared_ptr<SpectrumParameter> parameter = std::make_shared<
+			SpectrumParameter>(this, session, stream, value, index, nfft,
+			start, end, &spectrum_calculating);
+
+	// The task keeps its own reference, so the parameter outlives a disconnected client.
+	std::shared_ptr<SpectrumParameter> *task_parameter = new std::shared_ptr<
+			SpectrumParameter>(parameter);
+	if (xTaskCreatePinnedToCore(spectrumCalculator, "spectrum", 4096,
+			task_parameter, 1, NULL, SPECTRUM_CORE) != pdPASS) {
+		delete task_parameter;
+		spectrum_calculating = false;
+		request->send(500, "text/plain", "Failed to start the spectrum calculation.");
+		return;
+	}
+
+	metrics->onDisconnect(request, [parameter]() {
+		parameter->aborted = true;
+	});
+
+	AsyncWebServerResponse *response = request->beginChunkedResponse(
+			"application/json",
+			metrics->countSent(request,
+				[parameter](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+					if (!parameter->done) {
+						return RESPONSE_TRY_AGAIN;
+					}
+
+					const size_t length = min(maxLen,
+							parameter->result.length() - parameter->sent);
+					memcpy(buffer, parameter->result.c_str() + parameter->sent, length);
+					parameter->sent += length;
+					return length;
+				}));
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
+
+void LSM9DS1Handler::sendFusionBenchmarkJson(
+		AsyncWebServerRequest *request) {
+	const std::shared_ptr<const RecordingSession> session = getSession(request);
+	if (!session) {
+		return;
+	} else if (session->state != SESSION_READY || fusion_benchmark_running) {
+		AsyncWebServerResponse *response = request->beginResponse_P(503,
+				"text/html", unavailable_html);
+		response->addHeader("Retry-After", "5");
+		request->send(response);
+		return;
+	} else if (!session->isRecorded(CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE)) {
+		sendNotRecorded(request, "accelerometer and gyroscope");
+		return;
+	}
+
+	// The rates and errors are averaged over the samples, so there has to be at least one.
+	const SampleRange range = getSampleRange(request, *session,
+			session->samples);
+	if (range.start >= range.end) {
+		request->send(400, "text/plain",
+				"The selected range doesn't contain any samples.");
+		return;
+	}
+
+	fusion_benchmark_running = true;
+	std::shared_ptr<FusionBenchmarkParameter> parameter = std::make_shared<
+			FusionBenchmarkParameter>(session, range.start, range.end,
+			&fusion_benchmark_running, metrics);
+
+	// The task keeps its own reference, so the parameter outlives a disconnected client.
+	std::shared_ptr<FusionBenchmarkParameter> *task_parameter =
+			new std::shared_ptr<FusionBenchmarkParameter>(parameter);
+	if (xTaskCreatePinnedToCore(fusionBenchmark, "fusion benchmark", 6144,
+			task_parameter, 1, NULL, SPECTRUM_CORE) != pdPASS) {
+		delete task_parameter;
+		fusion_benchmark_running = false;
+		request->send(500, "text/plain", "Failed to start the fusion benchmark.");
+		return;
+	}
+
+	metrics->onDisconnect(request, [parameter]() {
+		parameter->aborted = true;
+	});
+
+	AsyncWebServerResponse *response = request->beginChunkedResponse(
+			"application/json",
+			metrics->countSent(request,
+				[parameter](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+					if (!parameter->done) {
+						return RESPONSE_TRY_AGAIN;
+					}
+
+					const size_t length = min(maxLen,
+							parameter->result.length() - parameter->sent);
+					memcpy(buffer, parameter->result.c_str() + parameter->sent, length);
+					parameter->sent += length;
+					return length;
+				}));
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
+
+void LSM9DS1Handler::sendOverviewJson(AsyncWebServerRequest *request) const {
+	const std::shared_ptr<const RecordingSession> session = getSession(request);
+	if (!session) {
+		return;
+	} else if (!session->overview.isValid()
+			|| session->overview.getCount() == 0
+			|| session->state == SESSION_CALCULATING) {
+		AsyncWebServerResponse *response = request->beginResponse_P(503,
+				"text/html", unavailable_html);
+		response->addHeader("Retry-After", "5");
+		request->send(response);
+		return;
+	}
+
+	uint32_t points = 1000;
+	if (request->hasArg("points")) {
+		points = request->arg("points").toInt();
+	}
+	points = max((uint32_t) 1, min(points, (uint32_t) 10000));
+
+	std::shared_ptr<OverviewParameter> parameter = std::make_shared<
+			OverviewParameter>();
+	parameter->session = session;
+	for (const OverviewPyramid *pyramid : { &session->overview,
+			&session->mag_overview }) {
+		if (!pyramid->isValid() || pyramid->getCount() == 0) {
+			continue;
+		}
+
+		const bool mag_stream = pyramid == &session->mag_overview;
+		OverviewParameter::Stream stream;
+		stream.pyramid = pyramid;
+		stream.samples = mag_stream ? &session->mag_samples : &session->samples;
+		const SampleStream &stream_samples = *stream.samples;
+
+		// The sensors are stored in the same order as their statistics, skipping the ones not recorded.
+		for (uint8_t sensor = 0; sensor < 3; sensor++) {
+			const bool in_stream = (sensor == 2 && session->separate_mag)
+					== mag_stream;
+			if ((session->channels & (1 << sensor)) && in_stream) {
+				for (uint8_t i = 0; i < 3; i++) {
+					stream.values.push_back(sensor * 3 + i);
+				}
+			}
+		}
+
+		// Only use the samples already added to the pyramid, in case this is called while recording.
+		const SampleRange range = getSampleRange(request, *session,
+				stream_samples);
+		stream.start = range.start;
+		stream.end = min(range.end, pyramid->getCount());
+		if (stream.start >= stream.end) {
+			continue;
+		}
+		stream.bucket_samples = OverviewPyramid::getBucketSamples(
+				stream.end - stream.start, points);
+		parameter->streams.push_back(stream);
+	}
+
+	parameter->pending = "{\"streams\": [";
+
+	AsyncWebServerResponse *response = request->beginChunkedResponse(
+			"application/json",
+			metrics->countSent(request,
+				[this, parameter](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+					OverviewParameter &param = *parameter;
+					float min_values[SENSOR_VALUES];
+					float max_values[SENSOR_VALUES];
+					float mean_values[SENSOR_VALUES];
+					std::ostringstream json;
+
+					// Only generate as many buckets as fit into this chunk.
+					while (param.pending.length() + json.tellp() < maxLen
+							&& param.stream <= param.streams.size()) {
+						if (param.stream == param.streams.size()) {
+							json << "]}";
+							param.stream++;
+							break;
+						}
+
+						const OverviewParameter::Stream &stream = param.streams[param.stream];
+						if (!param.started) {
+							if (param.stream > 0) {
+								json << ", ";
+							}
+							json << "{\"values\": [";
+							for (size_t i = 0; i < stream.values.size(); i++) {
+								json << (i > 0 ? ", \"" : "\"")
+										<< SENSOR_VALUE_NAMES[stream.values[i]] << '"';
+							}
+							json << "], \"bucket_samples\": " << stream.bucket_samples
+									<< ", \"buckets\": [";
+							param.position = stream.start;
+							param.started = true;
+						}
+
+						if (param.position >= stream.end) {
+							json << "]}";
+							param.stream++;
+							param.started = false;
+							continue;
+						}
+
+						// Align the buckets to multiples of their size, so full buckets map to a single pyramid bucket.
+						const uint32_t bucket_end = min(stream.end,
+								(param.position / stream.bucket_samples + 1)
+										* stream.bucket_samples);
+						stream.pyramid->aggregate(param.position, bucket_end,
+								min_values, max_values, mean_values);
+
+						json << (param.position > stream.start ? ", [" : "[")
+								<< stream.samples->getTimestamp(param.position);
+						for (size_t i = 0; i < stream.values.size(); i++) {
+							json << ", " << min_values[i] << ", " << max_values[i]
+									<< ", " << mean_values[i];
+						}
+						json << ']';
+						param.position = bucket_end;
+					}
+
+					param.pending += json.str();
+					const size_t length = min(maxLen, param.pending.length());
+					memcpy(buffer, param.pending.c_str(), length);
+					param.pending.erase(0, length);
+					return length;
+				}));
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
+
+SampleRange LSM9DS1Handler::getSampleRange(AsyncWebServerRequest *request,
+		const RecordingSession &session, const SampleStream &samples) const {
+	const uint32_t stored = samples.getStored();
+	SampleRange range = { 0, stored, 0 };
+	if (stored == 0) {
+		return range;
+	}
+
+	// The results page sends empty arguments for empty input fields.
+	auto hasArg = [request](const char *name) -> bool {
+		return request->hasArg(name) && request->arg(name).length() > 0;
+	};
+
+	bool has_from = hasArg("from_ms");
+	bool has_to = hasArg("to_ms");
+	float from = has_from ? request->arg("from_ms").toFloat() : 0;
+	float to = has_to ? request->arg("to_ms").toFloat() : 0;
+
+	// Events are looked up by their index, so jumping to one doesn't depend on the length of the recording.
+	if (hasArg("event")) {
+		const uint32_t event = request->arg("event").toInt();
+		if (event < session.events.getCount()) {
+			float around = 500;
+			if (hasArg("around_ms")) {
+				around = max(0.0f, request->arg("around_ms").toFloat());
+			}
+
+			const float peak = session.events.getEvent(event).timestamp;
+			if (!has_from) {
+				from = peak - around;
+				has_from = true;
+			}
+			if (!has_to) {
+				to = peak + around;
+				has_to = true;
+			}
+		}
+	}
+
+	if (hasArg("from_index")) {
+		range.start = min((uint32_t) request->arg("from_index").toInt(), stored);
+	} else if (has_from) {
+		// Find returns the last sample at or before the timestamp, but the slice should start after it.
+		range.start = samples.find(from);
+		if (samples.getTimestamp(range.start) < from) {
+			range.start++;
+		}
+	}
+
+	if (hasArg("to_index")) {
+		range.end = min((uint32_t) request->arg("to_index").toInt(), stored);
+	} else if (has_to) {
+		range.end = samples.find(to, range.start);
+		if (samples.getTimestamp(range.end) <= to) {
+			range.end++;
+		}
+	}
+
+	range.end = max(range.start, range.end);
+	range.warmup = range.start;
+	if (range.start > 0 && range.start < stored) {
+		range.warmup = samples.find(
+				samples.getTimestamp(range.start) - CSV_WARMUP_MS);
+	}
+
+	return range;
+}
+
+size_t LSM9DS1Handler::getMeasurementCsvSize(const SampleStream &samples,
+		const SampleRange &range, const ValueGenerator content_generator,
+		const std::vector<const char*> headers, const uint16_t step) const {
+	const size_t buffer_size = 5000;
+	char *buffer = new char[buffer_size];
+	uint32_t position = range.start;
+	size_t size = 0;
+	do {
+		size += generateMeasurementCsv(',', position, samples, range,
+				content_generator, headers, buffer, buffer_size, step);
+	} while (position < range.end);
+
+	delete[] buffer;
+	return size;
+}
+
+void LSM9DS1Handler::restoreRecording() {
+	RecordingInfo info;
+	const float *streams[RECORDING_STREAMS];
+	if (!recording_store.load(info, streams)) {
+		return;
+	}
+
+	// The sample streams stay in flash, so the slot only has to fit the overview pyramids.
+	const size_t overview_required = OverviewPyramid::getSize(info.counts[0],
+			info.strides[0]);
+	const size_t mag_overview_required = OverviewPyramid::getSize(
+			info.counts[1], info.strides[1]);
+	const size_t size = overview_required + mag_overview_required
+			+ EventIndex::getSize(MAX_EVENTS);
+	float *slot = allocator.allocate(size);
+
+	uint32_t id;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		id = next_session_id++;
+	}
+
+	std::shared_ptr<RecordingSession> session = std::make_shared<
+			RecordingSession>(id, &allocator, slot, size);
+
+	// The mapped streams are full, so they are never written to.
+	session->channels = info.channels;
+	session->separate_mag = info.separate_mag;
+	session->frequency = info.frequency;
+	session->duration = info.duration;
+	session->measuring_time = info.measuring_time;
+	session->measurements = info.counts[0];
+	session->group = id;
+	session->samples.reset((float*) streams[0], info.strides[0],
+			info.counts[0], info.counts[0]);
+	session->mag_samples.reset((float*) streams[1], info.strides[1],
+			info.counts[1], info.counts[1]);
+
+	// The events aren't persisted, so they are detected again with the current settings.
+	session->events.reset(
+			slot == NULL ?
+					NULL : slot + overview_required + mag_overview_required,
+			MAX_EVENTS, event_settings);
+	const uint8_t main_channels =
+			info.separate_mag ?
+					info.channels & ~CHANNEL_MAGNETOMETER : info.channels;
+
+	const SampleStream &samples = session->samples;
+	float measurement[SampleStream::MAX_STRIDE];
+	for (uint32_t position = 0; position < samples.getStored(); position++) {
+		samples.getValues(position, 0, samples.getStride(), measurement);
+		detectEvents(session->events, main_channels, measurement, position);
+		uint8_t index = 1;
+		for (uint8_t sensor = 0; index < samples.getStride(); sensor++) {
+			if (info.channels & (1 << sensor)) {
+				for (uint8_t i = 0; i < 3; i++) {
+					session->statistics[sensor * 3 + i].update(
+							measurement[index++], measurement[0]);
+				}
+			}
+		}
+	}
+
+	const SampleStream &mag_samples = session->mag_samples;
+	for (uint32_t position = 0; position < mag_samples.getStored(); position++) {
+		mag_samples.getValues(position, 0, 4, measurement);
+		detectEvents(session->events, CHANNEL_MAGNETOMETER, measurement,
+				position);
+		for (uint8_t i = 0; i < 3; i++) {
+			session->statistics[6 + i].update(measurement[i + 1],
+					measurement[0]);
+		}
+	}
+
+	if (slot != NULL) {
+		session->overview.reset(slot, &session->samples);
+		session->mag_overview.reset(slot + overview_required,
+				&session->mag_samples);
+		session->overview.update();
+		session->mag_overview.update();
+	} else {
+		Serial.println("Not enough free memory for the overview of the persisted recording.");
+	}
+
+	session->restored = true;
+	session->state = SESSION_CALCULATING;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		sessions.push_back(session);
+		current = session;
+		restored_session = session;
+	}
+	persist_state = PERSIST_DONE;
+	persisted_session = session->id;
+	xEventGroupSetBits(eventGroup, CALCULATE_START_BIT);
+
+	Serial.print("Loaded a persisted recording with ");
+	Serial.print(info.counts[0]);
+	Serial.println(" measurements from flash.");
+}
+
+void LSM9DS1Handler::persistTask(void *parameter) {
+	PersistParameter *param = (PersistParameter*) parameter;
+	LSM9DS1Handler *lsm9ds1 = param->handler;
+	const RecordingSession &session = *param->session;
+	const float *const streams[RECORDING_STREAMS] = { session.samples.getData(),
+			session.mag_samples.getData() };
+	if (lsm9ds1->recording_store.write(session.getRecordingInfo(), streams)) {
+		lsm9ds1->persist_state = PERSIST_DONE;
+	} else {
+		lsm9ds1->persist_state = PERSIST_FAILED;
+	}
+
+	lsm9ds1->metrics->recordStack("persist");
+	delete param;
+	vTaskDelete(NULL);
+}
+
+void LSM9DS1Handler::persist(AsyncWebServerRequest *request) {
+	if (flash_partition.getSize() == 0) {
+		request->send(503, "text/plain",
+				"There is no recording partition to persist recordings to.");
+		return;
+	}
+
+	// Erasing and writing the flash disables the cache of both cores, which would stall the reader task.
+	if (measuring) {
+		request->send(409, "text/plain",
+				"A recording or stream is in progress, recordings can only be persisted while idle.");
+		return;
+	}
 
-	while (!lsm.begin()) {
-		Serial.println("Failed to initialize the LSM9DS1. Check your wiring!");
-		delay(1000);
+	const std::shared_ptr<const RecordingSession> session = getSession(request);
+	if (!session) {
+		return;
+	} else if (session->samples.getStored() == 0
+			|| session->state == SESSION_RECORDING) {
+		request->send(409, "text/plain",
+				"There is no finished recording to persist.");
+		return;
+	} else if (session->samples.isPaged()) {
+		request->send(507, "text/plain",
+				"Recordings stored in himem are too large for the recording partition.");
+		return;
+	} else if (persist_state == PERSIST_WRITING
+			|| (persisted_session == session->id
+					&& persist_state == PERSIST_DONE)) {
+		// Already in flash, or being written to it.
+		sendPersistJson(request);
+		return;
 	}
 
-#ifdef LSM9DS1_I2C
-	Serial.println("Connected to the lsm9ds1 using I2C.");
-#elif defined(LSM9DS1_SPI)
-	Serial.println("Connected to the lsm9ds1 using SPI.");
-#endif
+	// The restored session reads its samples from the partition, so it can't be overwritten while it exists.
+	std::shared_ptr<RecordingSession> restored;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		restored = restored_session.lock();
+	}
+	if (restored) {
+		std::ostringstream message;
+		message << "The recording partition is in use by the restored session "
+				<< restored->id << ", delete it first.";
+		request->send(409, "text/plain", message.str().c_str());
+		return;
+	}
 
-	setupSensor();
+	const size_t required = recording_store.getRequiredSize(
+			session->getRecordingInfo());
+	if (required > flash_partition.getSize()) {
+		std::ostringstream message;
+		message << "The recording requires " << required
+				<< " bytes, but the recording partition only has "
+				<< flash_partition.getSize() << '.';
+		request->send(507, "text/plain", message.str().c_str());
+		return;
+	}
 
-#ifdef LSM9DS1_I2C
-	Wire.setClock(400000);
-#endif
+	// The task keeps its own reference, so the session can be deleted while it is being written.
+	persist_state = PERSIST_WRITING;
+	persisted_session = session->id;
+	PersistParameter *parameter = new PersistParameter { this, session };
+	if (xTaskCreate(persistTask, "persist", 4096, parameter, 1, NULL)
+			!= pdPASS) {
+		delete parameter;
+		persist_state = PERSIST_FAILED;
+	}
+	sendPersistJson(request);
 }
 
-void LSM9DS1Handler::setupSensor() {
-	lsm.setupAccel(lsm.LSM9DS1_ACCELRANGE_2G);
+void LSM9DS1Handler::sendPersistJson(AsyncWebServerRequest *request) const {
+	static const char *STATE_NAMES[] = { "idle", "writing", "done", "failed" };
 
-	lsm.setupMag(lsm.LSM9DS1_MAGGAIN_4GAUSS);
+	const std::shared_ptr<const RecordingSession> session = getSession(request);
+	if (!session) {
+		return;
+	}
 
-	lsm.setupGyro(lsm.LSM9DS1_GYROSCALE_245DPS);
+	// The state is that of the last session written to flash, other sessions weren't persisted.
+	const PersistState state =
+			persisted_session == session->id ? persist_state : PERSIST_IDLE;
+	std::ostringstream json;
+	json << "{\"session\": " << session->id << ", \"state\": \""
+			<< STATE_NAMES[state] << "\", \"written\": "
+			<< (state == PERSIST_IDLE ? 0 : recording_store.getWritten())
+			<< ", \"size\": "
+			<< (session->samples.getStored() == 0 ?
+					0 : recording_store.getRequiredSize(session->getRecordingInfo()))
+			<< ", \"partition_size\": " << flash_partition.getSize()
+			<< ", \"restored\": " << (session->restored ? "true" : "false")
+			<< '}';
+
+	AsyncWebServerResponse *response = request->beginResponse(
+			state == PERSIST_WRITING ? 202 : 200, "application/json",
+			json.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
 }
 
-void LSM9DS1Handler::loop() {
-	if (measuring) {
-		if (measurements_stored >= measurements) {
-			measuring = false;
-			measurement_duration = millis() - measurement_start;
-			measuring_time = measurement_duration * 1000 / measurements;
-			calculating = true;
-			return;
+void LSM9DS1Handler::sendSessionsJson(AsyncWebServerRequest *request) const {
+	static const char *STATE_NAMES[] = { "recording", "calculating", "ready" };
+
+	std::ostringstream json;
+	json << "{\"size\": " << allocator.getSize() * sizeof(float)
+			<< ", \"free\": " << allocator.getFree() * sizeof(float)
+			<< ", \"largest_free\": "
+			<< allocator.getLargestFree() * sizeof(float)
+			<< ", \"himem_size\": " << himem_allocator.getSize() * sizeof(float)
+			<< ", \"himem_free\": " << himem_allocator.getFree() * sizeof(float)
+			<< ", \"himem_largest_free\": "
+			<< himem_allocator.getLargestFree() * sizeof(float)
+			<< ", \"max_measurements\": " << getMaxMeasurements()
+			<< ", \"sessions\": [";
+
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		for (size_t i = 0; i < sessions.size(); i++) {
+			const std::shared_ptr<RecordingSession> &session = sessions[i];
+
+			// References other than the list, current, and recording are exports and calculations.
+			const long exports = session.use_count() - 1
+					- (session == current ? 1 : 0)
+					- (isRecording(session) ? 1 : 0);
+			json << (i > 0 ? ", " : "") << "{\"id\": " << session->id
+					<< ", \"state\": \"" << STATE_NAMES[session->state]
+					<< "\", \"current\": "
+					<< (session == current ? "true" : "false")
+					<< ", \"restored\": "
+					<< (session->restored ? "true" : "false")
+					<< ", \"sensor\": " << (uint16_t) session->sensor
+					<< ", \"sensors\": " << (uint16_t) session->sensors
+					<< ", \"group\": " << session->group
+					<< ", \"channels\": " << (uint16_t) session->channels
+					<< ", \"frequency\": " << session->frequency
+					<< ", \"measurements\": " << session->samples.getStored()
+					<< ", \"capacity\": " << session->measurements
+					<< ", \"duration\": " << session->duration
+					<< ", \"size\": " << session->size * sizeof(float)
+					<< ", \"himem_size\": " << session->paged_size * sizeof(float)
+					<< ", \"references\": " << exports << ", \"rendered\": [";
+			bool first = true;
+			for (uint8_t csv = 0; csv < MEASUREMENT_CSVS; csv++) {
+				if (session->rendered[csv] && session->rendered[csv]->isComplete()) {
+					json << (first ? "\"" : ", \"") << MEASUREMENT_CSV_NAMES[csv]
+							<< '"';
+					first = false;
+				}
+			}
+			json << "]}";
 		}
+	}
+	json << "]}";
 
-		const uint64_t start_us = micros();
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", json.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
+
+void LSM9DS1Handler::deleteSession(AsyncWebServerRequest *request) {
+	if (!request->hasArg("session")) {
+		request->send(400, "text/plain",
+				"Missing the id of the session to delete.");
+		return;
+	}
 
-		sensors_event_t a, m, g, t;
-		lsm.getEvent(&a, &m, &g, &t);
+	std::shared_ptr<RecordingSession> session = getSession(request);
+	if (!session) {
+		return;
+	}
 
-		if (measurements_stored > 0 && a.timestamp == last_timestamp) {
-			return;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		if (isRecording(session)) {
+			endRecording();
 		}
 
-		last_timestamp = a.timestamp;
-
-		data[measurements_stored * VALUES_PER_MEASUREMENT] = a.timestamp
-				- measurement_start;
-
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 1] =
-				a.acceleration.x;
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 2] =
-				a.acceleration.y;
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 3] =
-				a.acceleration.z;
-
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 4] = g.gyro.x;
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 5] = g.gyro.y;
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 6] = g.gyro.z;
-
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 7] = m.magnetic.x;
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 8] = m.magnetic.y;
-		data[measurements_stored * VALUES_PER_MEASUREMENT + 9] = m.magnetic.z;
-
-		measurements_stored++;
-
-		if (measurements_stored > 1) {
-			const uint32_t measurements_avg_count = min(measurements_stored,
-					(uint32_t) 10);
-
-			const float last_measurements_time_ms = data[(measurements_stored - 1)
-					* VALUES_PER_MEASUREMENT]
-					- data[(measurements_stored - measurements_avg_count)
-							* VALUES_PER_MEASUREMENT];
-
-			measuring_time = round(
-					last_measurements_time_ms * 1000
-							/ (measurements_avg_count - 1));
-		}
-
-		const uint64_t end_us = micros();
-		delayMicroseconds(
-				measuring_time_target
-						- min(measuring_time_target,
-								(uint32_t) (end_us - start_us)));
-	} else if (calculating) {
-		const uint64_t start = millis();
-		const uint8_t separator = ',';
-		uint32_t pos = 0;
-		size_t size = 0;
-		std::function<size_t(char*, const uint8_t, const uint32_t)> content_generator;
-		std::vector<const char*> headers;
-
-		switch(calculated) {
-		case 0:
-			calculation_start = start;
-			file_calculating = "all.csv";
-			content_generator = getAllGenerator();
-			headers = { "Acceleration X(m/s^2)", "Acceleration Y(m/s^2)",
-					"Acceleration Z(m/s^2)", "Linear Acceleration X(m/s^2)",
-					"Linear Acceleration Y(m/s^2)",
-					"Linear Acceleration Z(m/s^2)", "Rotation X(rad/s)",
-					"Rotation Y(rad/s)", "Rotation Z(rad/s)", "Magnetic X(uT)",
-					"Magnetic Y(uT)", "Magnetic Z(uT)" };
-			break;
-		case 1:
-			file_calculating = "accelerometer.csv";
-			content_generator = getDataContentGenerator(1, 3);
-			headers = { "Acceleration X(m/s^2)", "Acceleration Y(m/s^2)",
-					"Acceleration Z(m/s^2)" };
-			break;
-		case 2:
-			file_calculating = "linear_accelerometer.csv";
-			content_generator = getLinearAccelerationGenerator();
-			headers = { "Linear Acceleration X(m/s^2)",
-					"Linear Acceleration Y(m/s^2)",
-					"Linear Acceleration Z(m/s^2)" };
-			break;
-		case 3:
-			file_calculating = "gyroscope.csv";
-			content_generator = getDataContentGenerator(4, 3);
-			headers = { "Rotation X(rad/s)", "Rotation Y(rad/s)",
-					"Rotation Z(rad/s)" };
-			break;
-		case 4:
-			file_calculating = "magnetometer.csv";
-			content_generator = getDataContentGenerator(7, 3);
-			headers = { "Magnetic X(uT)", "Magnetic Y(uT)", "Magnetic Z(uT)" };
-			break;
-		default:
-			Serial.print("Trying to calculate size for unknown measurements csv with id ");
-			Serial.print(calculated);
-			Serial.println('.');
-			calculating = false;
+		for (std::vector<std::shared_ptr<RecordingSession>>::iterator it =
+				sessions.begin(); it != sessions.end(); it++) {
+			if (*it == session) {
+				sessions.erase(it);
+				break;
+			}
+		}
+
+		if (current == session) {
+			current.reset();
+		}
+	}
+
+	// The memory is reclaimed when the last export of the session releases it.
+	session.reset();
+	sendSessionsJson(request);
+}
+
+void LSM9DS1Handler::sendEventsJson(AsyncWebServerRequest *request) const {
+	// Without a session argument this also responds if there is no current session, to show the settings.
+	std::shared_ptr<const RecordingSession> session;
+	if (request->hasArg("session")) {
+		session = getSession(request);
+		if (!session) {
 			return;
 		}
+	} else {
+		session = getCurrentSession();
+	}
+
+	const uint32_t count = session ? session->events.getCount() : 0;
+	uint32_t from = 0;
+	if (request->hasArg("from")) {
+		from = min((uint32_t) request->arg("from").toInt(), count);
+	}
+
+	uint32_t limit = MAX_EVENTS_PER_REQUEST;
+	if (request->hasArg("count")) {
+		limit = min((uint32_t) request->arg("count").toInt(), limit);
+	}
+	const uint32_t to = from + min(limit, count - from);
+
+	std::ostringstream json;
+	json << "{\"session\": " << (session ? session->id : 0) << ", \"settings\": {";
+	const EventSettings &settings =
+			session ? session->events.getSettings() : event_settings;
+	for (uint8_t sensor = 0; sensor < EventIndex::SENSORS; sensor++) {
+		json << '"' << EVENT_SENSOR_NAMES[sensor] << "\": "
+				<< settings.thresholds[sensor] << ", ";
+	}
+	json << "\"hysteresis\": " << settings.hysteresis << "}, \"capacity\": "
+			<< (session ? session->events.getCapacity() : 0) << ", \"total\": "
+			<< count << ", \"dropped\": "
+			<< (session ? session->events.getDropped() : 0) << ", \"from\": "
+			<< from << ", \"events\": [";
+
+	for (uint32_t i = from; i < to; i++) {
+		const SensorEvent event = session->events.getEvent(i);
+		json << (i > from ? ", " : "") << "{\"event\": " << i
+				<< ", \"sensor\": \"" << EVENT_SENSOR_NAMES[event.sensor]
+				<< "\", \"index\": " << event.index << ", \"time\": "
+				<< event.timestamp << ", \"peak\": " << event.peak
+				<< ", \"samples\": " << event.samples << '}';
+	}
+	json << "]}";
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", json.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
 
-		const size_t buffer_size = 5000;
-		char *buffer = new char[buffer_size];
-		while (pos < measurements) {
-			size += generateMeasurementCsv(separator, pos,
-					content_generator, headers, buffer, buffer_size);
+void LSM9DS1Handler::setEventSettings(AsyncWebServerRequest *request) {
+	EventSettings settings = event_settings;
+	for (uint8_t sensor = 0; sensor < EventIndex::SENSORS; sensor++) {
+		if (request->hasArg(EVENT_SENSOR_NAMES[sensor])) {
+			settings.thresholds[sensor] = max(0.0f,
+					request->arg(EVENT_SENSOR_NAMES[sensor]).toFloat());
 		}
+	}
 
-		delete[] buffer;
+	if (request->hasArg("hysteresis")) {
+		settings.hysteresis = max(0.0f,
+				min(request->arg("hysteresis").toFloat(), 1.0f));
+	}
 
-		switch(calculated) {
-		case 0:
-			all_csv_size = size;
-			break;
-		case 1:
-			acc_csv_size = size;
-			break;
-		case 2:
-			lin_acc_csv_size = size;
-			break;
-		case 3:
-			gyro_csv_size = size;
-			break;
-		case 4:
-			mag_csv_size = size;
-			break;
-		default:
-			Serial.print("Trying to calculate size for unknown measurements csv with id ");
-			Serial.print(calculated);
-			Serial.println('.');
-			calculating = false;
-			file_calculating = "";
-			calculated = 0;
+	// Sessions copy the settings when they are started, so this doesn't affect the one being recorded.
+	event_settings = settings;
+
+	std::ostringstream json;
+	json << '{';
+	for (uint8_t sensor = 0; sensor < EventIndex::SENSORS; sensor++) {
+		json << '"' << EVENT_SENSOR_NAMES[sensor] << "\": "
+				<< settings.thresholds[sensor] << ", ";
+	}
+	json << "\"hysteresis\": " << settings.hysteresis << '}';
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", json.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
+
+void LSM9DS1Handler::startStream(AsyncWebServerRequest *request) {
+	if (!request->hasArg("host") || request->arg("host").length() == 0
+			|| !request->hasArg("port")) {
+		request->send(400, "text/plain",
+				"Missing the host or port of the collector to stream to.");
+		return;
+	}
+
+	const long port = request->arg("port").toInt();
+	if (port <= 0 || port > 65535) {
+		request->send(400, "text/plain", "Invalid collector port.");
+		return;
+	}
+
+	bool recording;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		recording = recordings[0] != nullptr;
+	}
+
+	if (recording) {
+		request->send(409, "text/plain",
+				"A recording is in progress, stop it before starting a stream.");
+		return;
+	} else if (isPersisting()) {
+		request->send(409, "text/plain",
+				"A recording is being persisted, wait until it is written.");
+		return;
+	} else if (streamer.getState() != STREAM_IDLE) {
+		request->send(409, "text/plain",
+				"A stream is still running, stop it first.");
+		return;
+	}
+
+	uint8_t channels = CHANNEL_ALL;
+	if (request->hasArg("channels")) {
+		channels = request->arg("channels").toInt() & CHANNEL_ALL;
+		if (channels == 0) {
+			channels = CHANNEL_ALL;
 		}
+	}
+
+	uint16_t freq = 100;
+	if (request->hasArg("rate")) {
+		freq = max(1l, min(request->arg("rate").toInt(), 1000l));
+	}
+	freq = min(freq, getMaxFrequency(channels));
 
-		calculated++;
-		if (calculated >= MEASUREMENT_CSVS) {
-			calculating = false;
+	uint8_t values = 0;
+	for (uint8_t channel = CHANNEL_ACCELEROMETER; channel <= CHANNEL_MAGNETOMETER;
+			channel <<= 1) {
+		if (channels & channel) {
+			values += 3;
 		}
-	} else {
-		xEventGroupWaitBits(eventGroup, MEASURE_START_BIT, pdTRUE, pdTRUE, 500);
 	}
+
+	// Pre-rendered csvs only use otherwise spare memory, so they make room for the backlog.
+	dropRenderedCsvs();
+
+	if (!streamer.start(request->arg("host").c_str(), port, channels, values,
+			freq, &allocator)) {
+		request->send(507, "text/plain",
+				"Not enough free memory for the stream backlog, delete a session from /sessions.json first.");
+		return;
+	}
+
+	// A stream stopped just before may still have samples in flight, so the storage task starts the reader once it stopped.
+	// Frames have a single layout, so the magnetometer is sent with every sample.
+	// Frames only have room for a single sensor.
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		stopReader();
+		reader_config = { channels, 1, false, freq, min(freq, MAG_ODR),
+				UINT32_MAX };
+		reader_start_pending = true;
+		streaming = true;
+	}
+	xEventGroupSetBits(eventGroup, STORE_START_BIT);
+
+	sendStreamJson(request);
 }
 
-void LSM9DS1Handler::measure(uint32_t measurements, uint16_t freq) {
-	measurements = min(measurements_max, measurements);
-	freq = max((uint16_t) 1, freq);
+void LSM9DS1Handler::stopStream(AsyncWebServerRequest *request) {
+	endStream();
+	sendStreamJson(request);
+}
 
-	measurements_stored = 0;
-	frequency = freq;
-	measuring_time_target = measuring_time = 1000000 / freq;
-	LSM9DS1Handler::measurements = measurements;
-	measuring = true;
+void LSM9DS1Handler::endStream() {
+	std::lock_guard<std::mutex> lock(sessions_mutex);
+	if (!streaming) {
+		return;
+	}
 
-	measurement_start = millis();
-	xEventGroupSetBits(eventGroup, MEASURE_START_BIT);
+	stopReader();
+	streaming = false;
+	streamer.stop();
 }
 
-const std::function<size_t(char*, const uint8_t, const uint32_t)> LSM9DS1Handler::getAllGenerator() const {
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> accel_gen =
-			getDataContentGenerator(1);
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> linear_accel_gen =
-			getLinearAccelerationGenerator();
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> gyromag_gen =
-			getDataContentGenerator(4, 6);
-	return [this, accel_gen, linear_accel_gen, gyromag_gen](char *buffer,
-			const uint8_t separator_char, const uint32_t position) -> size_t {
-		size_t length = accel_gen(buffer, separator_char, position);
-		length += linear_accel_gen(buffer + length, separator_char, position);
-		length += gyromag_gen(buffer + length, separator_char, position);
-
-		return length;
-	};
+void LSM9DS1Handler::sendStreamJson(AsyncWebServerRequest *request) const {
+	static const char *STATE_NAMES[] = { "idle", "connecting", "connected",
+			"stopping" };
+
+	const FrameBacklog &backlog = streamer.getBacklog();
+	std::ostringstream json;
+	json << "{\"state\": \"" << STATE_NAMES[streamer.getState()]
+			<< "\", \"host\": \"" << streamer.getHost() << "\", \"port\": "
+			<< streamer.getPort() << ", \"frequency\": "
+			<< (streaming ? reader_config.frequency : 0) << ", \"channels\": "
+			<< (streaming ? (uint16_t) reader_config.channels : 0)
+			<< ", \"samples\": "
+			<< streamer.getSamples() << ", \"frames\": "
+			<< streamer.getFramesSent() << ", \"bytes\": "
+			<< streamer.getBytesSent() << ", \"dropped\": "
+			<< streamer.getDropped() << ", \"connects\": "
+			<< streamer.getConnects() << ", \"backlog_size\": "
+			<< backlog.getSize() << ", \"backlog_used\": " << backlog.getUsed()
+			<< ", \"backlog_high_water\": " << backlog.getHighWater()
+			<< ", \"ring_overflows\": " << (streaming ? ring.getOverflows() : 0)
+			<< '}';
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", json.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
 }
 
-const std::function<size_t(char*, const uint8_t, const uint32_t)> LSM9DS1Handler::getLinearAccelerationGenerator() const {
-	std::shared_ptr<Adafruit_Madgwick> filter = std::make_shared<
-			Adafruit_Madgwick>();
-	// Tell the filter a lower sample rate to reduce smoothing.
-	filter->begin(round(1000000.0 / measuring_time) / 20);
-
-	return [this, filter](char *buffer, const uint8_t separator_char, const uint32_t position) -> size_t {
-		const float ax = data[position * VALUES_PER_MEASUREMENT + 1]
-				/ SENSORS_GRAVITY_EARTH;
-		const float ay = data[position * VALUES_PER_MEASUREMENT + 2]
-				/ SENSORS_GRAVITY_EARTH;
-		const float az = data[position * VALUES_PER_MEASUREMENT + 3]
-				/ SENSORS_GRAVITY_EARTH;
-
-		const float gx = data[position * VALUES_PER_MEASUREMENT + 4]
-				* SENSORS_RADS_TO_DPS;
-		const float gy = data[position * VALUES_PER_MEASUREMENT + 5]
-				* SENSORS_RADS_TO_DPS;
-		const float gz = data[position * VALUES_PER_MEASUREMENT + 6]
-				* SENSORS_RADS_TO_DPS;
-
-		filter->update(gx, gy, gz, ax, ay, az,
-				data[position * VALUES_PER_MEASUREMENT + 7],
-				data[position * VALUES_PER_MEASUREMENT + 8],
-				data[position * VALUES_PER_MEASUREMENT + 9]);
-
-		float qW, qX, qY, qZ;
-		filter->getQuaternion(&qW, &qX, &qY, &qZ);
-
-		// Calculate gravity
-		const float gravX = 2.0f * (qX * qZ - qW * qY);
-		const float gravY = 2.0f * (qW * qX + qY * qZ);
-		const float gravZ = 2.0f * (qW * qW - 0.5f + qZ * qZ);
-
-		// Calculate linear acceleration
-		const float linX = ax - gravX;
-		const float linY = ay - gravY;
-		const float linZ = az - gravZ;
-
-		return sprintf(buffer, "%c%f%c%f%c%f", separator_char,
-				linX * SENSORS_GRAVITY_EARTH, separator_char,
-				linY * SENSORS_GRAVITY_EARTH, separator_char,
-				linZ * SENSORS_GRAVITY_EARTH);
-	};
+void LSM9DS1Handler::sendSourceJson(AsyncWebServerRequest *request) const {
+	const SyntheticSettings &settings = synthetic_sources[0].getSettings();
+	const std::shared_ptr<const RecordingSession> replayed =
+			replay_source.getSession();
+	std::ostringstream json;
+	json << "{\"source\": \"" << sources[0]->getName()
+			<< "\", \"sensors\": " << (uint16_t) sensor_count
+			<< ", \"lsm9ds1_available\": "
+			<< (lsm_sources[0].isAvailable() ? "true" : "false")
+			<< ", \"lsm9ds1_connected\": " << (uint16_t) getConnectedSensors()
+			<< ", \"synthetic\": {\"odr\": " << settings.odr
+			<< ", \"vibration_frequency\": " << settings.vibration_frequency
+			<< ", \"vibration_amplitude\": " << settings.vibration_amplitude
+			<< ", \"rotation_amplitude\": " << settings.rotation_amplitude
+			<< ", \"noise\": " << settings.noise
+			<< ", \"shock_interval_ms\": " << settings.shock_interval_ms
+			<< ", \"shock_amplitude\": " << settings.shock_amplitude
+			<< ", \"seed\": " << settings.seed << "}, \"replay\": {\"session\": "
+			<< (replayed ? replayed->id : 0) << ", \"measurements\": "
+			<< (replayed ? replayed->samples.getStored() : 0) << "}}";
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", json.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
 }
 
-const std::function<size_t(char*, const uint8_t, const uint32_t)> LSM9DS1Handler::getDataContentGenerator(
-		const uint8_t index, uint8_t channels) const {
-	channels = min(VALUES_PER_MEASUREMENT, channels);
+void LSM9DS1Handler::setSource(AsyncWebServerRequest *request) {
+	// The reader task reads the sources without a lock, so they can only be changed while it is stopped.
+	// Recordings and streams are only started by the web server, so it can't start again while the source is changed.
+	bool stopped;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		stopped = isReaderStopped() && !reader_start_pending;
+	}
+
+	if (measuring || reader_start_pending) {
+		request->send(409, "text/plain",
+				"A recording or stream is in progress, stop it before changing the sensor source.");
+		return;
+	} else if (!stopped) {
+		request->send(409, "text/plain",
+				"The sensor source is still being read or probed, try again later.");
+		return;
+	}
 
-	return [this, index, channels](char *buffer, const uint8_t separator_char, const uint32_t position) -> size_t {
-		size_t length = 0;
-		for (uint8_t i = 0; i < channels; i++) {
-			length += sprintf(buffer + length, "%c%f", separator_char,
-					data[position * VALUES_PER_MEASUREMENT + index + i]);
+	const String name = request->hasArg("source") ?
+			request->arg("source") : String(sources[0]->getName());
+	long sensors = 1;
+	if (name == sources[0]->getName()) {
+		sensors = sensor_count;
+	} else if (name == lsm_sources[0].getName()) {
+		sensors = max((uint8_t) 1, getConnectedSensors());
+	}
+	if (request->hasArg("sensors")) {
+		sensors = request->arg("sensors").toInt();
+		if (sensors < 1 || sensors > MAX_SENSORS) {
+			request->send(400, "text/plain",
+					"The number of sensors has to be between 1 and 3.");
+			return;
 		}
+	}
 
-		return length;
-	};
-}
+	SensorSource *selected[MAX_SENSORS] = { };
+	if (name == lsm_sources[0].getName()) {
+		if (getConnectedSensors() < sensors) {
+			request->send(409, "text/plain",
+					"Not enough LSM9DS1 sensors are connected.");
+			return;
+		}
 
-void LSM9DS1Handler::sendMeasurementsCsv(AsyncWebServerRequest *request,
-		const std::function<size_t(char*, const uint8_t, const uint32_t)> content_generator,
-		const std::vector<const char*> headers,
-		const size_t content_len) const {
-	if (measurements_stored == 0 || measuring || calculating) {
-		AsyncWebServerResponse *response = request->beginResponse_P(503,
-				"text/html", unavailable_html);
-		if (measuring) {
-			std::ostringstream converter;
-			const uint32_t remaining_measuring_time = (measurements
-					- measurements_stored) * measuring_time / 1000000;
-			converter << remaining_measuring_time;
-			response->addHeader("Retry-After", converter.str().c_str());
-		} else {
-			response->addHeader("Retry-After", "5");
+		// Sensors that weren't found at boot are skipped, so the selected ones don't have to be the first ones.
+		uint8_t count = 0;
+		for (uint8_t sensor = 0; sensor < MAX_SENSORS && count < sensors;
+				sensor++) {
+			if (lsm_sources[sensor].isAvailable()) {
+				selected[count++] = &lsm_sources[sensor];
+			}
 		}
-		request->send(response);
+	} else if (name == synthetic_sources[0].getName()) {
+		SyntheticSettings settings = synthetic_sources[0].getSettings();
+		if (request->hasArg("odr")) {
+			settings.odr = max(0.0f, request->arg("odr").toFloat());
+		}
+		if (request->hasArg("vibration_frequency")) {
+			settings.vibration_frequency = max(0.0f,
+					request->arg("vibration_frequency").toFloat());
+		}
+		if (request->hasArg("vibration_amplitude")) {
+			settings.vibration_amplitude =
+					request->arg("vibration_amplitude").toFloat();
+		}
+		if (request->hasArg("rotation_amplitude")) {
+			settings.rotation_amplitude =
+					request->arg("rotation_amplitude").toFloat();
+		}
+		if (request->hasArg("noise")) {
+			settings.noise = max(0.0f, request->arg("noise").toFloat());
+		}
+		if (request->hasArg("shock_interval_ms")) {
+			settings.shock_interval_ms = max(0l,
+					request->arg("shock_interval_ms").toInt());
+		}
+		if (request->hasArg("shock_amplitude")) {
+			settings.shock_amplitude =
+					request->arg("shock_amplitude").toFloat();
+		}
+		if (request->hasArg("seed")) {
+			settings.seed = request->arg("seed").toInt();
+		}
+		for (uint8_t sensor = 0; sensor < sensors; sensor++) {
+			synthetic_sources[sensor].setSettings(settings);
+			selected[sensor] = &synthetic_sources[sensor];
+		}
+	} else if (name == replay_source.getName()) {
+		if (sensors != 1) {
+			request->send(400, "text/plain",
+					"A session can only be replayed as a single sensor.");
+			return;
+		}
+
+		const std::shared_ptr<const RecordingSession> session = getSession(
+				request);
+		if (!session) {
+			return;
+		} else if (session->samples.getStored() == 0) {
+			request->send(409, "text/plain",
+					"The session has no measurements to replay.");
+			return;
+		}
+		replay_source.setSession(session);
+		selected[0] = &replay_source;
+	} else {
+		request->send(400, "text/plain",
+				"Unknown sensor source, use lsm9ds1, synthetic, or replay.");
 		return;
 	}
 
-	uint8_t separator_char = ',';
-	if (request->hasArg("separator")) {
-		separator_char = request->arg("separator")[0];
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		sources[sensor] = selected[sensor];
 	}
+	sensor_count = sensors;
 
-	BufferStream *stream = new BufferStream(20000);
-	EventGroupHandle_t eventGroup = xEventGroupCreate();
-	stream->setEventGroup(eventGroup);
-	const size_t maxlen = 2000;
-	char *buffer = new char[maxlen];
-	std::shared_ptr<CsvGeneratorParameter> parameter = std::make_shared<
-			CsvGeneratorParameter>(this, stream, maxlen, buffer,
-			content_generator, headers, content_len, separator_char);
-	TaskHandle_t handle;
-	xTaskCreate(csvGenerator, "csv generator", 2500, parameter.get(), 1, &handle);
+	// The replayed session is only kept alive while it is replayed.
+	if (sources[0] != &replay_source) {
+		replay_source.setSession(nullptr);
+	}
 
-	request->onDisconnect([handle, parameter]() {
-		if (parameter->buffer_len > 0) {
-			parameter->buffer_len = 0;
-			vTaskDelete(handle);
-			vEventGroupDelete(parameter->stream->getEventGroup());
-		}
-	});
-	request->send(*stream, "text/csv", content_len);
+	// The max rates depend on the source and the number of sensors.
+	probe_requested = true;
+	xEventGroupSetBits(eventGroup, MEASURE_START_BIT);
+
+	sendSourceJson(request);
 }
 
-void LSM9DS1Handler::sendMeasurementsJson(
+void LSM9DS1Handler::sendCapabilitiesJson(
 		AsyncWebServerRequest *request) const {
-	char *measurements = new char[50];
-	uint32_t measuring_time = measurement_duration;
-	if (measuring) {
-		measuring_time = uint32_t(millis() - measurement_start);
+	const ThroughputProbe probe = probe_status.read();
+	std::ostringstream json;
+	json << "{\"source\": \"" << (probe.sensors > 0 ? probe.source : "")
+			<< "\", \"sensors\": " << (uint16_t) probe.sensors
+			<< ", \"time\": " << probe.time << ", \"probing\": "
+			<< (probe_requested ? "true" : "false") << ", \"max_frequency\": "
+			<< MAX_FREQUENCY << ", \"mag_read_us\": " << probe.mag_read_us
+			<< ", \"channels\": [";
+
+	for (uint8_t channels = 1; channels <= CHANNEL_ALL; channels++) {
+		json << (channels > 1 ? ", " : "") << "{\"channels\": "
+				<< (uint16_t) channels << ", \"read_us\": "
+				<< probe.read_us[channels] << ", \"store_us\": "
+				<< probe.store_us[channels] << ", \"max_rate\": "
+				<< getMaxFrequency(channels) << '}';
 	}
-	sprintf(measurements, "{\"measurements\": %u, \"time\": %u}",
-			measurements_stored, measuring_time);
-	AsyncWebServerResponse *response = request->beginResponse(200, "application/json", measurements);
+	json << "]}";
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"application/json", json.str().c_str());
 	response->addHeader("Cache-Control", "no-cache");
 	request->send(response);
-	delete[] measurements;
 }
 
-void LSM9DS1Handler::sendCalculationsJson(
-		AsyncWebServerRequest *request) const {
-	char *calculations = new char[70];
-	const uint32_t calculating_time = millis() - calculation_start;
-	sprintf(calculations, "{\"calculated\": %u, \"file\": \"%s\", \"time\": %u}",
-			calculated, file_calculating.c_str(), calculating_time);
-	AsyncWebServerResponse *response = request->beginResponse(200, "application/json", calculations);
-	response->addHeader("Cache-Control", "no-cache");
-	request->send(response);
-	delete[] calculations;
+void LSM9DS1Handler::probe(AsyncWebServerRequest *request) {
+	if (measuring) {
+		request->send(409, "text/plain",
+				"A recording or stream is in progress, the throughput can only be probed while idle.");
+		return;
+	}
+
+	probe_requested = true;
+	xEventGroupSetBits(eventGroup, MEASURE_START_BIT);
+	sendCapabilitiesJson(request);
+}
+
+uint16_t LSM9DS1Handler::getMaxFrequency(const uint8_t channels) const {
+	const uint16_t limit =
+			(channels & CHANNEL_ALL) == CHANNEL_MAGNETOMETER ?
+					MAG_ODR : MAX_FREQUENCY;
+	const ThroughputProbe probe = probe_status.read();
+	if (probe.sensors == 0) {
+		return limit;
+	}
+	return min(limit, probe.max_rates[channels & CHANNEL_ALL]);
+}
+
+void LSM9DS1Handler::probeThroughput() {
+	// The sources can be changed while the reader task probes them, so it uses a copy.
+	SensorSource *probed[MAX_SENSORS];
+	for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+		probed[sensor] = sources[sensor];
+	}
+	const uint8_t sensors = max((uint8_t) 1, min(sensor_count, MAX_SENSORS));
+	if (probed[0] == NULL) {
+		return;
+	}
+
+	// Stores go to PSRAM, like those of a recording.
+	const uint32_t capacity = PROBE_SAMPLES * MAX_SENSORS;
+	float *scratch = (float*) ps_malloc(
+			SampleStream::getSize(capacity, VALUES_PER_MEASUREMENT)
+					* sizeof(float));
+	if (scratch == NULL) {
+		Serial.println("Not enough free memory to probe the sensor throughput.");
+		return;
+	}
+
+	RawSample sample = { };
+	auto timeReads = [&](const uint8_t read_channels) -> uint32_t {
+		const uint64_t start_us = micros();
+		for (uint16_t i = 0; i < PROBE_SAMPLES; i++) {
+			for (uint8_t sensor = 0; sensor < sensors; sensor++) {
+				if (probed[sensor] != NULL) {
+					probed[sensor]->read(read_channels, sample.accel,
+							sample.gyro, sample.mag);
+				}
+			}
+		}
+		return (micros() - start_us + PROBE_SAMPLES - 1) / PROBE_SAMPLES;
+	};
+
+	ThroughputProbe probe = { };
+	probe.source = probed[0]->getName();
+	probe.sensors = sensors;
+	probe.mag_read_us = timeReads(CHANNEL_MAGNETOMETER);
+
+	for (uint8_t channels = 1; channels <= CHANNEL_ALL; channels++) {
+		const bool separate_mag = (channels & CHANNEL_MAGNETOMETER)
+				&& channels != CHANNEL_MAGNETOMETER;
+		probe.read_us[channels] = timeReads(
+				separate_mag ? channels & ~CHANNEL_MAGNETOMETER : channels);
+
+		float measurement[SampleStream::MAX_STRIDE];
+		SampleStream stream;
+		stream.reset(scratch, convertSample(sample, measurement, channels,
+				separate_mag), capacity);
+		const uint64_t start_us = micros();
+		for (uint16_t i = 0; i < PROBE_SAMPLES; i++) {
+			sample.timestamp = i;
+			for (uint8_t sensor = 0; sensor < sensors; sensor++) {
+				convertSample(sample, measurement, channels, separate_mag);
+				stream.append(measurement);
+			}
+		}
+		probe.store_us[channels] = (micros() - start_us + PROBE_SAMPLES - 1)
+				/ PROBE_SAMPLES;
+
+		// The reader and storage tasks run on separate cores, so the slower one limits the rate.
+		// A separate magnetometer takes its share of the reader time at its own rate.
+		float budget_us = PROBE_UTILIZATION * 1000000;
+		if (separate_mag) {
+			budget_us = max(0.0f, budget_us - MAG_ODR * probe.mag_read_us);
+		}
+		const float rate = min(
+				budget_us / max(probe.read_us[channels], (uint32_t) 1),
+				PROBE_UTILIZATION * 1000000
+						/ max(probe.store_us[channels], (uint32_t) 1));
+		const uint16_t limit =
+				channels == CHANNEL_MAGNETOMETER ? MAG_ODR : MAX_FREQUENCY;
+		probe.max_rates[channels] = max(1.0f, min(rate, (float) limit));
+	}
+
+	free(scratch);
+	probe.time = millis();
+	probe_status.write(probe);
+
+	Serial.print("Probed ");
+	Serial.print(sensors);
+	Serial.print(' ');
+	Serial.print(probe.source);
+	Serial.print(" sensors, max rate with all channels ");
+	Serial.print(probe.max_rates[CHANNEL_ALL]);
+	Serial.println("hz.");
 }
 
 size_t LSM9DS1Handler::generateMeasurementCsv(const uint8_t separator_char,
-		uint32_t &position,
-		const std::function<size_t(char*, const uint8_t, const uint32_t)> content_generator,
-		const std::vector<const char*> headers, char *buffer,
-		size_t maxlen) const {
+		uint32_t &position, const SampleStream &samples,
+		const SampleRange &range, const ValueGenerator content_generator,
+		const std::vector<const char*> headers, char *buffer, size_t maxlen,
+		const uint16_t step) const {
+	TRACE_SPAN(TRACE_CSV_CHUNK);
 	size_t length = 0;
+	float values[MAX_CSV_VALUES];
 
-	if (position == 0) {
+	if (position == range.start) {
 		strcpy(buffer, "Time(ms)");
 		length = 8;
 
@@ -401,20 +2839,35 @@ size_t LSM9DS1Handler::generateMeasurementCsv(const uint8_t separator_char,
 		}
 
 		buffer[length++] = '\n';
-	}
 
-	if (measurements_stored == 0) {
-		position++;
+		// Let the filters of stateful generators settle before the first written sample.
+		for (uint32_t i = range.warmup; i < range.start; i++) {
+			content_generator(values, i);
+		}
+
+		if (range.start >= range.end) {
+			position++;
+		}
 	}
 
-	while (length < maxlen - 13 * (headers.size() + 1) && position < measurements_stored) {
+	while (length < maxlen - 13 * (headers.size() + 1) && position < range.end) {
 		length += sprintf(buffer + length, "%d",
-				(uint32_t) data[position * VALUES_PER_MEASUREMENT]);
-
-		length += content_generator(buffer + length, separator_char, position);
+				(uint32_t) samples.getTimestamp(position));
+
+		const uint8_t count = content_generator(values, position);
+		for (uint8_t i = 0; i < count; i++) {
+			// Missing values are written as empty fields.
+			if (isnan(values[i])) {
+				buffer[length++] = separator_char;
+			} else {
+				TRACE_SPAN(TRACE_FORMAT_VALUE);
+				length += sprintf(buffer + length, "%c%f", separator_char,
+						values[i]);
+			}
+		}
 		buffer[length++] = '\n';
 
-		position++;
+		position += step;
 	}
 
 	return min(length, maxlen);
@@ -426,27 +2879,35 @@ void LSM9DS1Handler::csvGenerator(void *parameter) {
 	BufferStream *stream = param->stream;
 	size_t *maxlen = &param->buffer_len;
 	char *buffer = param->buffer;
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> content_gen =
-			param->content_gen;
+	const SampleStream *samples = param->samples;
+	const SampleRange range = param->range;
+	const ValueGenerator content_gen = param->content_gen;
 	const EventGroupHandle_t eventGroup = stream->getEventGroup();
 	const std::vector<const char*> headers = param->headers;
 	const size_t content_len = param->content_len;
 	const uint8_t separator_char = param->separator_char;
+	const uint16_t step = param->step;
 
 	size_t generated = 0;
-	uint32_t position = 0;
+	uint32_t position = range.start;
 
-	while (generated < content_len) {
+	// A content length of 0 means the size of the csv isn't known in advance.
+	while (position < range.end || generated == 0) {
 		int free = min((int) *maxlen, stream->availableForWrite());
 		if (free >= min(*maxlen, stream->size() / 10)
-				|| free >= content_len - generated) {
-			free = handler->generateMeasurementCsv(separator_char, position,
-					content_gen, headers, buffer, free);
-			size_t written = stream->write(buffer, free);
-			generated += written;
-
-			if (free != written) {
-				Serial.println("Somehow not all data got written to the stream!");
+				|| (content_len > 0 && free >= content_len - generated)) {
+			// The trace span ends before yielding, so it only measures the work of this wake-up.
+			{
+				TRACE_SPAN(TRACE_CSV_GENERATOR);
+				free = handler->generateMeasurementCsv(separator_char, position,
+						*samples, range, content_gen, headers, buffer, free, step);
+				size_t written = stream->write(buffer, free);
+				generated += written;
+
+				if (free != written) {
+					Serial.println("Somehow not all data got written to the stream!");
+				}
+				handler->metrics->addSent(param->endpoint, written);
 			}
 			delay(1);
 		} else {
@@ -459,6 +2920,7 @@ void LSM9DS1Handler::csvGenerator(void *parameter) {
 		}
 	}
 
+	handler->metrics->recordStack("csv generator");
 	*maxlen = 0;
 	xEventGroupWaitBits(eventGroup, stream->EMPTY_BIT, pdTRUE, pdFALSE,
 			750 / portTICK_PERIOD_MS);
@@ -466,6 +2928,20 @@ void LSM9DS1Handler::csvGenerator(void *parameter) {
 	vTaskDelete(NULL);
 }
 
+void LSM9DS1Handler::chunkRenderer(void *parameter) {
+	ChunkRendererParameter *param = (ChunkRendererParameter*) parameter;
+	ChunkCache::RenderResult result;
+	while ((result = param->cache->render(param->file))
+			!= ChunkCache::RENDER_DONE) {
+		// Wait for the slowest download to free up chunks if the cache is full.
+		delay(result == ChunkCache::RENDER_FULL ? 10 : 1);
+	}
+
+	param->metrics->recordStack("chunk renderer");
+	delete param;
+	vTaskDelete(NULL);
+}
+
 BufferStream::BufferStream(size_t buffer_size) {
 	content = new cbuf(buffer_size);
 	eventGroup = NULL;
@@ -490,6 +2966,7 @@ int BufferStream::read() {
 }
 
 size_t BufferStream::readBytes(char *buffer, size_t length) {
+	TRACE_SPAN(TRACE_BUFFER_READ);
 	const bool flag = eventGroup != NULL && content->room() < content->size() / 10;
 	const size_t read = content->read(buffer, length);
 	if (flag && content->room() >= content->size() / 10) {
@@ -522,6 +2999,7 @@ size_t BufferStream::write(uint8_t b) {
 }
 
 size_t BufferStream::write(const uint8_t *buffer, size_t size) {
+	TRACE_SPAN(TRACE_BUFFER_WRITE);
 	const size_t free = content->room();
 	if (size > free) {
 		content->resizeAdd(size - free);
@@ -538,3 +3016,235 @@ size_t BufferStream::write(const uint8_t *buffer, size_t size) {
 	}
 	return written;
 }
+
+void LSM9DS1Handler::spectrumCalculator(void *parameter) {
+	std::shared_ptr<SpectrumParameter> *task_parameter = (std::shared_ptr<
+			SpectrumParameter>*) parameter;
+	SpectrumParameter *param = task_parameter->get();
+	const LSM9DS1Handler *handler = param->handler;
+	const SampleStream *samples = param->samples;
+	const uint16_t nfft = param->nfft;
+
+	std::ostringstream result;
+	PowerSpectralDensity psd(nfft);
+	float *density = new float[nfft / 2 + 1];
+	if (!psd.isValid()) {
+		result << "{\"error\": \"Not enough internal RAM for nfft " << nfft
+				<< ".\"}";
+	} else {
+		// Copy each segment from PSRAM into the internal RAM segment buffer before transforming it.
+		float *segment = psd.getSegmentBuffer();
+		for (uint32_t start = param->start;
+				start + nfft <= param->end && !param->aborted;
+				start += nfft / 2) {
+			for (uint16_t i = 0; i < nfft; i++) {
+				segment[i] = samples->getValue(start + i, param->index);
+			}
+			psd.addSegment();
+			delay(1);
+		}
+
+		const float rate = (param->end - param->start - 1)
+				/ (samples->getTimestamp(param->end - 1)
+						- samples->getTimestamp(param->start)) * 1000;
+		psd.getDensity(density, rate);
+
+		const char *unit = handler->SENSOR_VALUE_UNITS[param->value];
+		result << "{\"channel\": \""
+				<< handler->SPECTRUM_CHANNEL_NAMES[param->value]
+				<< "\", \"unit\": \"(" << unit << ")^2/Hz\", \"nfft\": " << nfft
+				<< ", \"rate\": " << rate << ", \"resolution\": "
+				<< rate / nfft << ", \"segments\": " << psd.getSegments()
+				<< ", \"from\": " << samples->getTimestamp(param->start)
+				<< ", \"to\": " << samples->getTimestamp(param->end - 1)
+				<< ", \"psd\": [";
+		for (uint16_t k = 0; k <= nfft / 2; k++) {
+			if (k > 0) {
+				result << ", ";
+			}
+			result << density[k];
+		}
+		result << "]}";
+	}
+	delete[] density;
+
+	param->result = result.str();
+	param->done = true;
+	*param->calculating = false;
+
+	handler->metrics->recordStack("spectrum");
+	delete task_parameter;
+	vTaskDelete(NULL);
+}
+
+/**
+ * Updates an Adafruit AHRS filter the way the linear acceleration was calculated before OrientationFilter existed.
+ * Used as the reference for the fusion benchmark.
+ *
+ * @param filter	The Adafruit_Madgwick or Adafruit_Mahony filter to update.
+ * @param accel		The three accelerometer values. In m/s^2.
+ * @param gyro		The three gyroscope values. In rad/s.
+ * @param mag		The three magnetometer values, or NULL for a 6DOF update.
+ * @param linear	The array to write the three linear acceleration values to.
+ */
+template<typename Filter>
+static void updateReferenceFilter(Filter &filter, const float *accel,
+		const float *gyro, const float *mag, float *linear) {
+	const float ax = accel[0] / SENSORS_GRAVITY_EARTH;
+	const float ay = accel[1] / SENSORS_GRAVITY_EARTH;
+	const float az = accel[2] / SENSORS_GRAVITY_EARTH;
+
+	const float gx = gyro[0] * SENSORS_RADS_TO_DPS;
+	const float gy = gyro[1] * SENSORS_RADS_TO_DPS;
+	const float gz = gyro[2] * SENSORS_RADS_TO_DPS;
+
+	if (mag) {
+		filter.update(gx, gy, gz, ax, ay, az, mag[0], mag[1], mag[2]);
+	} else {
+		filter.updateIMU(gx, gy, gz, ax, ay, az);
+	}
+
+	float qW, qX, qY, qZ;
+	filter.getQuaternion(&qW, &qX, &qY, &qZ);
+
+	const float gravX = 2.0f * (qX * qZ - qW * qY);
+	const float gravY = 2.0f * (qW * qX + qY * qZ);
+	const float gravZ = 2.0f * (qW * qW - 0.5f + qZ * qZ);
+
+	linear[0] = (ax - gravX) * SENSORS_GRAVITY_EARTH;
+	linear[1] = (ay - gravY) * SENSORS_GRAVITY_EARTH;
+	linear[2] = (az - gravZ) * SENSORS_GRAVITY_EARTH;
+}
+
+void LSM9DS1Handler::fusionBenchmark(void *parameter) {
+	std::shared_ptr<FusionBenchmarkParameter> *task_parameter =
+			(std::shared_ptr<FusionBenchmarkParameter>*) parameter;
+	FusionBenchmarkParameter *param = task_parameter->get();
+	const RecordingSession *session = param->session.get();
+	const uint32_t samples = param->end - param->start;
+	const float frequency = round(1000000.0 / session->measuring_time) / 20;
+
+	std::ostringstream result;
+	result << "{\"session\": " << session->id << ", \"from\": "
+			<< session->samples.getTimestamp(param->start) << ", \"to\": "
+			<< session->samples.getTimestamp(param->end - 1)
+			<< ", \"samples\": " << samples << ", \"filters\": [";
+
+	// Sessions without magnetometer values can only be benchmarked using 6DOF updates.
+	const bool has_mag = session->isRecorded(CHANNEL_MAGNETOMETER);
+	bool first = true;
+	for (uint8_t algorithm = 0; algorithm < FUSION_ALGORITHMS; algorithm++) {
+		for (uint8_t mode = has_mag ? 0 : 1; mode < 2; mode++) {
+			const bool use_mag = mode == 0;
+			OrientationFilter filter((FusionAlgorithm) algorithm, frequency);
+			Adafruit_Madgwick madgwick;
+			Adafruit_Mahony mahony;
+			madgwick.begin(frequency);
+			mahony.begin(frequency);
+
+			float accel[FUSION_BENCHMARK_BLOCK][3];
+			float gyro[FUSION_BENCHMARK_BLOCK][3];
+			float mag[FUSION_BENCHMARK_BLOCK][3];
+			bool mag_valid[FUSION_BENCHMARK_BLOCK];
+			float linear[FUSION_BENCHMARK_BLOCK][3];
+			float reference[FUSION_BENCHMARK_BLOCK][3];
+
+			uint32_t mag_cursor = 0;
+			uint64_t time = 0;
+			uint64_t reference_time = 0;
+			float max_error = 0;
+			double square_error = 0;
+			for (uint32_t block = param->start;
+					block < param->end && !param->aborted;
+					block += FUSION_BENCHMARK_BLOCK) {
+				const uint8_t count = min(param->end - block,
+						(uint32_t) FUSION_BENCHMARK_BLOCK);
+				for (uint8_t i = 0; i < count; i++) {
+					float measurement[6];
+					session->samples.getValues(block + i, 1, 6, measurement);
+					memcpy(accel[i], measurement, sizeof(accel[i]));
+					memcpy(gyro[i], measurement + 3, sizeof(gyro[i]));
+					mag_valid[i] = use_mag
+							&& session->getMagnetometerValues(block + i,
+									mag_cursor, mag[i]);
+				}
+
+				uint32_t start = micros();
+				for (uint8_t i = 0; i < count; i++) {
+					filter.update(accel[i], gyro[i],
+							mag_valid[i] ? mag[i] : NULL);
+					filter.getGravity(linear[i]);
+					for (uint8_t j = 0; j < 3; j++) {
+						linear[i][j] = accel[i][j] - linear[i][j];
+					}
+				}
+				time += micros() - start;
+
+				start = micros();
+				for (uint8_t i = 0; i < count; i++) {
+					if (algorithm == FUSION_MAHONY) {
+						updateReferenceFilter(mahony, accel[i], gyro[i],
+								mag_valid[i] ? mag[i] : NULL, reference[i]);
+					} else {
+						updateReferenceFilter(madgwick, accel[i], gyro[i],
+								mag_valid[i] ? mag[i] : NULL, reference[i]);
+					}
+				}
+				reference_time += micros() - start;
+
+				for (uint8_t i = 0; i < count; i++) {
+					for (uint8_t j = 0; j < 3; j++) {
+						const float error = fabsf(linear[i][j] - reference[i][j]);
+						max_error = max(max_error, error);
+						square_error += error * error;
+					}
+				}
+				delay(1);
+			}
+
+			// The angle between the final orientations of both filters.
+			float quaternion[4];
+			filter.getQuaternion(quaternion);
+			float reference_quaternion[4];
+			if (algorithm == FUSION_MAHONY) {
+				mahony.getQuaternion(&reference_quaternion[0],
+						&reference_quaternion[1], &reference_quaternion[2],
+						&reference_quaternion[3]);
+			} else {
+				madgwick.getQuaternion(&reference_quaternion[0],
+						&reference_quaternion[1], &reference_quaternion[2],
+						&reference_quaternion[3]);
+			}
+			float dot = 0;
+			for (uint8_t i = 0; i < 4; i++) {
+				dot += quaternion[i] * reference_quaternion[i];
+			}
+			const float angle = 2 * acosf(min(fabsf(dot), 1.0f)) * RAD_TO_DEG;
+
+			if (!first) {
+				result << ", ";
+			}
+			first = false;
+			result << "{\"algorithm\": \""
+					<< OrientationFilter::ALGORITHM_NAMES[algorithm]
+					<< "\", \"magnetometer\": "
+					<< (use_mag ? "true" : "false") << ", \"us_per_sample\": "
+					<< (float) time / samples
+					<< ", \"reference_us_per_sample\": "
+					<< (float) reference_time / samples
+					<< ", \"max_error\": " << max_error
+					<< ", \"rms_error\": "
+					<< sqrt(square_error / samples / 3)
+					<< ", \"final_angle\": " << angle << "}";
+		}
+	}
+	result << "]}";
+
+	param->result = result.str();
+	param->done = true;
+	*param->running = false;
+
+	param->metrics->recordStack("fusion benchmark");
+	delete task_parameter;
+	vTaskDelete(NULL);
+}
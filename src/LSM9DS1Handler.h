@@ -21,319 +21,1663 @@
 #ifndef SRC_LSM9DS1HANDLER_H_
 #define SRC_LSM9DS1HANDLER_H_
 
-#include <Adafruit_LSM9DS1.h>
+#include "ChunkCache.h"
+#include "EspFlashPartition.h"
+#include "HimemRegion.h"
+#include "LSM9DS1Source.h"
+#include "Metrics.h"
+#include "OrientationFilter.h"
+#include "RecordingSession.h"
+#include "ReplaySource.h"
+#include "Seqlock.h"
+#include "SpscRing.h"
+#include "SyntheticSource.h"
+#include "TcpStreamer.h"
+#include <Adafruit_Sensor.h>
 #include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
 
-const uint8_t LSM9DS1_XGCS = 27;
-const uint8_t LSM9DS1_MCS = 26;
+/**
+ * A function writing the values of one line of a measurements csv to the given array.
+ * Gets the index of the sample to write in its sample stream,
+ * and returns the number of values written.
+ * Values that aren't available are written as NAN.
+ */
+typedef std::function<uint8_t(float*, const uint32_t)> ValueGenerator;
+
+/**
+ * A function creating a new ValueGenerator, with its own filter state.
+ */
+typedef std::function<ValueGenerator()> ValueGeneratorFactory;
+
+/**
+ * The state of pre-rendering a single measurements csv.
+ */
+struct PrerenderJob {
+	std::shared_ptr<RecordingSession> session;
+	MeasurementCsv csv;
+
+	/**
+	 * The file being rendered, which is dropped whenever its memory is needed for a new recording.
+	 */
+	std::weak_ptr<RenderedCsv> file;
+	const SampleStream *samples;
+	ValueGenerator generator;
+	std::vector<const char*> headers;
+	uint32_t position;
+};
+
+/**
+ * A slice of a sample stream to export.
+ */
+struct SampleRange {
+	/**
+	 * The index of the first sample of the slice.
+	 */
+	uint32_t start;
+
+	/**
+	 * The index after the last sample of the slice.
+	 */
+	uint32_t end;
+
+	/**
+	 * The index of the first sample to feed to stateful generators, to let their filters settle before the slice starts.
+	 */
+	uint32_t warmup;
+};
+
+/**
+ * The states of persisting a recording to flash.
+ */
+enum PersistState : uint8_t {
+	PERSIST_IDLE, PERSIST_WRITING, PERSIST_DONE, PERSIST_FAILED
+};
+
+/**
+ * A measurement as read from the sensor source, before converting it to SI units.
+ * Passed from the reader task to the storage task.
+ */
+struct RawSample {
+	/**
+	 * The flag set if this sample should be stored in the main sample stream.
+	 */
+	static const uint8_t STORE = 1;
+
+	/**
+	 * The flag set if the magnetometer values of this sample were read.
+	 */
+	static const uint8_t MAG = 1 << 1;
+
+	/**
+	 * The time this sample was read at, in milliseconds since the start of the recording.
+	 */
+	float timestamp;
+
+	/**
+	 * The time this sample was read at, in microseconds since the start of the recording or stream.
+	 * Wraps around after about 71 minutes.
+	 */
+	uint32_t time_us;
+	int16_t accel[3];
+	int16_t gyro[3];
+	int16_t mag[3];
+	uint8_t flags;
+
+	/**
+	 * The index of the sensor this sample was read from.
+	 */
+	uint8_t sensor;
+};
+
+/**
+ * The configuration of the reader task for a recording or stream.
+ * Applied by the storage task once the reader task stopped, so the web server never waits for it.
+ */
+struct ReaderConfig {
+	/**
+	 * The bit mask of the SensorChannels to read.
+	 */
+	uint8_t channels;
+
+	/**
+	 * The number of sensors to read.
+	 */
+	uint8_t sensors;
+
+	/**
+	 * Whether the magnetometer is read at its own rate, into a separate stream.
+	 */
+	bool separate_mag;
+	uint16_t frequency;
+	uint16_t mag_frequency;
+
+	/**
+	 * The number of measurements to read from each sensor.
+	 */
+	uint32_t measurements;
+};
+
+/**
+ * A snapshot of the progress of the session being recorded.
+ * Published by the storage task after every batch of samples.
+ */
+struct RecordingStatus {
+	/**
+	 * The id of the session of the first sensor being recorded, or 0 if nothing is recorded.
+	 */
+	uint32_t session;
+
+	/**
+	 * The number of measurements stored in the main stream of the session.
+	 */
+	uint32_t stored;
+
+	/**
+	 * The average time between the last measurements, in microseconds.
+	 */
+	uint32_t measuring_time;
+
+	/**
+	 * The number of sensors being recorded.
+	 */
+	uint8_t sensors;
+
+	/**
+	 * The number of measurements stored in the main streams of all sensors being recorded.
+	 */
+	uint32_t stored_all;
+};
+
+/**
+ * A snapshot of the progress of calculating the csv sizes of a finished recording.
+ * Published by the loop task whenever a csv is finished.
+ */
+struct CalculationStatus {
+	/**
+	 * The id of the session the csv sizes are calculated for, or 0 if there is none.
+	 */
+	uint32_t session;
+
+	/**
+	 * The csv whose size is currently being calculated, or the last one if all are done.
+	 */
+	MeasurementCsv file;
+
+	/**
+	 * The number of csvs whose size was already calculated.
+	 */
+	uint8_t calculated;
+
+	/**
+	 * The time the calculation was started at, in milliseconds since boot.
+	 */
+	uint32_t start;
+
+	/**
+	 * The time it took to generate each csv in microseconds, and its size in bytes.
+	 */
+	uint32_t times[MEASUREMENT_CSVS];
+	uint32_t sizes[MEASUREMENT_CSVS];
+};
+
+/**
+ * The result of timing sample reads and stores of the selected sensor sources.
+ * Published by the reader task after every probe.
+ */
+struct ThroughputProbe {
+	/**
+	 * The name of the probed sensor source.
+	 */
+	const char *source;
+
+	/**
+	 * The number of sensors read for each sample, or 0 if the sources weren't probed yet.
+	 */
+	uint8_t sensors;
+
+	/**
+	 * The time the probe finished at, in milliseconds since boot.
+	 */
+	uint32_t time;
+
+	/**
+	 * The time to read the magnetometer of all sensors once, in microseconds.
+	 */
+	uint32_t mag_read_us;
+
+	/**
+	 * The time to read one sample of all sensors, and to convert and store it, in microseconds, for each channel bit mask.
+	 * A separately recorded magnetometer is not part of these, since it is only read at its own rate.
+	 */
+	uint32_t read_us[CHANNEL_ALL + 1];
+	uint32_t store_us[CHANNEL_ALL + 1];
+
+	/**
+	 * The max sustainable measurement frequency for each channel bit mask.
+	 */
+	uint16_t max_rates[CHANNEL_ALL + 1];
+};
+
+class LSM9DS1Handler {
+public:
+	/**
+	 * The max number of floats to be recorded per measurement.
+	 * This is 1x timestamp + 3x accelerometer + 3x gyroscope + 3x magnetometer.
+	 * Recordings with less channels store less values per measurement.
+	 */
+	const uint8_t VALUES_PER_MEASUREMENT = 10;
+
+	/**
+	 * The output data rate of the magnetometer, in measurements per second.
+	 * When recording the magnetometer with other sensors, its values are stored in a separate stream at this rate.
+	 */
+	const uint16_t MAG_ODR = 80;
+
+	/**
+	 * The max number of values in a line of a measurement csv, excluding the timestamp.
+	 */
+	static const uint8_t MAX_CSV_VALUES = 12;
+
+	/**
+	 * The max number of events detected per recording session.
+	 */
+	static const uint16_t MAX_EVENTS = 1024;
+
+	/**
+	 * The max number of events sent per request for /events.json.
+	 */
+	static const uint8_t MAX_EVENTS_PER_REQUEST = 100;
+
+	/**
+	 * The names of the sensors events can be detected for, in the order of their sensor index.
+	 */
+	const char *EVENT_SENSOR_NAMES[EventIndex::SENSORS] = { "accelerometer",
+			"gyroscope", "magnetometer" };
+
+	/**
+	 * The number of sensor values measured by the LSM9DS1, three for each SensorChannel.
+	 */
+	static const uint8_t SENSOR_VALUES = RecordingSession::SENSOR_VALUES;
+
+	/**
+	 * The names of the sensor values, in the order accelerometer, gyroscope, magnetometer.
+	 */
+	const char *SENSOR_VALUE_NAMES[SENSOR_VALUES] = { "acceleration_x",
+			"acceleration_y", "acceleration_z", "rotation_x", "rotation_y",
+			"rotation_z", "magnetic_x", "magnetic_y", "magnetic_z" };
+
+	/**
+	 * The units of the sensor values, in the order accelerometer, gyroscope, magnetometer.
+	 */
+	const char *SENSOR_VALUE_UNITS[SENSOR_VALUES] = { "m/s^2", "m/s^2",
+			"m/s^2", "rad/s", "rad/s", "rad/s", "uT", "uT", "uT" };
+
+	/**
+	 * The short names of the sensor values, used to select the value to calculate the spectrum of.
+	 */
+	const char *SPECTRUM_CHANNEL_NAMES[SENSOR_VALUES] = { "ax", "ay", "az",
+			"gx", "gy", "gz", "mx", "my", "mz" };
+
+	/**
+	 * The file names of the measurement csvs, indexed by MeasurementCsv.
+	 */
+	const char *MEASUREMENT_CSV_NAMES[MEASUREMENT_CSVS] = { "all.csv",
+			"accelerometer.csv", "linear_accelerometer.csv", "gyroscope.csv",
+			"magnetometer.csv" };
+
+	/**
+	 * The time before the start of a sliced csv for which the stateful generators are run without writing their values.
+	 * This lets the orientation filter of the linear acceleration settle.
+	 */
+	const uint32_t CSV_WARMUP_MS = 2000;
+
+	/**
+	 * The max number of values generated to calculate the size of a sliced csv before sending it.
+	 * Counts every input sample including the warmup, since decimated and stateful generators process all of them.
+	 * The size is calculated on the web server task, so larger slices are sent using chunked encoding instead.
+	 */
+	const uint32_t CSV_SIZED_SLICE_VALUES = 10000;
+
+	/**
+	 * The stack size of the tasks generating csvs, in bytes.
+	 * Fits the deepest generator chain, the decimating low pass filter around the orientation filter of the linear acceleration,
+	 * plus the float formatting of generateMeasurementCsv. The min free stack of each run is reported in /metrics.json.
+	 */
+	const uint32_t CSV_GENERATOR_STACK_SIZE = 4096;
+
+	/**
+	 * The number of ChunkCache::CHUNK_SIZE chunks of PSRAM shared by all full csv downloads.
+	 * Each file being downloaded uses at most half of them.
+	 */
+	static const uint16_t CSV_CACHE_CHUNKS = 16;
+
+	/**
+	 * The number of bytes of directly mapped PSRAM not used for recordings.
+	 * Large allocations of the web server and the exports go to the PSRAM too.
+	 */
+	static const size_t PSRAM_RESERVE = 256 * 1024;
+
+	/**
+	 * The largest supported spectrum segment size.
+	 * All the buffers required for the calculation are kept in internal RAM, so this can't be too large.
+	 */
+	const uint16_t SPECTRUM_MAX_NFFT = 2048;
+
+	/**
+	 * The core to run the spectrum calculation on.
+	 * The web server is pinned to the other core using CONFIG_ASYNC_TCP_RUNNING_CORE.
+	 */
+	const BaseType_t SPECTRUM_CORE = 1;
+
+	/**
+	 * The number of samples the fusion benchmark copies to internal RAM before timing the filters on them.
+	 * This keeps the PSRAM access out of the timings.
+	 */
+	static const uint8_t FUSION_BENCHMARK_BLOCK = 32;
+
+	/**
+	 * The bit to be set in the EventGroup when starting a measurement.
+	 * Wakes up the reader task.
+	 */
+	const EventBits_t MEASURE_START_BIT = 1;
+
+	/**
+	 * The bit to be set in the EventGroup when starting a measurement, to wake up the storage task.
+	 */
+	const EventBits_t STORE_START_BIT = 1 << 1;
+
+	/**
+	 * The bit to be set in the EventGroup when a recording is finished and the csv sizes should be calculated.
+	 */
+	const EventBits_t CALCULATE_START_BIT = 1 << 2;
+
+	/**
+	 * The number of raw samples that fit into the ring between the reader and the storage task.
+	 * At the max output data rate of a single sensor this is about a quarter second.
+	 */
+	static const uint16_t RING_SIZE = 256;
+
+	/**
+	 * The time between two FIFO drains when recording multiple sensors, in milliseconds.
+	 * The FIFO of the LSM9DS1 holds about 33ms of conversions at the max output data rate.
+	 */
+	const uint32_t FIFO_DRAIN_INTERVAL_MS = 10;
+
+	/**
+	 * The core and priority of the task reading the sensor.
+	 * The highest priority on the core without the WiFi stack and web server, so reads aren't delayed by other work.
+	 */
+	const BaseType_t READER_CORE = 1;
+	const UBaseType_t READER_PRIORITY = 20;
+
+	/**
+	 * The core and priority of the task converting and storing the read samples.
+	 * Above the web server, so downloads can't make the ring overflow.
+	 */
+	const BaseType_t STORAGE_CORE = 0;
+	const UBaseType_t STORAGE_PRIORITY = 4;
+
+	/**
+	 * The factors to convert raw sensor values to SI units.
+	 * These have to match the ranges set in LSM9DS1Driver::begin.
+	 */
+	const float ACCEL_SCALE = LSM9DS1_ACCEL_MG_LSB / 1000
+			* SENSORS_GRAVITY_STANDARD;
+	const float GYRO_SCALE = LSM9DS1_GYRO_DPS_DIGIT * SENSORS_DPS_TO_RADS;
+	const float MAG_SCALE = LSM9DS1_MAG_MGAUSS / 10; // 1 milligauss = 0.1 micro tesla
+
+	/**
+	 * The number of times begin tries to connect to the LSM9DS1, before falling back to the synthetic source.
+	 */
+	const uint8_t SENSOR_BEGIN_ATTEMPTS = 5;
+
+	/**
+	 * The highest measurement frequency accepted for recordings and streams.
+	 */
+	const uint16_t MAX_FREQUENCY = 1000;
+
+	/**
+	 * The number of samples read and stored for each channel selection by the throughput probe.
+	 */
+	static const uint16_t PROBE_SAMPLES = 128;
+
+	/**
+	 * The fraction of its core the reader or storage task may use at the max sustainable frequency.
+	 * The rest is left for waking up on data ready, the sample ring, and the other tasks on the core.
+	 */
+	const float PROBE_UTILIZATION = 0.8;
+
+	/**
+	 * Creates a new LSM9DS1Handler.
+	 * The memory for the recordings is allocated by begin, depending on the PSRAM of the module.
+	 *
+	 * @param metrics	The metrics to report downloads and task stacks to.
+	 */
+	LSM9DS1Handler(Metrics *metrics);
+	virtual ~LSM9DS1Handler();
+
+	/**
+	 * Initializes the LSM9DS1, and starts the reader and storage tasks.
+	 * Uses the synthetic source if the LSM9DS1 doesn't respond.
+	 */
+	void begin();
+
+	/**
+	 * Calculates the csv sizes after a recording is finished.
+	 * The measurements themselves are taken by the reader and storage tasks.
+	 */
+	void loop();
+
+	/**
+	 * Starts a new recording session storing the given number of measurements.
+	 * The session gets its own slot of the PSRAM, so earlier sessions stay available until they are deleted.
+	 * A recording still in progress is stopped, and kept as a session of its own.
+	 * Refused while a recording is written to flash, since that stalls the reader task.
+	 * The session is created right away, but the storage task only starts the reader task once it stopped.
+	 *
+	 * @param measurements	The number of measurements to take.
+	 * 						Limited to the number of measurements that fit into the largest free PSRAM extent.
+	 * @param freq			The target measurement frequency. In measurements per second.
+	 * @param channels		A bit mask of the SensorChannels to record.
+	 * @return	True if the recording was started, false if there wasn't enough free memory for a single measurement,
+	 * 			or a recording is being persisted.
+	 */
+	bool measure(uint32_t measurements, uint16_t freq, uint8_t channels =
+			CHANNEL_ALL);
+
+	void sendAllCsv(AsyncWebServerRequest *request) const {
+		const std::shared_ptr<const RecordingSession> session = getSession(request);
+		if (!session) {
+			return;
+		}
+
+		FusionAlgorithm algorithm;
+		bool magnetometer;
+		if (!getFusionArgs(request, algorithm, magnetometer)) {
+			return;
+		}
+
+		// The size of the full csv is only calculated for the default fusion settings.
+		sendMeasurementsCsv(request, session, session->samples,
+				std::bind(&LSM9DS1Handler::getAllGenerator, this, session,
+						algorithm, magnetometer), getAllHeaders(*session),
+				isDefaultFusion(algorithm, magnetometer) ?
+						session->csv_sizes[CSV_ALL] : 0,
+				isDefaultFusion(algorithm, magnetometer) ?
+						getRenderedCsv(*session, CSV_ALL) : nullptr);
+	}
+
+	void sendAccelerometerCsv(AsyncWebServerRequest *request) const {
+		const std::shared_ptr<const RecordingSession> session = getSession(request);
+		if (!session) {
+			return;
+		} else if (!session->isRecorded(CHANNEL_ACCELEROMETER)) {
+			sendNotRecorded(request, "accelerometer");
+			return;
+		}
+
+		const std::vector<const char*> headers = { "Acceleration X(m/s^2)",
+				"Acceleration Y(m/s^2)", "Acceleration Z(m/s^2)" };
+		sendMeasurementsCsv(request, session, headers,
+				session->getChannelIndex(CHANNEL_ACCELEROMETER),
+				session->csv_sizes[CSV_ACCELEROMETER],
+				getRenderedCsv(*session, CSV_ACCELEROMETER));
+	}
+
+	void sendLinearAccelerometerCsv(AsyncWebServerRequest *request) const {
+		const std::shared_ptr<const RecordingSession> session = getSession(request);
+		if (!session) {
+			return;
+		} else if (!session->isRecorded(CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE)) {
+			sendNotRecorded(request, "accelerometer and gyroscope");
+			return;
+		}
+
+		FusionAlgorithm algorithm;
+		bool magnetometer;
+		if (!getFusionArgs(request, algorithm, magnetometer)) {
+			return;
+		}
+
+		const std::vector<const char*> headers = {
+				"Linear Acceleration X(m/s^2)", "Linear Acceleration Y(m/s^2)",
+				"Linear Acceleration Z(m/s^2)" };
+		sendMeasurementsCsv(request, session, session->samples,
+				std::bind(&LSM9DS1Handler::getLinearAccelerationGenerator,
+						this, session, algorithm, magnetometer), headers,
+				isDefaultFusion(algorithm, magnetometer) ?
+						session->csv_sizes[CSV_LINEAR_ACCELERATION] : 0,
+				isDefaultFusion(algorithm, magnetometer) ?
+						getRenderedCsv(*session, CSV_LINEAR_ACCELERATION) :
+						nullptr);
+	}
 
-//#define LSM9DS1_I2C // uncomment to use I2C to connect to the lsm9ds1
+	void sendGyroscopeCsv(AsyncWebServerRequest *request) const {
+		const std::shared_ptr<const RecordingSession> session = getSession(request);
+		if (!session) {
+			return;
+		} else if (!session->isRecorded(CHANNEL_GYROSCOPE)) {
+			sendNotRecorded(request, "gyroscope");
+			return;
+		}
+
+		const std::vector<const char*> headers = { "Rotation X(rad/s)",
+				"Rotation Y(rad/s)", "Rotation Z(rad/s)" };
+		sendMeasurementsCsv(request, session, headers,
+				session->getChannelIndex(CHANNEL_GYROSCOPE),
+				session->csv_sizes[CSV_GYROSCOPE],
+				getRenderedCsv(*session, CSV_GYROSCOPE));
+	}
+
+	void sendMagnetometerCsv(AsyncWebServerRequest *request) const {
+		const std::shared_ptr<const RecordingSession> session = getSession(request);
+		if (!session) {
+			return;
+		} else if (!session->isRecorded(CHANNEL_MAGNETOMETER)) {
+			sendNotRecorded(request, "magnetometer");
+			return;
+		}
+
+		// The magnetometer csv uses the native magnetometer rate if it has its own stream.
+		const std::vector<const char*> headers = { "Magnetic X(uT)",
+				"Magnetic Y(uT)", "Magnetic Z(uT)" };
+		if (session->separate_mag) {
+			sendMeasurementsCsv(request, session, session->mag_samples,
+					[this, session]() {
+						return getDataContentGenerator(session,
+								session->mag_samples, 1);
+					}, headers, session->csv_sizes[CSV_MAGNETOMETER],
+					getRenderedCsv(*session, CSV_MAGNETOMETER));
+		} else {
+			sendMeasurementsCsv(request, session, headers,
+					session->getChannelIndex(CHANNEL_MAGNETOMETER),
+					session->csv_sizes[CSV_MAGNETOMETER],
+					getRenderedCsv(*session, CSV_MAGNETOMETER));
+		}
+	}
+
+	void sendMeasurementsJson(AsyncWebServerRequest *request) const;
+
+	void sendCalculationsJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Sends the summary statistics of each recorded sensor value to the client.
+	 * Available while recording, as well as afterwards.
+	 *
+	 * @param request	The HTTP web request requesting the summary.
+	 */
+	void sendSummaryJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Sends the power spectral density of a single recorded sensor value to the client.
+	 * The density is estimated using Welch's method, with half overlapping hann windowed segments.
+	 * The calculation runs in a separate task on the core not used by the web server.
+	 *
+	 * @param request	The HTTP web request requesting the spectrum.
+	 */
+	void sendSpectrumJson(AsyncWebServerRequest *request);
+
+	/**
+	 * Sends a min/max/mean overview of the recorded values to the client, for plotting long recordings.
+	 * Uses the overview pyramids, so the time this takes depends on the number of requested points rather than the recording length.
+	 * Available while recording as well as afterwards.
+	 *
+	 * @param request	The HTTP web request requesting the overview.
+	 */
+	void sendOverviewJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Sends a benchmark of the sensor fusion algorithms used for the linear acceleration to the client.
+	 * Runs every OrientationFilter variant and the matching Adafruit AHRS reference over the recorded samples,
+	 * and reports the time per sample of both, as well as the difference of their linear acceleration.
+	 * The calculation runs in a separate task on the core not used by the web server.
+	 *
+	 * @param request	The HTTP web request requesting the benchmark.
+	 */
+	void sendFusionBenchmarkJson(AsyncWebServerRequest *request);
+
+	/**
+	 * Sends the state of persisting a recording session to the flash recording partition.
+	 *
+	 * @param request	The HTTP web request requesting the persist state.
+	 */
+	void sendPersistJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Starts writing a recording session to the flash recording partition, replacing the one stored there.
+	 * A persisted recording is loaded again after a reboot.
+	 *
+	 * @param request	The HTTP web request requesting the recording to be persisted.
+	 */
+	void persist(AsyncWebServerRequest *request);
+
+	/**
+	 * Sends a list of all recording sessions and their sizes, as well as the free PSRAM, to the client.
+	 *
+	 * @param request	The HTTP web request requesting the session list.
+	 */
+	void sendSessionsJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Deletes the recording session selected by the session argument of a request.
+	 * Its memory is reclaimed once all exports still reading it are finished.
+	 * Deleting the session being recorded stops the recording.
+	 *
+	 * @param request	The HTTP web request requesting the session to be deleted.
+	 */
+	void deleteSession(AsyncWebServerRequest *request);
+
+	/**
+	 * Sends the events detected in a recording session, and the thresholds they were detected with.
+	 * The from argument selects the first event to send, and count the max number of events.
+	 *
+	 * @param request	The HTTP web request requesting the events.
+	 */
+	void sendEventsJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Sets the thresholds of the event detection for the following recordings.
+	 * The accelerometer, gyroscope, and magnetometer arguments set the threshold of a sensor, 0 disables it.
+	 * The hysteresis argument sets the fraction of the threshold the magnitude has to fall by to end an event.
+	 *
+	 * @param request	The HTTP web request with the new event settings.
+	 */
+	void setEventSettings(AsyncWebServerRequest *request);
+
+	/**
+	 * Starts streaming measurements to a collector on another host, instead of recording them.
+	 * The request selects the collector with the host and port arguments,
+	 * and the stream with the optional rate and channels arguments.
+	 * A stream runs until it is stopped, or a new recording is started.
+	 *
+	 * @param request	The HTTP web request requesting the stream to be started.
+	 */
+	void startStream(AsyncWebServerRequest *request);
+
+	/**
+	 * Stops the current stream, and drops the frames not sent yet.
+	 *
+	 * @param request	The HTTP web request requesting the stream to be stopped.
+	 */
+	void stopStream(AsyncWebServerRequest *request);
+
+	/**
+	 * Sends the state of the current or last stream, and its throughput and loss counters.
+	 *
+	 * @param request	The HTTP web request requesting the stream state.
+	 */
+	void sendStreamJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Sends the sensor source read by new recordings and streams, and the settings of the synthetic and replay sources.
+	 *
+	 * @param request	The HTTP web request requesting the sensor source.
+	 */
+	void sendSourceJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Selects the sensor source for the following recordings and streams.
+	 * The source argument selects lsm9ds1, synthetic, or replay.
+	 * The synthetic source is configured by the odr, vibration_frequency, vibration_amplitude,
+	 * rotation_amplitude, noise, shock_interval_ms, shock_amplitude, and seed arguments.
+	 * The replay source replays the session selected by the session argument.
+	 * The sensors argument limits the number of LSM9DS1s or synthetic sensors recorded at the same time.
+	 *
+	 * @param request	The HTTP web request selecting the sensor source.
+	 */
+	void setSource(AsyncWebServerRequest *request);
+
+	/**
+	 * Sends the result of the last throughput probe, with the time to read and store a sample,
+	 * and the max sustainable measurement frequency for each channel selection.
+	 *
+	 * @param request	The HTTP web request requesting the capabilities.
+	 */
+	void sendCapabilitiesJson(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Probes the throughput of the selected sensor sources again, once the reader task is idle.
+	 *
+	 * @param request	The HTTP web request requesting the probe.
+	 */
+	void probe(AsyncWebServerRequest *request);
+
+	/**
+	 * Gets the max measurement frequency for the given channels, as measured by the last throughput probe.
+	 * Falls back to the max frequency of the sensor, until the first probe finished.
+	 *
+	 * @param channels	The bit mask of the SensorChannels to record.
+	 * @return	The max sustainable measurement frequency.
+	 */
+	uint16_t getMaxFrequency(const uint8_t channels) const;
+
+	/**
+	 * Gets the max number of measurements of a new recording with all channels, given the currently free memory.
+	 * Recordings of less channels, or with the magnetometer at its own rate, can store more measurements.
+	 *
+	 * @return	The max number of measurements.
+	 */
+	uint32_t getMaxMeasurements() const;
+
+	/**
+	 * Gets the current recording session.
+	 * This is the session that was started last, or the one restored from flash.
+	 *
+	 * @return	The current session, or NULL if there is none.
+	 */
+	std::shared_ptr<const RecordingSession> getCurrentSession() const {
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		return current;
+	}
 
-#ifndef LSM9DS1_I2C
-#define LSM9DS1_SPI
-#else
-#undef LSM9DS1_SPI
-#endif
+	/**
+	 * Checks whether the esp is currently recording measurements.
+	 *
+	 * @return	True if a measurement is in progress.
+	 */
+	const bool isMeasuring() const {
+		return measuring;
+	}
+
+	/**
+	 * Checks whether a recording is currently being written to the recording partition.
+	 *
+	 * @return	True if a recording is being persisted.
+	 */
+	bool isPersisting() const {
+		return persist_state == PERSIST_WRITING;
+	}
+
+	/**
+	 * Gets a consistent snapshot of the progress of the current recording.
+	 * Never blocks the storage task.
+	 *
+	 * @return	The last published recording status.
+	 */
+	RecordingStatus getRecordingStatus() const {
+		return recording_status.read();
+	}
+
+	/**
+	 * Gets a consistent snapshot of the progress of calculating the csv sizes.
+	 *
+	 * @return	The last published calculation status.
+	 */
+	CalculationStatus getCalculationStatus() const {
+		return calculation_status.read();
+	}
+
+	/**
+	 * Stops the current recording, if there is one, and deletes the current session.
+	 * Afterwards the LSM9DS1Handler is neither recording measurements nor calculating csv sizes for the current session.
+	 */
+	void resetMeasurements();
+
+private:
+	Metrics *const metrics;
+
+	/**
+	 * The PSRAM region split into the slots of the recording sessions.
+	 * Uses all of the directly mapped PSRAM free at boot, except for PSRAM_RESERVE.
+	 */
+	float *data = NULL;
+
+	/**
+	 * The allocator managing the slots of data.
+	 */
+	SlotAllocator allocator;
+
+	/**
+	 * The PSRAM beyond the directly mapped 4 MB, for the sample streams of sessions too large for data.
+	 */
+	mutable HimemRegion himem;
+
+	/**
+	 * The allocator managing the slots of himem.
+	 */
+	SlotAllocator himem_allocator;
+
+	/**
+	 * The PSRAM memory of csv_cache.
+	 */
+	char *csv_cache_data = NULL;
+
+	/**
+	 * The cache full csv downloads are rendered into, so concurrent downloads of the same file only render it once.
+	 */
+	mutable ChunkCache csv_cache;
+
+	/**
+	 * All recording sessions that weren't deleted yet, ordered by id.
+	 */
+	std::vector<std::shared_ptr<RecordingSession>> sessions;
+
+	/**
+	 * The session shown on the web interface.
+	 */
+	std::shared_ptr<RecordingSession> current;
+
+	/**
+	 * The sessions the storage task adds samples to, indexed by sensor.
+	 * Only set while measuring or waiting for the reader task to start, and only for the sensors being recorded.
+	 */
+	std::shared_ptr<RecordingSession> recordings[MAX_SENSORS];
+
+	/**
+	 * Whether a new recording is being allocated, but not published in recordings yet.
+	 * Keeps the loop from pre-rendering csvs into the memory freed for it.
+	 * Guarded by sessions_mutex.
+	 */
+	bool recording_pending = false;
+
+	/**
+	 * The session the csv sizes are currently calculated for.
+	 * Only used by the task running loop.
+	 */
+	std::shared_ptr<RecordingSession> calculation;
+
+	/**
+	 * The session restored from the recording partition, as long as anything still references it.
+	 * Its sample streams are in flash, so the partition can't be overwritten while it exists.
+	 */
+	std::weak_ptr<RecordingSession> restored_session;
+
+	/**
+	 * The mutex guarding sessions, current, recordings, and restored_session.
+	 */
+	mutable std::mutex sessions_mutex;
+
+	/**
+	 * The id of the next session to be created.
+	 */
+	uint32_t next_session_id = 1;
+
+	/**
+	 * The configuration of the recording being taken, used by the reader task.
+	 */
+	uint8_t channels = CHANNEL_ALL;
+	uint8_t active_sensors = 1;
+	bool separate_mag = false;
+	uint16_t mag_frequency = 0;
+	uint32_t mag_interval_us = 0;
+	uint64_t last_mag_read[MAX_SENSORS] = { };
+
+	uint32_t measurements = 0;
+	uint16_t frequency = 50;
+	uint32_t measuring_time_target = 20000;
+
+	/**
+	 * Whether the output data rate was configured for the current recording.
+	 */
+	bool data_rate_set = false;
+
+	/**
+	 * The time between two conversions of the sensor source in microseconds.
+	 */
+	uint32_t odr_interval_us = 0;
+
+	/**
+	 * The sources the reader task can read the samples from.
+	 */
+	LSM9DS1Source lsm_sources[MAX_SENSORS] = { 0, 1, 2 };
+	SyntheticSource synthetic_sources[MAX_SENSORS] = { SyntheticSource( {
+			ACCEL_SCALE, GYRO_SCALE, MAG_SCALE }, 0), SyntheticSource( {
+			ACCEL_SCALE, GYRO_SCALE, MAG_SCALE }, 1), SyntheticSource( {
+			ACCEL_SCALE, GYRO_SCALE, MAG_SCALE }, 2) };
+	ReplaySource replay_source = ReplaySource( { ACCEL_SCALE, GYRO_SCALE,
+			MAG_SCALE });
+
+	/**
+	 * The sources read by the reader task, one per recorded sensor. Only changed while not measuring.
+	 */
+	SensorSource *sources[MAX_SENSORS] = { &lsm_sources[0] };
+	uint8_t sensor_count = 1;
+
+	/**
+	 * Whether the FIFOs of the sensors are drained periodically, instead of reading every conversion.
+	 * Used for recordings of multiple sensors, if all of them have a FIFO.
+	 */
+	bool fifo = false;
+
+	/**
+	 * The task reading the sensor, to notify when the LSM9DS1 has new data.
+	 */
+	TaskHandle_t acquisition_task = NULL;
+
+	/**
+	 * The task converting and storing the read samples.
+	 */
+	TaskHandle_t storage_task = NULL;
+
+	/**
+	 * The flash partition to persist recordings to.
+	 */
+	EspFlashPartition flash_partition = EspFlashPartition("recording");
+	RecordingStore recording_store = RecordingStore(&flash_partition);
+
+	/**
+	 * The state of persisting the last session written to flash.
+	 */
+	volatile PersistState persist_state = PERSIST_IDLE;
+
+	/**
+	 * The id of the last session written to flash, or 0 if none was written since booting.
+	 */
+	uint32_t persisted_session = 0;
+
+	/**
+	 * The raw samples read by the reader task, waiting to be stored by the storage task.
+	 */
+	SpscRing<RawSample, RING_SIZE> ring;
+
+	/**
+	 * The number of samples to be stored in the main stream the reader task passed to the storage task, for each sensor.
+	 */
+	uint32_t read_samples[MAX_SENSORS] = { };
+
+	uint64_t last_sample_us[MAX_SENSORS] = { };
+
+	/**
+	 * The time of the last FIFO drain of each sensor, in microseconds since boot.
+	 */
+	uint64_t last_drain_us[MAX_SENSORS] = { };
+
+	/**
+	 * The number of measurements of the current recording or stream that didn't fit into the ring.
+	 * Only written by the reader task.
+	 */
+	volatile uint32_t lost_samples = 0;
+
+	/**
+	 * Incremented by the reader task every time it finds nothing to measure, and isn't probing.
+	 * Used to detect that it stopped, before reconfiguring it for a new recording or stream.
+	 */
+	std::atomic<uint32_t> reader_idle_count { 0 };
+
+	/**
+	 * The value of reader_idle_count when the reader task was last asked to stop.
+	 * Guarded by sessions_mutex.
+	 */
+	uint32_t reader_stop_count = 0;
+
+	/**
+	 * The configuration of the last recording or stream started.
+	 * Guarded by sessions_mutex.
+	 */
+	ReaderConfig reader_config = { CHANNEL_ALL, 1, false, 50, 0, 0 };
+
+	/**
+	 * Whether reader_config is waiting for the storage task to apply it, and start the reader task.
+	 * Guarded by sessions_mutex.
+	 */
+	volatile bool reader_start_pending = false;
+	uint64_t measurement_start_us = 0;
+
+	volatile bool measuring = false;
+
+	/**
+	 * Whether the measurements are sent to the streamer, instead of being recorded.
+	 * Only valid while measuring is set.
+	 */
+	volatile bool streaming = false;
+
+	/**
+	 * The streamer sending measurements to a collector while streaming.
+	 */
+	TcpStreamer streamer;
+	EventGroupHandle_t eventGroup;
+
+	/**
+	 * The thresholds of the event detection of new recordings.
+	 */
+	EventSettings event_settings = { { SENSORS_GRAVITY_STANDARD, 5, 0 }, 0.2 };
+
+	/**
+	 * The progress of the current recording, for the web server tasks.
+	 * Only written by the storage task.
+	 */
+	Seqlock<RecordingStatus> recording_status;
+
+	/**
+	 * The progress of calculating the csv sizes.
+	 * Only used by the loop, which publishes it to calculation_status.
+	 */
+	CalculationStatus calculation_progress = { };
+
+	/**
+	 * The last published calculation_progress, for the web server tasks.
+	 */
+	Seqlock<CalculationStatus> calculation_status;
+
+	/**
+	 * The result of the last throughput probe. Written by the reader task, and begin before it is started.
+	 */
+	Seqlock<ThroughputProbe> probe_status;
+
+	/**
+	 * Whether the reader task should probe the throughput of the sensor sources once it is idle.
+	 */
+	volatile bool probe_requested = false;
 
-class LSM9DS1Handler {
-public:
 	/**
-	 * The number of floats to be recorder per measurement.
-	 * Default is 1x timestamp + 3x accelerometer + 3x magnetometer + 3x gyroscope.
+	 * The csv currently being pre-rendered, or nullptr if none is.
+	 * Only used by the loop.
 	 */
-	const uint8_t VALUES_PER_MEASUREMENT = 10;
+	std::unique_ptr<PrerenderJob> prerender;
 
 	/**
-	 * The number of different measurement csvs that can be downloaded after recording measurements.
+	 * The id of the session for which the last pre-rendered csv didn't fit into the free memory, or 0.
 	 */
-	const uint8_t MEASUREMENT_CSVS = 5;
+	uint32_t prerender_failed = 0;
 
 	/**
-	 * The bit to be set in the EventGroup when starting a measurement.
+	 * The internal RAM buffer parts of the pre-rendered csvs are generated into.
 	 */
-	const EventBits_t MEASURE_START_BIT = 1;
+	char *prerender_buffer = NULL;
+
 
 	/**
-	 * Creates a new LSM9DS1Handler for the given maximum amount of measurements.
+	 * Gets the session selected by the session argument of a request.
+	 * Requests without a session argument select the current session.
+	 * Responds to the request if the selected session doesn't exist.
 	 *
-	 * @param max_measurements	The max amount of measurements to be stored in this LSM9DS1Handler.
+	 * @param request	The HTTP web request to get the session for.
+	 * @return	The selected session, or NULL if it doesn't exist.
 	 */
-	LSM9DS1Handler(uint32_t max_measurements);
-	virtual ~LSM9DS1Handler();
-
-	void begin();
-	void setupSensor();
-	void loop();
+	std::shared_ptr<RecordingSession> getSession(
+			AsyncWebServerRequest *request) const;
 
 	/**
-	 * Starts a new recording session storing the given number of measurements.
+	 * Allocates and initializes a new recording session, without adding it to the session list.
 	 *
-	 * @param measurements	The number of measurements to take.
-	 * @param freq			The target measurement frequency. In measurements per second.
+	 * @param measurements	The number of measurements of the main sample stream.
+	 * @param values		The number of floats per measurement of the main sample stream.
+	 * @param channels		The bit mask of the recorded SensorChannels.
+	 * @param frequency		The measurement frequency of the main sample stream.
+	 * @param mag_frequency	The frequency of the magnetometer stream. 0 if there is none.
+	 * @param paged			Whether to store the sample streams in himem.
+	 * @return	The new session, or NULL if there wasn't enough free memory.
 	 */
-	void measure(uint32_t measurements, uint16_t freq);
+	std::shared_ptr<RecordingSession> createSession(const uint32_t measurements,
+			const uint8_t values, const uint8_t channels,
+			const uint16_t frequency, const uint16_t mag_frequency,
+			const bool paged);
 
-	void sendAllCsv(AsyncWebServerRequest *request) const {
-		const std::vector<const char*> headers = { "Acceleration X(m/s^2)",
-				"Acceleration Y(m/s^2)", "Acceleration Z(m/s^2)",
-				"Linear Acceleration X(m/s^2)", "Linear Acceleration Y(m/s^2)",
-				"Linear Acceleration Z(m/s^2)", "Rotation X(rad/s)",
-				"Rotation Y(rad/s)", "Rotation Z(rad/s)", "Magnetic X(uT)",
-				"Magnetic Y(uT)", "Magnetic Z(uT)" };
-		sendMeasurementsCsv(request, getAllGenerator(), headers, all_csv_size);
-	}
+	/**
+	 * Asks the reader task to stop, without waiting for it, and cancels a start still pending.
+	 * Samples still in the ring are dropped by the storage task.
+	 * Has to be called with sessions_mutex held.
+	 */
+	void stopReader();
 
-	void sendAccelerometerCsv(AsyncWebServerRequest *request) const {
-		const std::vector<const char*> headers = { "Acceleration X(m/s^2)",
-				"Acceleration Y(m/s^2)", "Acceleration Z(m/s^2)" };
-		sendMeasurementsCsv(request, headers, 1, acc_csv_size);
+	/**
+	 * Checks whether the reader task stopped since it was last asked to, and isn't probing the sensor sources.
+	 * Has to be called with sessions_mutex held.
+	 *
+	 * @return	True if the reader task doesn't access the sensor sources or the ring.
+	 */
+	bool isReaderStopped() const {
+		return !measuring && !probe_requested
+				&& reader_idle_count.load() != reader_stop_count;
 	}
 
-	void sendLinearAccelerometerCsv(AsyncWebServerRequest *request) const {
-		const std::vector<const char*> headers = {
-				"Linear Acceleration X(m/s^2)", "Linear Acceleration Y(m/s^2)",
-				"Linear Acceleration Z(m/s^2)" };
-		sendMeasurementsCsv(request, getLinearAccelerationGenerator(), headers,
-				lin_acc_csv_size);
-	}
+	/**
+	 * Applies the pending reader_config, and starts the reader task, once it stopped and the ring is empty.
+	 * Called by the storage task, so none of the samples read before end up in the new recording or stream.
+	 */
+	void startPendingReader();
 
-	void sendGyroscopeCsv(AsyncWebServerRequest *request) const {
-		const std::vector<const char*> headers = { "Rotation X(rad/s)",
-				"Rotation Y(rad/s)", "Rotation Z(rad/s)" };
-		sendMeasurementsCsv(request, headers, 4, gyro_csv_size);
-	}
+	/**
+	 * Resets the state of the reader task for a new recording or stream, and sets its start time.
+	 * May only be called while the reader task is stopped.
+	 */
+	void resetReader();
 
-	void sendMagnetometerCsv(AsyncWebServerRequest *request) const {
-		const std::vector<const char*> headers = { "Magnetic X(uT)",
-				"Magnetic Y(uT)", "Magnetic Z(uT)" };
-		sendMeasurementsCsv(request, headers, 7, mag_csv_size);
-	}
+	/**
+	 * Ends the recording of the sessions being recorded, and queues the calculation of their csv sizes.
+	 * Has to be called with sessions_mutex held.
+	 */
+	void endRecording();
 
-	void sendMeasurementsJson(AsyncWebServerRequest *request) const;
+	/**
+	 * Gets the number of floats required for the sample streams of a session with the given number of measurements.
+	 *
+	 * @param measurements	The number of measurements of the main sample stream.
+	 * @param values		The number of floats per measurement of the main sample stream.
+	 * @param mag_capacity	The number of samples of the magnetometer stream.
+	 * @return	The size of the sample streams in floats.
+	 */
+	static size_t getStreamsSize(const uint32_t measurements,
+			const uint8_t values, const uint32_t mag_capacity);
 
-	void sendCalculationsJson(AsyncWebServerRequest *request) const;
+	/**
+	 * Gets the number of floats required for the overview pyramids and the event index of a session with the given number of measurements.
+	 * Those are always stored in the directly mapped PSRAM.
+	 *
+	 * @param measurements	The number of measurements of the main sample stream.
+	 * @param values		The number of floats per measurement of the main sample stream.
+	 * @param mag_capacity	The number of samples of the magnetometer stream.
+	 * @return	The size of the overview pyramids and event index in floats.
+	 */
+	static size_t getIndexesSize(const uint32_t measurements,
+			const uint8_t values, const uint32_t mag_capacity);
 
-	const uint32_t getStoredMeasurements() const {
-		return measurements_stored;
-	}
+	/**
+	 * Gets the number of magnetometer samples to reserve for a session with a separate magnetometer stream.
+	 * Leaves space for the magnetometer samples taken in the same time, plus some for timing jitter.
+	 *
+	 * @param measurements	The number of measurements of the main sample stream.
+	 * @param frequency		The measurement frequency of the main sample stream.
+	 * @param mag_frequency	The frequency of the magnetometer stream. 0 if there is none.
+	 * @return	The capacity of the magnetometer stream.
+	 */
+	static uint32_t getMagCapacity(const uint32_t measurements,
+			const uint16_t frequency, const uint16_t mag_frequency);
 
-	const uint32_t getMeasurements() const {
-		return measurements;
-	}
+	/**
+	 * Calculates how many measurements of new sessions fit into the free memory.
+	 * Sessions are stored in the directly mapped PSRAM if they fit, and keep their sample streams in himem otherwise.
+	 *
+	 * @param measurements	The number of requested measurements.
+	 * @param values		The number of floats per measurement of the main sample stream.
+	 * @param frequency		The measurement frequency of the main sample stream.
+	 * @param mag_frequency	The frequency of the magnetometer stream. 0 if there is none.
+	 * @param paged			Set to whether the sample streams have to be stored in himem.
+	 * @param sessions		The number of sessions of this size to fit, one per recorded sensor.
+	 * @return	The number of measurements per session that fit, at most the requested number.
+	 */
+	uint32_t fitSession(const uint32_t measurements, const uint8_t values,
+			const uint16_t frequency, const uint16_t mag_frequency,
+			bool &paged, const uint8_t sessions = 1) const;
 
 	/**
-	 * Checks whether the esp is currently recording measurements.
+	 * Gets the headers of the all.csv for the channels of the given session.
 	 *
-	 * @return	True if a measurement is in progress.
+	 * @param session	The session to get the headers for.
+	 * @return	The headers of the all.csv.
 	 */
-	const bool isMeasuring() const {
-		return measuring;
-	}
+	const std::vector<const char*> getAllHeaders(
+			const RecordingSession &session) const;
 
 	/**
-	 * Get the time for one measurement in microseconds.
+	 * Prefixes the headers of a csv with the sensor of the session, if it was recorded together with other sensors.
 	 *
-	 * @return	The time for one measurement in microseconds.
+	 * @param session	The session the csv is generated from.
+	 * @param headers	The headers of the values of the csv.
+	 * @return	The headers to write to the csv.
 	 */
-	const uint16_t getMeasuringTime() const {
-		return measuring_time;
-	}
+	const std::vector<const char*> getSensorHeaders(
+			const RecordingSession &session,
+			const std::vector<const char*> &headers) const;
 
 	/**
-	 * Get the measurement start time in milliseconds.
+	 * Returns a function writing the magnetometer values for a measurement of the main sample stream.
+	 * Joins the magnetometer stream by timestamp if the magnetometer has its own stream.
 	 *
-	 * @return	The time when the current measurement series was started.
+	 * @param session	The session to read the values from.
+	 * @return	The function writing the magnetometer values.
 	 */
-	const uint64_t getMeasurementStart() const {
-		return measurement_start;
-	}
+	const ValueGenerator getMagnetometerGenerator(
+			const std::shared_ptr<const RecordingSession> session) const;
 
 	/**
-	 * Get the time spent measuring in milliseconds.
+	 * Returns a function writing all the values of a line of the all.csv.
 	 *
-	 * @return	The time spent measuring in milliseconds.
+	 * @param session		The session to read the values from.
+	 * @param algorithm		The sensor fusion algorithm to use for the linear acceleration.
+	 * @param magnetometer	Whether to use the magnetometer for the linear acceleration, if it was recorded.
+	 * @return	The function writing the values.
 	 */
-	const uint64_t getMeasurementDuration() const {
-		return measurement_duration;
-	}
+	const ValueGenerator getAllGenerator(
+			const std::shared_ptr<const RecordingSession> session,
+			const FusionAlgorithm algorithm = FUSION_MADGWICK,
+			const bool magnetometer = true) const;
 
 	/**
-	 * Checks whether the esp is currently generating the output files to determine their size.
+	 * Returns a function writing the linear acceleration, which is the acceleration without gravity.
+	 * The direction of gravity is estimated using an OrientationFilter with its own state.
 	 *
-	 * @return	True if the esp is generating the output files for this purpose.
+	 * @param session		The session to read the values from.
+	 * @param algorithm		The sensor fusion algorithm to use.
+	 * @param magnetometer	Whether to use the magnetometer, if it was recorded.
+	 * 						Without it the filter uses 6DOF updates.
+	 * @return	The function writing the linear acceleration.
 	 */
-	const bool isCalculating() const {
-		return calculating;
-	}
+	const ValueGenerator getLinearAccelerationGenerator(
+			const std::shared_ptr<const RecordingSession> session,
+			const FusionAlgorithm algorithm = FUSION_MADGWICK,
+			const bool magnetometer = true) const;
 
 	/**
-	 * Gets the name of the measurements csv for which the size is currently being calculated.
+	 * Gets the sensor fusion settings for the linear acceleration from the arguments of a request.
+	 * fusion selects the algorithm, and a magnetometer argument of false selects 6DOF updates.
+	 * Responds with an error if the algorithm is unknown.
 	 *
-	 * @return	The name of the csv being generated.
+	 * @param request		The HTTP web request to get the arguments from.
+	 * @param algorithm		A reference to write the selected algorithm to.
+	 * @param magnetometer	A reference to write whether to use the magnetometer to.
+	 * @return	False if the request was answered with an error.
 	 */
-	const std::string getFileCalculating() const {
-		return file_calculating;
-	}
+	bool getFusionArgs(AsyncWebServerRequest *request,
+			FusionAlgorithm &algorithm, bool &magnetometer) const;
 
 	/**
-	 * Gets the number of measurement csvs for which the file size has already be determined.
+	 * Checks whether the given fusion settings are the ones the csv sizes are calculated for.
 	 *
-	 * @return	The number of measurement csvs for which the file size has already be determined.
+	 * @param algorithm		The sensor fusion algorithm.
+	 * @param magnetometer	Whether the magnetometer is used.
+	 * @return	True if these are the default settings.
 	 */
-	const uint8_t getFilesCalculated() const {
-		return calculated;
+	static bool isDefaultFusion(const FusionAlgorithm algorithm,
+			const bool magnetometer) {
+		return algorithm == FUSION_MADGWICK && magnetometer;
 	}
 
 	/**
-	 * Get the calculation start time in milliseconds.
+	 * Returns a function that writes the values of a line of a measurement csv from the recorded measurements.
+	 * The function keeps a reference to the session, so its data stays available while the function exists.
 	 *
-	 * @return	The calculation start time in milliseconds.
+	 * @param session	The session to read the values from.
+	 * @param samples	The sample stream of the session to read the values from.
+	 * @param index		The number of values in a sample before the ones that should be written to the csv.
+	 * @param channels	The number of values per measurement that should be written to the csv.
+	 * @return	The function actually generating the output.
 	 */
-	const uint64_t getCalculationStart() const {
-		return calculation_start;
-	}
+	const ValueGenerator getDataContentGenerator(
+			const std::shared_ptr<const RecordingSession> session,
+			const SampleStream &samples, const uint8_t index,
+			uint8_t channels = 3) const;
 
 	/**
-	 * Resets the LSM0DS1Handler to a state where it is neither recording measurements nor calculating csv sizes.
+	 * Returns a function that writes the values of a line of a measurement csv from the main sample stream.
+	 *
+	 * @param session	The session to read the values from.
+	 * @param index		The number of values in a sample before the ones that should be written to the csv.
+	 * @param channels	The number of values per measurement that should be written to the csv.
+	 * @return	The function actually generating the output.
 	 */
-	void resetMeasurements() {
-		measurements_stored = 0;
-		measuring = false;
-		file_calculating = "";
-		calculated = 0;
-		calculating = false;
+	const ValueGenerator getDataContentGenerator(
+			const std::shared_ptr<const RecordingSession> session,
+			const uint8_t index, uint8_t channels = 3) const {
+		return getDataContentGenerator(session, session->samples, index,
+				channels);
 	}
 
-private:
-#ifdef LSM9DS1_I2C
-	Adafruit_LSM9DS1 lsm; // Use I2C to connect to the lsm9ds1
-#elif defined(LSM9DS1_SPI)
-	Adafruit_LSM9DS1 lsm = Adafruit_LSM9DS1(22, 32, 21, LSM9DS1_XGCS,
-			LSM9DS1_MCS); // Use Software SPI to connect to the lsm9ds1
-#endif
-
-	const uint32_t measurements_max;
-	const uint32_t data_size;
-
-	float *data = NULL;
-	uint32_t last_timestamp = 0;
-
-	uint32_t measurements_stored = 0;
-	uint32_t measurements = 0;
-
-	uint16_t frequency = 50;
-	uint32_t measuring_time = 0;
-	uint32_t measuring_time_target = 20000;
-
-	uint64_t measurement_start = 0;
-	uint32_t measurement_duration = 0;
-
-	bool measuring = false;
-	EventGroupHandle_t eventGroup;
-
-	std::string file_calculating;
-	uint8_t calculated = 0;
-	uint64_t calculation_start = 0;
-	bool calculating = false;
-
-	size_t all_csv_size = 0;
-	size_t lin_acc_csv_size = 0;
-	size_t acc_csv_size = 0;
-	size_t gyro_csv_size = 0;
-	size_t mag_csv_size = 0;
-
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> getAllGenerator() const;
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> getLinearAccelerationGenerator() const;
-
 	/**
-	 * Returns a function that writes a line of a measurement csv from the recording measurements in the data array.
+	 * Returns a function that low pass filters the values of the given generator,
+	 * to downsample them by the given factor without aliasing.
+	 * The returned function has to be called with increasing sample indices, usually every factor-th one.
+	 * It starts filtering at the first index it is called with.
+	 * It runs the given generator for all the samples in between.
 	 *
-	 * The returned function gets a char pointer to write to,
-	 * the character to separate values with,
-	 * and the number of measurements that were already written.
-	 * It returns the number of characters that were written.
+	 * @param generator	The function generating the values to downsample.
+	 * @param factor	The downsampling factor.
+	 * @return	The function writing the filtered values.
+	 */
+	const ValueGenerator getDecimatingGenerator(const ValueGenerator generator,
+			const uint16_t factor) const;
+
+	/**
+	 * Responds to a request for a measurements csv whose sensors weren't recorded.
 	 *
-	 * @param index		The number of values in the data array before the ones that should be written to the csv.
-	 * @param channels	The number of values per measurement that should be written to the csv.
-	 * @return	The function actually generating the output.
+	 * @param request	The HTTP web request requesting the measurements csv.
+	 * @param sensors	The name of the sensor(s) required for the requested csv.
 	 */
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> getDataContentGenerator(
-			const uint8_t index, uint8_t channels = 3) const;
+	void sendNotRecorded(AsyncWebServerRequest *request,
+			const char *sensors) const;
 
 	/**
 	 * Generates a measurements csv and sends it to a client.
 	 *
 	 * @param request		The HTTP web request requesting the measurements csv.
+	 * @param session		The session to export.
 	 * @param headers		A vector containing the headers for the generated measurements csv.
 	 * @param index			The index of the first value to to write to the csv in a measurement.
 	 * @param content_len	The total size of the measurements csv in bytes.
+	 * @param rendered		The pre-rendered full csv, or nullptr if it isn't available.
 	 */
 	void sendMeasurementsCsv(AsyncWebServerRequest *request,
+			const std::shared_ptr<const RecordingSession> session,
 			const std::vector<const char*> headers, const uint8_t index,
-			const size_t content_len) const {
-		sendMeasurementsCsv(request,
-				getDataContentGenerator(index, headers.size()), headers,
-				content_len);
+			const size_t content_len,
+			const std::shared_ptr<const RenderedCsv> rendered) const {
+		const uint8_t channels = headers.size();
+		sendMeasurementsCsv(request, session, session->samples,
+				[this, session, index, channels]() {
+					return getDataContentGenerator(session, index, channels);
+				}, headers, content_len, rendered);
 	}
 
 	/**
 	 * Sends a measurements csv to a client.
+	 * If the request has a rate argument lower than the recorded rate, the measurements are downsampled.
+	 * If it has range arguments, only the selected slice of the measurements is sent.
 	 *
 	 * @param request			The HTTP web request requesting the measurements csv.
-	 * @param content_generator	The function generating a single line of the measurements csv.
-	 * @param headers			A vector containing the headers for the generated measurements csv.
-	 * @param content_len		The total size of the measurements csv in bytes.
+	 * @param session			The session to export. Kept alive until the csv is sent.
+	 * @param samples			The sample stream of the session with one sample per line of the csv.
+	 * @param generator_factory	The function creating the generator for a single line of the measurements csv.
+	 * @param value_headers		A vector containing the headers for the generated measurements csv.
+	 * 							Prefixed with the sensor for sessions recorded together with other sensors.
+	 * @param content_len		The total size of the full measurements csv in bytes.
+	 * @param rendered			The pre-rendered full csv with the default separator, or nullptr if it isn't available.
+	 * 							Full downloads with the default separator are copied from it.
 	 */
 	void sendMeasurementsCsv(AsyncWebServerRequest *request,
-			const std::function<size_t(char*, const uint8_t, const uint32_t)> content_generator,
+			const std::shared_ptr<const RecordingSession> session,
+			const SampleStream &samples,
+			const ValueGeneratorFactory generator_factory,
+			const std::vector<const char*> value_headers,
+			const size_t content_len,
+			const std::shared_ptr<const RenderedCsv> rendered) const;
+
+	/**
+	 * Gets the generator, sample stream, and headers for a full measurements csv.
+	 *
+	 * @param session	The session to export.
+	 * @param csv		The measurements csv to get the generator for.
+	 * @param samples	A reference to write the sample stream with one sample per line of the csv to.
+	 * @param generator	A reference to write the function generating a single line of the csv to.
+	 * @param headers	A reference to write the headers of the csv to.
+	 * @return	False if the csv is unknown.
+	 */
+	bool getCsvGenerator(const std::shared_ptr<const RecordingSession> session,
+			const MeasurementCsv csv, const SampleStream *&samples,
+			ValueGenerator &generator,
+			std::vector<const char*> &headers) const;
+
+	/**
+	 * Renders the next part of a measurements csv of the current session into spare PSRAM.
+	 * Renders the files in the order of MeasurementCsv, as long as they fit into the free memory.
+	 * Does nothing while a recording is running.
+	 *
+	 * @return	True if something was rendered, false if there is nothing left to do.
+	 */
+	bool prerenderCsv();
+
+	/**
+	 * Drops all pre-rendered csvs, to free their memory for a new recording.
+	 * Their memory is freed once all downloads copying them are finished.
+	 */
+	void dropRenderedCsvs();
+
+	/**
+	 * Gets a pre-rendered csv of a session, if it is complete.
+	 *
+	 * @param session	The session to get the csv of.
+	 * @param csv		The csv to get.
+	 * @return	The pre-rendered csv, or nullptr if it isn't complete.
+	 */
+	const std::shared_ptr<const RenderedCsv> getRenderedCsv(
+			const RecordingSession &session, const MeasurementCsv csv) const;
+
+	/**
+	 * Gets the slice of a sample stream selected by the range arguments of a request.
+	 * from_ms and to_ms select the samples by timestamp, from_index and to_index select them by index.
+	 * event selects around_ms(500 by default) before and after the peak of an event of the session.
+	 * The end of the range is inclusive for to_ms, and exclusive for to_index.
+	 * The warmup of the range starts CSV_WARMUP_MS before its start.
+	 *
+	 * @param request	The HTTP web request to get the range arguments from.
+	 * @param session	The session the sample stream belongs to.
+	 * @param samples	The sample stream to find the range in.
+	 * @return	The selected slice, or all samples if the request has no range arguments.
+	 */
+	SampleRange getSampleRange(AsyncWebServerRequest *request,
+			const RecordingSession &session,
+			const SampleStream &samples) const;
+
+	/**
+	 * Calculates the size of a measurements csv by generating it without sending it.
+	 *
+	 * @param samples			The sample stream with one sample per line of the csv.
+	 * @param range				The slice of the stream to write to the csv.
+	 * @param content_generator	The function generating a single line of the csv.
+	 * @param headers			A vector containing the headers for the measurements csv.
+	 * @param step				The number of samples to advance per line of the csv.
+	 * @return	The size of the csv in bytes.
+	 */
+	size_t getMeasurementCsvSize(const SampleStream &samples,
+			const SampleRange &range, const ValueGenerator content_generator,
 			const std::vector<const char*> headers,
-			const size_t content_len) const;
+			const uint16_t step = 1) const;
 
 	/**
 	 * Generates a part of the a measurements csv.
 	 *
 	 * @param separator_char	The character to be used to separate values in the csv.
-	 * @param position			The index of the last value that was already written to the csv.
+	 * @param position			The index of the next sample to write to the csv.
 	 * 							Used for the next call to continue where the last one left off.
+	 * 							The header is written if this is the start of the range.
+	 * @param samples			The sample stream with one sample per line of the csv.
+	 * @param range				The slice of the stream to write to the csv.
 	 * @param content_generator	The function generating a single line of the csv.
 	 * @param headers			A vector containing the headers for the generated measurements csv.
 	 * @param buffer			The output buffer to write the content to.
 	 * @param maxlen			The max length of the content to generate.
+	 * @param step				The number of samples to advance per line of the csv.
 	 * @return	The number of bytes generated.
 	 */
 	size_t generateMeasurementCsv(const uint8_t separator_char,
-			uint32_t &position,
-			const std::function<size_t(char*, const uint8_t, const uint32_t)> content_generator,
+			uint32_t &position, const SampleStream &samples,
+			const SampleRange &range, const ValueGenerator content_generator,
 			const std::vector<const char*> headers, char *buffer,
-			size_t maxlen) const;
+			size_t maxlen, const uint16_t step = 1) const;
 
 	/**
 	 * Generates a part of the a measurements csv.
 	 *
 	 * @param separator_char	The character to be used to separate values in the csv.
-	 * @param position			The index of the last value that was already written to the csv.
+	 * @param position			The index of the next sample to write to the csv.
 	 * 							Used for the next call to continue where the last one left off.
+	 * 							The header is written if this is the start of the range.
+	 * @param samples			The sample stream with one sample per line of the csv.
+	 * @param range				The slice of the stream to write to the csv.
 	 * @param content_generator	The function generating a single line of the csv.
 	 * @param headers			A vector containing the headers for the generated measurements csv.
 	 * @param buffer			The output buffer to write the content to.
 	 * @param maxlen			The max length of the content to generate.
+	 * @param step				The number of samples to advance per line of the csv.
 	 * @return	The number of bytes generated.
 	 */
 	size_t generateMeasurementCsv(const uint8_t separator_char,
-			uint32_t &position,
-			const std::function<size_t(char*, const uint8_t, const uint32_t)> content_generator,
+			uint32_t &position, const SampleStream &samples,
+			const SampleRange &range, const ValueGenerator content_generator,
 			const std::vector<const char*> headers, uint8_t *buffer,
-			size_t maxlen) const {
-		return generateMeasurementCsv(separator_char, position,
-				content_generator, headers, (char*) buffer, maxlen);
+			size_t maxlen, const uint16_t step = 1) const {
+		return generateMeasurementCsv(separator_char, position, samples,
+				range, content_generator, headers, (char*) buffer, maxlen,
+				step);
+	}
+
+	/**
+	 * Checks whether measurements are taken when the sensor source signals new data.
+	 *
+	 * @return	True if sampling is driven by the data ready interrupt.
+	 */
+	const bool isDataReadyDriven() const {
+		return sources[0]->isDataReadyDriven(channels);
 	}
 
+	/**
+	 * Waits for and reads a single sample from each sensor source, and passes them to the storage task.
+	 * With multiple sensors with a FIFO, waits for and drains their FIFOs instead.
+	 * Waits for a recording to start if there is none.
+	 */
+	void readSample();
+
+	/**
+	 * Reads a sample from one sensor source, and passes it to the storage task.
+	 * Decides whether the sample is stored, and whether the separate magnetometer is due.
+	 *
+	 * @param sensor	The index of the sensor to read.
+	 * @param start_us	The time the sample was taken at, in microseconds since boot.
+	 */
+	void readSensor(const uint8_t sensor, const uint64_t start_us);
+
+	/**
+	 * Waits for FIFO_DRAIN_INTERVAL_MS, and then reads all conversions in the FIFO of each sensor.
+	 * The timestamps of the buffered conversions are reconstructed from the output data rate.
+	 */
+	void drainFifos();
+
+	/**
+	 * Checks whether a session is being recorded.
+	 * Has to be called with sessions_mutex held.
+	 *
+	 * @param session	The session to check.
+	 * @return	True if the storage task adds samples to the session.
+	 */
+	bool isRecording(const std::shared_ptr<RecordingSession> &session) const;
+
+	/**
+	 * Gets the number of LSM9DS1 sensors that were found at boot.
+	 *
+	 * @return	The number of connected sensors.
+	 */
+	uint8_t getConnectedSensors() const;
+
+	/**
+	 * Converts and stores all samples in the ring, and updates the values derived from them.
+	 * Waits for new samples if there are none.
+	 */
+	void storeSamples();
+
+	/**
+	 * Loads the recording persisted in the flash recording partition as a new session, if there is one.
+	 * Its samples are read directly from the memory mapped partition.
+	 */
+	void restoreRecording();
+
+	/**
+	 * The function running in a new task writing a recording session to flash.
+	 *
+	 * @param parameter	A pointer to a PersistParameter with the session to persist.
+	 */
+	static void persistTask(void *parameter);
+
+	/**
+	 * Converts and stores a single raw sample.
+	 *
+	 * @param session	The session to store the sample in.
+	 * @param raw		The sample to store.
+	 */
+	void storeSample(RecordingSession &session, const RawSample &raw);
+
+	/**
+	 * Updates the event detection of a session with a measurement.
+	 * The accelerometer magnitude is measured relative to gravity, so a resting sensor is at 0.
+	 *
+	 * @param events		The event index to update.
+	 * @param channels		The bit mask of the SensorChannels in the measurement.
+	 * @param measurement	The measurement, starting with its timestamp.
+	 * @param index			The index of the measurement in its stream.
+	 */
+	static void detectEvents(EventIndex &events, const uint8_t channels,
+			const float *measurement, const uint32_t index);
+
+	/**
+	 * Converts the values of a raw sample to SI units, and writes them to a measurement.
+	 * The measurement starts with the timestamp, followed by the values of the recorded channels.
+	 * The magnetometer values are skipped if the magnetometer is recorded separately.
+	 *
+	 * @param raw			The sample to convert.
+	 * @param measurement	The measurement to write to. Has to fit SampleStream::MAX_STRIDE values.
+	 * @return	The number of values written to the measurement.
+	 */
+	uint8_t convertSample(const RawSample &raw, float *measurement) const {
+		return convertSample(raw, measurement, channels, separate_mag);
+	}
+
+	/**
+	 * Converts the values of a raw sample to SI units, and writes the given channels to a measurement.
+	 *
+	 * @param raw			The sample to convert.
+	 * @param measurement	The measurement to write to. Has to fit SampleStream::MAX_STRIDE values.
+	 * @param channels		The bit mask of the SensorChannels to write.
+	 * @param separate_mag	Whether to skip the magnetometer, because it is recorded separately.
+	 * @return	The number of values written to the measurement.
+	 */
+	uint8_t convertSample(const RawSample &raw, float *measurement,
+			const uint8_t channels, const bool separate_mag) const;
+
+	/**
+	 * Times reading and storing PROBE_SAMPLES samples of the selected sensor sources, for every channel selection,
+	 * and publishes the resulting max sustainable frequencies.
+	 * Only called while nothing is measured, by begin and the idle reader task.
+	 */
+	void probeThroughput();
+
+	/**
+	 * Stops the current stream, if there is one.
+	 */
+	void endStream();
+
+	/**
+	 * The function of the high priority task reading the sensor.
+	 *
+	 * @param handler	A pointer to the LSM9DS1Handler to read the sensor of.
+	 */
+	static void readerTask(void *handler);
+
+	/**
+	 * The function of the task storing the read samples.
+	 *
+	 * @param handler	A pointer to the LSM9DS1Handler to store the samples of.
+	 */
+	static void storageTask(void *handler);
+
+	/**
+	 * The interrupt handler for the INT1 pin, notifying the acquisition task about new data.
+	 *
+	 * @param handler	A pointer to the LSM9DS1Handler to notify.
+	 */
+	static void onDataReady(void *handler);
+
 	/**
 	 * The function running in a new task generating the measurement csv to send to a client.
 	 *
 	 * @param parameter	A pointer to a CsvGeneratorParameter containing all the required variables.
 	 */
 	static void csvGenerator(void *parameter);
+
+	/**
+	 * The function running in a new task rendering a full measurement csv into the csv cache.
+	 * Runs until the file is completely rendered, or all its downloads were aborted.
+	 *
+	 * @param parameter	A pointer to a ChunkRendererParameter containing the file to render.
+	 */
+	static void chunkRenderer(void *parameter);
+
+	/**
+	 * Whether a spectrum is currently being calculated.
+	 * Only one is calculated at a time, to limit the internal RAM usage.
+	 */
+	volatile bool spectrum_calculating = false;
+
+	/**
+	 * The function running in a new task calculating the spectrum to send to a client.
+	 *
+	 * @param parameter	A pointer to a shared_ptr to the SpectrumParameter to calculate.
+	 */
+	static void spectrumCalculator(void *parameter);
+
+	/**
+	 * Whether a fusion benchmark is currently running.
+	 * Only one runs at a time, so they don't skew each others timings.
+	 */
+	volatile bool fusion_benchmark_running = false;
+
+	/**
+	 * The function running in a new task benchmarking the sensor fusion algorithms.
+	 *
+	 * @param parameter	A pointer to a shared_ptr to the FusionBenchmarkParameter to run.
+	 */
+	static void fusionBenchmark(void *parameter);
 };
 
 /**
@@ -415,12 +1759,15 @@ private:
 struct CsvGeneratorParameter {
 	CsvGeneratorParameter(const LSM9DS1Handler *handler, BufferStream *stream,
 			size_t buffer_len, char *buffer,
-			const std::function<size_t(char*, const uint8_t, const uint32_t)> content_gen,
+			const std::shared_ptr<const RecordingSession> session,
+			const SampleStream *samples, const SampleRange range, const ValueGenerator content_gen,
 			const std::vector<const char*> headers, const size_t content_len,
-			const uint8_t separator_char) :
+			const uint8_t separator_char, const uint16_t step) :
 			handler(handler), stream(stream), buffer_len(buffer_len), buffer(
-					buffer), content_gen(content_gen), headers(headers), content_len(
-					content_len), separator_char(separator_char) {
+					buffer), session(session), samples(samples), range(range), content_gen(
+					content_gen), headers(
+					headers), content_len(content_len), separator_char(
+					separator_char), step(step) {
 	}
 
 	~CsvGeneratorParameter() {
@@ -432,10 +1779,137 @@ struct CsvGeneratorParameter {
 	BufferStream *stream;
 	size_t buffer_len;
 	char *buffer;
-	const std::function<size_t(char*, const uint8_t, const uint32_t)> content_gen;
+
+	/**
+	 * The session being exported, kept alive until the csv is sent.
+	 */
+	const std::shared_ptr<const RecordingSession> session;
+	const SampleStream *samples;
+	const SampleRange range;
+	const ValueGenerator content_gen;
 	const std::vector<const char*> headers;
 	const size_t content_len;
 	const uint8_t separator_char;
+	const uint16_t step;
+
+	/**
+	 * The Metrics endpoint to count the generated bytes for.
+	 */
+	uint8_t endpoint = Metrics::NO_ENDPOINT;
+};
+
+struct ChunkRendererParameter {
+	ChunkCache *cache;
+	ChunkCache::File *file;
+	Metrics *metrics;
+};
+
+/**
+ * A reader of the csv cache, which is closed when the last response using it is destroyed.
+ */
+struct CsvCacheReader {
+	CsvCacheReader(ChunkCache *cache, ChunkCache::Reader *reader) :
+			cache(cache), reader(reader) {
+	}
+
+	~CsvCacheReader() {
+		cache->close(reader);
+	}
+
+	ChunkCache *const cache;
+	ChunkCache::Reader *const reader;
+};
+
+struct SpectrumParameter {
+	SpectrumParameter(const LSM9DS1Handler *handler,
+			const std::shared_ptr<const RecordingSession> session,
+			const SampleStream *samples, const uint8_t value,
+			const uint8_t index, const uint16_t nfft, const uint32_t start,
+			const uint32_t end, volatile bool *calculating) :
+			handler(handler), session(session), samples(samples), value(value), index(
+					index), nfft(nfft), start(start), end(end), calculating(
+					calculating) {
+	}
+
+	const LSM9DS1Handler *handler;
+	const std::shared_ptr<const RecordingSession> session;
+	const SampleStream *samples;
+	const uint8_t value;
+	const uint8_t index;
+	const uint16_t nfft;
+	const uint32_t start;
+	const uint32_t end;
+	volatile bool *calculating;
+	std::string result;
+	size_t sent = 0;
+	volatile bool done = false;
+	volatile bool aborted = false;
+};
+
+struct FusionBenchmarkParameter {
+	FusionBenchmarkParameter(
+			const std::shared_ptr<const RecordingSession> session,
+			const uint32_t start, const uint32_t end,
+			volatile bool *running, Metrics *metrics) :
+			session(session), start(start), end(end), running(running), metrics(
+					metrics) {
+	}
+
+	const std::shared_ptr<const RecordingSession> session;
+	const uint32_t start;
+	const uint32_t end;
+	volatile bool *running;
+	Metrics *metrics;
+	std::string result;
+	size_t sent = 0;
+	volatile bool done = false;
+	volatile bool aborted = false;
+};
+
+struct OverviewParameter {
+	/**
+	 * The state of a single stream of an overview response.
+	 */
+	struct Stream {
+		const OverviewPyramid *pyramid;
+		const SampleStream *samples;
+		std::vector<uint8_t> values;
+		uint32_t start;
+		uint32_t end;
+		uint32_t bucket_samples;
+	};
+
+	/**
+	 * The session the overview is generated for, kept alive until the response is sent.
+	 */
+	std::shared_ptr<const RecordingSession> session;
+
+	std::vector<Stream> streams;
+
+	/**
+	 * The stream currently being written, or streams.size() once all of them are written.
+	 */
+	size_t stream = 0;
+
+	/**
+	 * The index of the first sample of the next bucket to write.
+	 */
+	uint32_t position = 0;
+
+	/**
+	 * Whether the first bucket of the current stream was already written.
+	 */
+	bool started = false;
+
+	/**
+	 * Generated json that didn't fit into the last chunk.
+	 */
+	std::string pending;
+};
+
+struct PersistParameter {
+	LSM9DS1Handler *handler;
+	std::shared_ptr<const RecordingSession> session;
 };
 
 #endif /* SRC_LSM9DS1HANDLER_H_ */
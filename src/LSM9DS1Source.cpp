@@ -0,0 +1,142 @@
+/*
+ * LSM9DS1Source.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LSM9DS1Source.h"
+#include "RecordingSession.h"
+#include "Trace.h"
+
+LSM9DS1Source::LSM9DS1Source(const uint8_t sensor) :
+		lsm(sensor), sensor(sensor) {
+}
+
+bool LSM9DS1Source::begin() {
+	if (!lsm.begin()) {
+		return false;
+	}
+
+#ifdef LSM9DS1_I2C
+	Serial.println("Connected to the lsm9ds1 using I2C.");
+#elif defined(LSM9DS1_SPI)
+	Serial.print("Connected to lsm9ds1 ");
+	Serial.print(sensor);
+	Serial.println(" using SPI.");
+#endif
+
+	// Run the magnetometer at its max regular output data rate, in ultra high performance mode.
+	lsm.write8(LSM9DS1_MAG, LSM9DS1_REGISTER_CTRL_REG1_M, 0b01111100);
+	lsm.write8(LSM9DS1_MAG, LSM9DS1_REGISTER_CTRL_REG4_M, 0b00001100);
+
+	connected = true;
+	return true;
+}
+
+uint32_t LSM9DS1Source::setDataRate(const uint8_t channels,
+		const uint16_t frequency) {
+	const bool gyro = channels & CHANNEL_GYROSCOPE;
+	const float *rates = gyro ? GYRO_ODRS : ACCEL_ODRS;
+
+	uint8_t odr = 6;
+	for (uint8_t i = 0; i < 6; i++) {
+		if (rates[i] >= frequency) {
+			odr = i + 1;
+			break;
+		}
+	}
+
+	// Keep the full scale selection, and let the accelerometer bandwidth follow the ODR.
+	uint8_t ctrl_reg6_xl = lsm.read8(LSM9DS1_XG,
+			LSM9DS1_REGISTER_CTRL_REG6_XL);
+	ctrl_reg6_xl &= 0b00011000;
+	ctrl_reg6_xl |= odr << 5;
+
+	// Explicitly select the highest anti-aliasing bandwidth below half the ODR.
+	// The two lowest rates(14.9Hz and 59.5Hz, or 10Hz and 50Hz without the gyroscope) have no bandwidth below half their ODR,
+	// so they use the narrowest one available.
+	// 0b00 is 408Hz, 0b01 211Hz, 0b10 105Hz, and 0b11 50Hz.
+	static const uint8_t bandwidths[] = { 0b11, 0b11, 0b11, 0b10, 0b01, 0b00 };
+	ctrl_reg6_xl |= 0b100 | bandwidths[odr - 1];
+
+	// The gyroscope is powered down by setting its ODR to 0.
+	// Its bandwidth selection only applies to the optional second low pass filter, which stays disabled.
+	uint8_t ctrl_reg1_g = lsm.read8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG1_G);
+	ctrl_reg1_g &= 0b00011000;
+	if (gyro) {
+		ctrl_reg1_g |= odr << 5;
+	}
+
+	lsm.write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG1_G, ctrl_reg1_g);
+	lsm.write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG6_XL, ctrl_reg6_xl);
+
+	// Signal data ready of the accelerometer, or the gyroscope if the accelerometer isn't recorded.
+	lsm.write8(LSM9DS1_XG, LSM9DS1_REGISTER_INT1_CTRL,
+			(channels & CHANNEL_ACCELEROMETER) ? 0b01 : 0b10);
+
+	return 1000000 / rates[odr - 1];
+}
+
+bool LSM9DS1Source::isDataReadyDriven(const uint8_t channels) const {
+#ifdef LSM9DS1_DRDY
+	return channels & (CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE);
+#else
+	return false;
+#endif
+}
+
+void LSM9DS1Source::setFifo(const bool enabled) {
+	// FIFO_EN is bit 1 of CTRL_REG9, continuous mode is FMODE 0b110 in FIFO_CTRL.
+	uint8_t ctrl_reg9 = lsm.read8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG9);
+	if (enabled) {
+		ctrl_reg9 |= 0b10;
+	} else {
+		ctrl_reg9 &= ~0b10;
+	}
+
+	// Switching to bypass mode first empties the FIFO.
+	lsm.write8(LSM9DS1_XG, LSM9DS1_REGISTER_FIFO_CTRL, 0);
+	lsm.write8(LSM9DS1_XG, LSM9DS1_REGISTER_CTRL_REG9, ctrl_reg9);
+	if (enabled) {
+		lsm.write8(LSM9DS1_XG, LSM9DS1_REGISTER_FIFO_CTRL, 0b110 << 5);
+	}
+}
+
+uint8_t LSM9DS1Source::getFifoLevel() {
+	// FSS is the low six bits of FIFO_SRC, and only reaches FIFO_SIZE when the FIFO is full.
+	return lsm.read8(LSM9DS1_XG, LSM9DS1_REGISTER_FIFO_SRC) & 0b111111;
+}
+
+void LSM9DS1Source::read(const uint8_t sensors, int16_t *accel,
+		int16_t *gyro, int16_t *mag) {
+	// Only read the register blocks of the requested sensors.
+	// The blocks are read in register order, the gyroscope before the accelerometer.
+	if (sensors & CHANNEL_GYROSCOPE) {
+		TRACE_SPAN(TRACE_SENSOR_READ);
+		lsm.readGyro(gyro);
+	}
+
+	if (sensors & CHANNEL_ACCELEROMETER) {
+		TRACE_SPAN(TRACE_SENSOR_READ);
+		lsm.readAccel(accel);
+	}
+
+	if (sensors & CHANNEL_MAGNETOMETER) {
+		TRACE_SPAN(TRACE_SENSOR_READ);
+		lsm.readMag(mag);
+	}
+}
@@ -0,0 +1,137 @@
+/*
+ * LSM9DS1Source.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_LSM9DS1SOURCE_H_
+#define SRC_LSM9DS1SOURCE_H_
+
+#include "LSM9DS1Driver.h"
+
+/**
+ * The SensorSource reading the LSM9DS1 using the LSM9DS1Driver.
+ */
+class LSM9DS1Source: public SensorSource {
+public:
+	/**
+	 * The number of accelerometer and gyroscope conversions the FIFO of the LSM9DS1 can hold.
+	 */
+	static const uint8_t FIFO_SIZE = 32;
+
+	/**
+	 * Creates a new LSM9DS1Source for one of the sensors on the SPI bus.
+	 *
+	 * @param sensor	The index of the sensor, selecting its chip select pins.
+	 */
+	LSM9DS1Source(const uint8_t sensor);
+
+	/**
+	 * The output data rates supported by the accelerometer and gyroscope, in measurements per second.
+	 * The ODR register value for a rate is its index + 1.
+	 * The accelerometer runs at the gyroscope rate while the gyroscope is active.
+	 */
+	const float GYRO_ODRS[6] = { 14.9, 59.5, 119, 238, 476, 952 };
+
+	/**
+	 * The output data rates supported by the accelerometer while the gyroscope is powered down.
+	 * The ODR register value for a rate is its index + 1.
+	 */
+	const float ACCEL_ODRS[6] = { 10, 50, 119, 238, 476, 952 };
+
+	const char* getName() const override {
+		return "lsm9ds1";
+	}
+
+	bool isAvailable() const override {
+		return connected;
+	}
+
+	/**
+	 * Connects to the LSM9DS1, and sets up its ranges and the magnetometer data rate.
+	 *
+	 * @return	False if the LSM9DS1 didn't respond.
+	 */
+	bool begin();
+
+	/**
+	 * Configures the output data rate of the accelerometer and gyroscope.
+	 * Uses the lowest rate at or above the target measurement frequency,
+	 * and powers down the gyroscope if it isn't recorded.
+	 * Also routes the data ready signal of the first recorded sensor to the INT1 pin.
+	 *
+	 * @param channels	The bit mask of the SensorChannels being recorded.
+	 * @param frequency	The target measurement frequency, in measurements per second.
+	 * @return	The time between two conversions of the accelerometer and gyroscope, in microseconds.
+	 */
+	uint32_t setDataRate(const uint8_t channels, const uint16_t frequency)
+			override;
+
+	/**
+	 * Checks whether new conversions are signalled on the INT1 pin.
+	 * This requires the INT1 pin to be connected and the accelerometer or gyroscope to be recorded.
+	 *
+	 * @param channels	The bit mask of the SensorChannels being recorded.
+	 * @return	True if sampling is driven by the data ready interrupt.
+	 */
+	bool isDataReadyDriven(const uint8_t channels) const override;
+
+	bool hasFifo() const override {
+		return true;
+	}
+
+	/**
+	 * Switches the FIFO between continuous mode and bypass mode.
+	 * In continuous mode the oldest conversion is overwritten when the FIFO is full.
+	 *
+	 * @param enabled	Whether to use the FIFO.
+	 */
+	void setFifo(const bool enabled) override;
+
+	/**
+	 * Reads the number of unread conversions from the FIFO status register.
+	 *
+	 * @return	The number of buffered conversions.
+	 */
+	uint8_t getFifoLevel() override;
+
+	/**
+	 * Reads the register blocks of the given sensors.
+	 *
+	 * @param sensors	The bit mask of the SensorChannels to read.
+	 * @param accel		The array to write the three accelerometer values to.
+	 * @param gyro		The array to write the three gyroscope values to.
+	 * @param mag		The array to write the three magnetometer values to.
+	 */
+	void read(const uint8_t sensors, int16_t *accel, int16_t *gyro,
+			int16_t *mag) override;
+
+private:
+	LSM9DS1Driver lsm;
+
+	/**
+	 * The index of this sensor on the SPI bus.
+	 */
+	const uint8_t sensor;
+
+	/**
+	 * Whether the LSM9DS1 responded to begin.
+	 */
+	bool connected = false;
+};
+
+#endif /* SRC_LSM9DS1SOURCE_H_ */
@@ -0,0 +1,95 @@
+/*
+ * LowPassFilter.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LowPassFilter.h"
+#include <math.h>
+
+LowPassFilter::LowPassFilter(const uint8_t channels, const float cutoff) :
+		channels(channels), state(new float[channels * SECTIONS * 2]()), last(
+				new float[channels]) {
+	for (uint8_t channel = 0; channel < channels; channel++) {
+		last[channel] = NAN;
+	}
+
+	// The quality factors of the sections of a fourth order butterworth filter.
+	const float qualities[SECTIONS] = { 0.54119610f, 1.3065630f };
+
+	const float w0 = 2 * M_PI * cutoff;
+	const float cos_w0 = cosf(w0);
+	for (uint8_t i = 0; i < SECTIONS; i++) {
+		const float alpha = sinf(w0) / (2 * qualities[i]);
+		const float a0 = 1 + alpha;
+		b0[i] = (1 - cos_w0) / 2 / a0;
+		b1[i] = (1 - cos_w0) / a0;
+		b2[i] = b0[i];
+		a1[i] = -2 * cos_w0 / a0;
+		a2[i] = (1 - alpha) / a0;
+	}
+}
+
+LowPassFilter::~LowPassFilter() {
+	delete[] state;
+	delete[] last;
+}
+
+void LowPassFilter::reset(const float *values) {
+	for (uint8_t channel = 0; channel < channels; channel++) {
+		last[channel] = NAN;
+		if (isfinite(values[channel])) {
+			resetChannel(channel, values[channel]);
+		}
+	}
+}
+
+void LowPassFilter::resetChannel(const uint8_t channel, const float value) {
+	float *z = state + channel * SECTIONS * 2;
+	// With a DC gain of one every section outputs its input in the steady state.
+	for (uint8_t i = 0; i < SECTIONS; i++) {
+		z[i * 2 + 1] = value * (b2[i] - a2[i]);
+		z[i * 2] = value * (b1[i] - a1[i]) + z[i * 2 + 1];
+	}
+	last[channel] = value;
+}
+
+void LowPassFilter::update(const float *input, float *output) {
+	for (uint8_t channel = 0; channel < channels; channel++) {
+		float value = input[channel];
+		if (!isfinite(value)) {
+			if (isnan(last[channel])) {
+				output[channel] = value;
+				continue;
+			}
+			value = last[channel];
+		} else if (isnan(last[channel])) {
+			resetChannel(channel, value);
+		} else {
+			last[channel] = value;
+		}
+
+		float *z = state + channel * SECTIONS * 2;
+		for (uint8_t i = 0; i < SECTIONS; i++) {
+			const float result = b0[i] * value + z[i * 2];
+			z[i * 2] = b1[i] * value - a1[i] * result + z[i * 2 + 1];
+			z[i * 2 + 1] = b2[i] * value - a2[i] * result;
+			value = result;
+		}
+		output[channel] = value;
+	}
+}
@@ -0,0 +1,93 @@
+/*
+ * LowPassFilter.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_LOWPASSFILTER_H_
+#define SRC_LOWPASSFILTER_H_
+
+#include <stdint.h>
+
+/**
+ * A fourth order butterworth low pass filter for multiple channels.
+ * Implemented as a cascade of two biquad sections in transposed direct form II.
+ * Used as the anti-aliasing filter when downsampling measurements.
+ * Non-finite inputs, like the magnetometer values before its first measurement, are skipped,
+ * so a single one can't turn the state of its channel into NaN forever.
+ */
+class LowPassFilter {
+public:
+	/**
+	 * Creates a new LowPassFilter.
+	 *
+	 * @param channels	The number of values in each filtered sample.
+	 * @param cutoff	The cutoff frequency relative to the sample rate.
+	 * 					Has to be less than 0.5.
+	 */
+	LowPassFilter(const uint8_t channels, const float cutoff);
+	virtual ~LowPassFilter();
+
+	/**
+	 * Sets the filter state as if the given sample had been applied forever.
+	 * This prevents the output from starting at zero.
+	 * Channels with a non-finite value start at their first finite input instead.
+	 *
+	 * @param values	The values of the sample to start with.
+	 */
+	void reset(const float *values);
+
+	/**
+	 * Filters the next sample.
+	 * The input and output may be the same array.
+	 * A non-finite value is replaced by the last finite one of its channel, or kept if there was none yet.
+	 *
+	 * @param input		The values of the sample to filter.
+	 * @param output	The array to write the filtered values to.
+	 */
+	void update(const float *input, float *output);
+
+private:
+	static const uint8_t SECTIONS = 2;
+
+	const uint8_t channels;
+	float b0[SECTIONS];
+	float b1[SECTIONS];
+	float b2[SECTIONS];
+	float a1[SECTIONS];
+	float a2[SECTIONS];
+
+	/**
+	 * The two delay elements of each section for each channel.
+	 */
+	float *state;
+
+	/**
+	 * The last finite input of each channel, or NAN if there was none yet.
+	 */
+	float *last;
+
+	/**
+	 * Sets the state of a single channel as if the given value had been applied forever.
+	 *
+	 * @param channel	The index of the channel to reset.
+	 * @param value		The value to start with.
+	 */
+	void resetChannel(const uint8_t channel, const float value);
+};
+
+#endif /* SRC_LOWPASSFILTER_H_ */
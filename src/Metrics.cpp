@@ -0,0 +1,276 @@
+/*
+ * Metrics.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Metrics.h"
+#include <esp_heap_caps.h>
+#include <sstream>
+
+const uint32_t Metrics::LATENCY_BOUNDS_MS[LATENCY_BUCKETS] = { 5, 10, 25, 50,
+		100, 250, 500, 1000, 5000, 30000 };
+
+uint8_t Metrics::addEndpoint(const char *uri) {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (uint8_t i = 0; i < endpoint_count; i++) {
+		if (strcmp(endpoints[i].uri, uri) == 0) {
+			return i;
+		}
+	}
+
+	if (endpoint_count >= MAX_ENDPOINTS) {
+		return NO_ENDPOINT;
+	}
+
+	endpoints[endpoint_count] = { uri, { 0 }, 0, 0, 0 };
+	return endpoint_count++;
+}
+
+void Metrics::track(AsyncWebServerRequest *request, const uint8_t endpoint) {
+	if (endpoint == NO_ENDPOINT) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Request &state = requests[request];
+		state.endpoint = endpoint;
+		state.start = esp_timer_get_time();
+	}
+
+	request->onDisconnect([this, request]() {
+		finish(request);
+	});
+}
+
+void Metrics::onDisconnect(AsyncWebServerRequest *request,
+		ArDisconnectHandler callback) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<AsyncWebServerRequest*, Request>::iterator state =
+				requests.find(request);
+		if (state != requests.end()) {
+			state->second.callbacks.push_back(callback);
+			return;
+		}
+	}
+
+	request->onDisconnect(callback);
+}
+
+uint8_t Metrics::getEndpoint(AsyncWebServerRequest *request) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<AsyncWebServerRequest*, Request>::const_iterator state =
+			requests.find(request);
+	return state == requests.end() ? NO_ENDPOINT : state->second.endpoint;
+}
+
+void Metrics::addSent(const uint8_t endpoint, const size_t bytes) {
+	if (endpoint == NO_ENDPOINT) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	endpoints[endpoint].sent += bytes;
+}
+
+AwsResponseFiller Metrics::countSent(AsyncWebServerRequest *request,
+		const AwsResponseFiller filler) {
+	const uint8_t endpoint = getEndpoint(request);
+	return [this, endpoint, filler](uint8_t *buffer, size_t maxLen,
+			size_t index) -> size_t {
+		const size_t length = filler(buffer, maxLen, index);
+		if (length != RESPONSE_TRY_AGAIN) {
+			addSent(endpoint, length);
+		}
+		return length;
+	};
+}
+
+void Metrics::startDownload(AsyncWebServerRequest *request) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		active_downloads++;
+	}
+
+	onDisconnect(request, [this]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		active_downloads--;
+	});
+}
+
+void Metrics::rejectDownload() {
+	std::lock_guard<std::mutex> lock(mutex);
+	rejected_downloads++;
+}
+
+void Metrics::watchTask(const char *name, const TaskHandle_t handle) {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (uint8_t i = 0; i < task_count; i++) {
+		if (strcmp(tasks[i].name, name) == 0) {
+			return;
+		}
+	}
+
+	if (task_count < MAX_TASKS) {
+		tasks[task_count++] = { name, handle, UINT32_MAX };
+	}
+}
+
+void Metrics::recordStack(const char *name, const TaskHandle_t handle) {
+	const uint32_t free = uxTaskGetStackHighWaterMark(handle);
+	std::lock_guard<std::mutex> lock(mutex);
+	for (uint8_t i = 0; i < task_count; i++) {
+		if (strcmp(tasks[i].name, name) == 0) {
+			tasks[i].min_free = min(tasks[i].min_free, free);
+			return;
+		}
+	}
+
+	if (task_count < MAX_TASKS) {
+		tasks[task_count++] = { name, NULL, free };
+	}
+}
+
+void Metrics::finish(AsyncWebServerRequest *request) {
+	Request state;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<AsyncWebServerRequest*, Request>::iterator it = requests.find(
+				request);
+		if (it == requests.end()) {
+			return;
+		}
+		state = std::move(it->second);
+		requests.erase(it);
+
+		const uint64_t duration = esp_timer_get_time() - state.start;
+		Endpoint &endpoint = endpoints[state.endpoint];
+		uint8_t bucket = 0;
+		while (bucket < LATENCY_BUCKETS
+				&& duration > LATENCY_BOUNDS_MS[bucket] * 1000ull) {
+			bucket++;
+		}
+		endpoint.buckets[bucket]++;
+		endpoint.count++;
+		endpoint.sum_us += duration;
+	}
+
+	// Called without holding the mutex, since these may take a while.
+	for (const ArDisconnectHandler &callback : state.callbacks) {
+		callback();
+	}
+}
+
+void Metrics::sendMetrics(AsyncWebServerRequest *request) {
+	// This is always called from the web server task.
+	watchTask("async_tcp", xTaskGetCurrentTaskHandle());
+
+	static const char *HEAP_NAMES[] = { "internal", "psram" };
+	static const uint32_t HEAP_CAPS[] = { MALLOC_CAP_INTERNAL, MALLOC_CAP_SPIRAM };
+
+	std::ostringstream metrics;
+	metrics << "# HELP esp_uptime_seconds Time since boot.\n"
+			<< "# TYPE esp_uptime_seconds gauge\n" << "esp_uptime_seconds "
+			<< esp_timer_get_time() / 1000000 << '\n';
+
+	metrics << "# HELP esp_heap_free_bytes Currently free heap memory.\n"
+			<< "# TYPE esp_heap_free_bytes gauge\n";
+	for (uint8_t i = 0; i < 2; i++) {
+		metrics << "esp_heap_free_bytes{heap=\"" << HEAP_NAMES[i] << "\"} "
+				<< heap_caps_get_free_size(HEAP_CAPS[i]) << '\n';
+	}
+
+	metrics << "# HELP esp_heap_largest_free_block_bytes The largest block of heap memory that can be allocated.\n"
+			<< "# TYPE esp_heap_largest_free_block_bytes gauge\n";
+	for (uint8_t i = 0; i < 2; i++) {
+		metrics << "esp_heap_largest_free_block_bytes{heap=\""
+				<< HEAP_NAMES[i] << "\"} "
+				<< heap_caps_get_largest_free_block(HEAP_CAPS[i]) << '\n';
+	}
+
+	metrics << "# HELP esp_heap_min_free_bytes The least free heap memory since boot.\n"
+			<< "# TYPE esp_heap_min_free_bytes gauge\n";
+	for (uint8_t i = 0; i < 2; i++) {
+		metrics << "esp_heap_min_free_bytes{heap=\"" << HEAP_NAMES[i] << "\"} "
+				<< heap_caps_get_minimum_free_size(HEAP_CAPS[i]) << '\n';
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		metrics << "# HELP esp_task_stack_min_free_bytes The least free stack of a task seen so far.\n"
+				<< "# TYPE esp_task_stack_min_free_bytes gauge\n";
+		for (uint8_t i = 0; i < task_count; i++) {
+			Task &task = tasks[i];
+			if (task.handle != NULL) {
+				task.min_free = min(task.min_free,
+						(uint32_t) uxTaskGetStackHighWaterMark(task.handle));
+			}
+			metrics << "esp_task_stack_min_free_bytes{task=\"" << task.name
+					<< "\"} " << task.min_free << '\n';
+		}
+
+		metrics << "# HELP esp_downloads_active The number of csv downloads currently being sent.\n"
+				<< "# TYPE esp_downloads_active gauge\n" << "esp_downloads_active "
+				<< active_downloads << '\n'
+				<< "# HELP esp_downloads_rejected_total The number of csv downloads that couldn't be started.\n"
+				<< "# TYPE esp_downloads_rejected_total counter\n"
+				<< "esp_downloads_rejected_total " << rejected_downloads << '\n';
+
+		metrics << "# HELP esp_http_sent_bytes_total The response body bytes of downloads and pages sent per endpoint.\n"
+				<< "# TYPE esp_http_sent_bytes_total counter\n";
+		for (uint8_t i = 0; i < endpoint_count; i++) {
+			if (endpoints[i].sent > 0) {
+				metrics << "esp_http_sent_bytes_total{endpoint=\""
+						<< endpoints[i].uri << "\"} " << endpoints[i].sent << '\n';
+			}
+		}
+
+		// Endpoints without requests are left out, to keep the response small.
+		metrics << "# HELP esp_http_request_duration_seconds The time from receiving a request until its client disconnected.\n"
+				<< "# TYPE esp_http_request_duration_seconds histogram\n";
+		for (uint8_t i = 0; i < endpoint_count; i++) {
+			const Endpoint &endpoint = endpoints[i];
+			if (endpoint.count == 0) {
+				continue;
+			}
+
+			uint32_t cumulative = 0;
+			for (uint8_t bucket = 0; bucket <= LATENCY_BUCKETS; bucket++) {
+				cumulative += endpoint.buckets[bucket];
+				metrics << "esp_http_request_duration_seconds_bucket{endpoint=\""
+						<< endpoint.uri << "\",le=\"";
+				if (bucket < LATENCY_BUCKETS) {
+					metrics << LATENCY_BOUNDS_MS[bucket] / 1000.0;
+				} else {
+					metrics << "+Inf";
+				}
+				metrics << "\"} " << cumulative << '\n';
+			}
+			metrics << "esp_http_request_duration_seconds_sum{endpoint=\""
+					<< endpoint.uri << "\"} " << endpoint.sum_us / 1000000.0 << '\n'
+					<< "esp_http_request_duration_seconds_count{endpoint=\""
+					<< endpoint.uri << "\"} " << endpoint.count << '\n';
+		}
+	}
+
+	AsyncWebServerResponse *response = request->beginResponse(200,
+			"text/plain; version=0.0.4", metrics.str().c_str());
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+}
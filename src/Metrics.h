@@ -0,0 +1,211 @@
+/*
+ * Metrics.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_METRICS_H_
+#define SRC_METRICS_H_
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * Collects the telemetry of the web server and the system, and exposes it in the Prometheus text format.
+ *
+ * Requests are tracked from the time their handler is called until their client disconnects.
+ * So the latency of a download includes sending all of it.
+ *
+ * Everything is kept in fixed size counters, and the memory and stack statistics are only read while rendering.
+ * So scraping the metrics every few seconds doesn't disturb a running recording.
+ */
+class Metrics {
+public:
+	/**
+	 * The value returned by getEndpoint for requests that aren't tracked.
+	 */
+	static const uint8_t NO_ENDPOINT = 0xFF;
+
+	/**
+	 * The max number of distinct endpoints to track.
+	 */
+	static const uint8_t MAX_ENDPOINTS = 40;
+
+	/**
+	 * The max number of tasks whose stack is monitored.
+	 */
+	static const uint8_t MAX_TASKS = 12;
+
+	/**
+	 * The number of latency histogram buckets, not counting the implicit +Inf bucket.
+	 */
+	static const uint8_t LATENCY_BUCKETS = 10;
+
+	/**
+	 * The upper bounds of the latency histogram buckets, in milliseconds.
+	 */
+	static const uint32_t LATENCY_BOUNDS_MS[LATENCY_BUCKETS];
+
+	/**
+	 * Creates a new Metrics instance without any endpoints or tasks.
+	 */
+	Metrics() {
+	}
+
+	Metrics(const Metrics &other) = delete;
+	Metrics& operator=(const Metrics &other) = delete;
+
+	/**
+	 * Adds an endpoint to track, or gets the index of an already added one.
+	 *
+	 * @param uri	The uri of the endpoint. Has to stay valid forever.
+	 * @return	The index of the endpoint, or NO_ENDPOINT if there are too many.
+	 */
+	uint8_t addEndpoint(const char *uri);
+
+	/**
+	 * Starts tracking a request to the given endpoint.
+	 * Has to be called before the request is handled, since this sets the disconnect handler of the request.
+	 *
+	 * @param request	The request to track.
+	 * @param endpoint	The index of the endpoint the request is for.
+	 */
+	void track(AsyncWebServerRequest *request, const uint8_t endpoint);
+
+	/**
+	 * Adds a function to call when the client of a request disconnects.
+	 * Has to be used instead of AsyncWebServerRequest::onDisconnect, which would replace the tracking.
+	 *
+	 * @param request	The request to add the disconnect handler to.
+	 * @param callback	The function to call on disconnect.
+	 */
+	void onDisconnect(AsyncWebServerRequest *request, ArDisconnectHandler callback);
+
+	/**
+	 * Gets the endpoint a tracked request is for.
+	 *
+	 * @param request	The request to get the endpoint of.
+	 * @return	The index of the endpoint, or NO_ENDPOINT if the request isn't tracked.
+	 */
+	uint8_t getEndpoint(AsyncWebServerRequest *request) const;
+
+	/**
+	 * Adds bytes to the number of bytes sent for an endpoint.
+	 *
+	 * @param endpoint	The index of the endpoint.
+	 * @param bytes		The number of bytes sent.
+	 */
+	void addSent(const uint8_t endpoint, const size_t bytes);
+
+	/**
+	 * Creates a response filler counting the bytes produced by the given filler as sent for the endpoint of a request.
+	 *
+	 * @param request	The request the response is for.
+	 * @param filler	The filler producing the response body.
+	 * @return	The counting filler.
+	 */
+	AwsResponseFiller countSent(AsyncWebServerRequest *request,
+			const AwsResponseFiller filler);
+
+	/**
+	 * Counts a download as active until the client of its request disconnects.
+	 *
+	 * @param request	The request of the download.
+	 */
+	void startDownload(AsyncWebServerRequest *request);
+
+	/**
+	 * Counts a download request that was rejected, because the data wasn't ready or the download couldn't be started.
+	 */
+	void rejectDownload();
+
+	/**
+	 * Adds a long running task whose stack high water mark should be reported.
+	 * Does nothing if a task with the given name is already watched.
+	 *
+	 * @param name		The name to report the task as. Has to stay valid forever.
+	 * @param handle	The handle of the task.
+	 */
+	void watchTask(const char *name, const TaskHandle_t handle);
+
+	/**
+	 * Records the stack high water mark of the calling task, or of the given one.
+	 * Used for short lived tasks, whose smallest high water mark so far is reported.
+	 *
+	 * @param name		The name to report the task as. Has to stay valid forever.
+	 * @param handle	The task to check, or NULL for the calling task.
+	 */
+	void recordStack(const char *name, const TaskHandle_t handle = NULL);
+
+	/**
+	 * Sends all the metrics in the Prometheus text format.
+	 *
+	 * @param request	The HTTP web request requesting the metrics.
+	 */
+	void sendMetrics(AsyncWebServerRequest *request);
+
+private:
+	/**
+	 * The counters of a single endpoint.
+	 */
+	struct Endpoint {
+		const char *uri;
+		uint32_t buckets[LATENCY_BUCKETS + 1];
+		uint32_t count;
+		uint64_t sum_us;
+		uint64_t sent;
+	};
+
+	/**
+	 * A monitored task, and the smallest stack high water mark seen for it.
+	 */
+	struct Task {
+		const char *name;
+		TaskHandle_t handle;
+		uint32_t min_free;
+	};
+
+	/**
+	 * The state of a tracked request.
+	 */
+	struct Request {
+		uint8_t endpoint;
+		int64_t start;
+		std::vector<ArDisconnectHandler> callbacks;
+	};
+
+	/**
+	 * Stops tracking a request whose client disconnected, and adds its latency to the histogram of its endpoint.
+	 *
+	 * @param request	The request that ended.
+	 */
+	void finish(AsyncWebServerRequest *request);
+
+	Endpoint endpoints[MAX_ENDPOINTS];
+	uint8_t endpoint_count = 0;
+	Task tasks[MAX_TASKS];
+	uint8_t task_count = 0;
+	std::map<AsyncWebServerRequest*, Request> requests;
+	uint32_t active_downloads = 0;
+	uint32_t rejected_downloads = 0;
+	mutable std::mutex mutex;
+};
+
+#endif /* SRC_METRICS_H_ */
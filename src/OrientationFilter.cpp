@@ -0,0 +1,287 @@
+/*
+ * OrientationFilter.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OrientationFilter.h"
+#include "Trace.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * The standard gravity in m/s^2.
+ */
+static const float GRAVITY = 9.80665f;
+
+const char *const OrientationFilter::ALGORITHM_NAMES[FUSION_ALGORITHMS] = {
+		"madgwick", "mahony" };
+
+OrientationFilter::OrientationFilter(const FusionAlgorithm algorithm,
+		const float frequency) :
+		algorithm(algorithm), half_period(0.5f / frequency), beta(0.1f), two_kp(
+				2.0f * 0.5f), two_ki(2.0f * 0.0f) {
+}
+
+void OrientationFilter::update(const float *accel, const float *gyro,
+		const float *mag) {
+	TRACE_SPAN(TRACE_ORIENTATION_UPDATE);
+	float a[3];
+	const float a_norm = accel[0] * accel[0] + accel[1] * accel[1]
+			+ accel[2] * accel[2];
+	if (a_norm != 0) {
+		const float recip_norm = invSqrt(a_norm);
+		for (uint8_t i = 0; i < 3; i++) {
+			a[i] = accel[i] * recip_norm;
+		}
+	}
+
+	float m[3];
+	float m_norm = 0;
+	if (mag) {
+		m_norm = mag[0] * mag[0] + mag[1] * mag[1] + mag[2] * mag[2];
+		if (m_norm != 0) {
+			const float recip_norm = invSqrt(m_norm);
+			for (uint8_t i = 0; i < 3; i++) {
+				m[i] = mag[i] * recip_norm;
+			}
+		}
+	}
+
+	// Without a valid accelerometer reading the magnetometer isn't used either, like in the Adafruit implementation.
+	const float *a_values = a_norm != 0 ? a : NULL;
+	const float *m_values = m_norm != 0 ? m : NULL;
+	if (algorithm == FUSION_MAHONY) {
+		updateMahony(a_values, gyro, m_values);
+	} else {
+		updateMadgwick(a_values, gyro, m_values);
+	}
+}
+
+void OrientationFilter::getGravity(float *gravity) const {
+	gravity[0] = 2 * GRAVITY * (q1 * q3 - q0 * q2);
+	gravity[1] = 2 * GRAVITY * (q0 * q1 + q2 * q3);
+	gravity[2] = 2 * GRAVITY * (q0 * q0 - 0.5f + q3 * q3);
+}
+
+void OrientationFilter::getQuaternion(float *quaternion) const {
+	quaternion[0] = q0;
+	quaternion[1] = q1;
+	quaternion[2] = q2;
+	quaternion[3] = q3;
+}
+
+float OrientationFilter::invSqrt(const float x) {
+	const float half_x = 0.5f * x;
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(float));
+	bits = 0x5f3759df - (bits >> 1);
+	float y;
+	memcpy(&y, &bits, sizeof(float));
+	y = y * (1.5f - (half_x * y * y));
+	y = y * (1.5f - (half_x * y * y));
+	return y;
+}
+
+void OrientationFilter::updateMadgwick(const float *a, const float *g,
+		const float *m) {
+	// Rate of change of the quaternion from the gyroscope, already scaled by the sample period.
+	float q_dot0 = half_period * (-q1 * g[0] - q2 * g[1] - q3 * g[2]);
+	float q_dot1 = half_period * (q0 * g[0] + q2 * g[2] - q3 * g[1]);
+	float q_dot2 = half_period * (q0 * g[1] - q1 * g[2] + q3 * g[0]);
+	float q_dot3 = half_period * (q0 * g[2] + q1 * g[1] - q2 * g[0]);
+
+	if (a) {
+		const float ax = a[0], ay = a[1], az = a[2];
+		const float _2q0 = 2.0f * q0;
+		const float _2q1 = 2.0f * q1;
+		const float _2q2 = 2.0f * q2;
+		const float _2q3 = 2.0f * q3;
+		const float q0q0 = q0 * q0;
+		const float q1q1 = q1 * q1;
+		const float q2q2 = q2 * q2;
+		const float q3q3 = q3 * q3;
+
+		// The gradient of the objective function.
+		float s0, s1, s2, s3;
+		if (m) {
+			const float mx = m[0], my = m[1], mz = m[2];
+			const float _2q0mx = 2.0f * q0 * mx;
+			const float _2q0my = 2.0f * q0 * my;
+			const float _2q0mz = 2.0f * q0 * mz;
+			const float _2q1mx = 2.0f * q1 * mx;
+			const float _2q0q2 = 2.0f * q0 * q2;
+			const float _2q2q3 = 2.0f * q2 * q3;
+			const float q0q1 = q0 * q1;
+			const float q0q2 = q0 * q2;
+			const float q0q3 = q0 * q3;
+			const float q1q2 = q1 * q2;
+			const float q1q3 = q1 * q3;
+			const float q2q3 = q2 * q3;
+
+			// Reference direction of the earth's magnetic field.
+			const float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1
+					+ _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+			const float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2
+					- my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+			const float _2bx = sqrtf(hx * hx + hy * hy);
+			const float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0
+					+ _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2
+					+ mz * q3q3;
+			const float _4bx = 2.0f * _2bx;
+			const float _4bz = 2.0f * _2bz;
+
+			// The errors of the estimated gravity and magnetic field directions.
+			const float fax = 2.0f * q1q3 - _2q0q2 - ax;
+			const float fay = 2.0f * q0q1 + _2q2q3 - ay;
+			const float faz = 1 - 2.0f * q1q1 - 2.0f * q2q2 - az;
+			const float fmx = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2)
+					- mx;
+			const float fmy = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+			const float fmz = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2)
+					- mz;
+
+			s0 = -_2q2 * fax + _2q1 * fay - _2bz * q2 * fmx
+					+ (-_2bx * q3 + _2bz * q1) * fmy + _2bx * q2 * fmz;
+			s1 = _2q3 * fax + _2q0 * fay - 4.0f * q1 * faz + _2bz * q3 * fmx
+					+ (_2bx * q2 + _2bz * q0) * fmy
+					+ (_2bx * q3 - _4bz * q1) * fmz;
+			s2 = -_2q0 * fax + _2q3 * fay - 4.0f * q2 * faz
+					+ (-_4bx * q2 - _2bz * q0) * fmx
+					+ (_2bx * q1 + _2bz * q3) * fmy
+					+ (_2bx * q0 - _4bz * q2) * fmz;
+			s3 = _2q1 * fax + _2q2 * fay + (-_4bx * q3 + _2bz * q1) * fmx
+					+ (-_2bx * q0 + _2bz * q2) * fmy + _2bx * q1 * fmz;
+		} else {
+			const float _4q0 = 4.0f * q0;
+			const float _4q1 = 4.0f * q1;
+			const float _4q2 = 4.0f * q2;
+			const float _8q1 = 8.0f * q1;
+			const float _8q2 = 8.0f * q2;
+
+			s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+			s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1
+					+ _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+			s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2
+					+ _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+			s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+		}
+
+		// Apply the normalized gradient as feedback, with the sample period folded into the step size.
+		const float step = 2 * half_period * beta
+				* invSqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+		q_dot0 -= step * s0;
+		q_dot1 -= step * s1;
+		q_dot2 -= step * s2;
+		q_dot3 -= step * s3;
+	}
+
+	q0 += q_dot0;
+	q1 += q_dot1;
+	q2 += q_dot2;
+	q3 += q_dot3;
+	normalize();
+}
+
+void OrientationFilter::updateMahony(const float *a, const float *g,
+		const float *m) {
+	float gx = g[0], gy = g[1], gz = g[2];
+
+	if (a) {
+		const float ax = a[0], ay = a[1], az = a[2];
+		const float q0q0 = q0 * q0;
+		const float q0q1 = q0 * q1;
+		const float q0q2 = q0 * q2;
+		const float q0q3 = q0 * q3;
+		const float q1q1 = q1 * q1;
+		const float q1q2 = q1 * q2;
+		const float q1q3 = q1 * q3;
+		const float q2q2 = q2 * q2;
+		const float q2q3 = q2 * q3;
+		const float q3q3 = q3 * q3;
+
+		// Estimated direction of gravity.
+		const float halfvx = q1q3 - q0q2;
+		const float halfvy = q0q1 + q2q3;
+		const float halfvz = q0q0 - 0.5f + q3q3;
+
+		// The error is the cross product between the estimated and measured directions.
+		float halfex = ay * halfvz - az * halfvy;
+		float halfey = az * halfvx - ax * halfvz;
+		float halfez = ax * halfvy - ay * halfvx;
+
+		if (m) {
+			const float mx = m[0], my = m[1], mz = m[2];
+
+			// Reference direction of the earth's magnetic field.
+			const float hx = 2.0f
+					* (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3)
+							+ mz * (q1q3 + q0q2));
+			const float hy = 2.0f
+					* (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3)
+							+ mz * (q2q3 - q0q1));
+			const float bx = sqrtf(hx * hx + hy * hy);
+			const float bz = 2.0f
+					* (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1)
+							+ mz * (0.5f - q1q1 - q2q2));
+
+			// Estimated direction of the magnetic field.
+			const float halfwx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+			const float halfwy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+			const float halfwz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+
+			halfex += my * halfwz - mz * halfwy;
+			halfey += mz * halfwx - mx * halfwz;
+			halfez += mx * halfwy - my * halfwx;
+		}
+
+		if (two_ki > 0) {
+			integral[0] += two_ki * halfex * 2 * half_period;
+			integral[1] += two_ki * halfey * 2 * half_period;
+			integral[2] += two_ki * halfez * 2 * half_period;
+			gx += integral[0];
+			gy += integral[1];
+			gz += integral[2];
+		} else {
+			integral[0] = integral[1] = integral[2] = 0;
+		}
+
+		gx += two_kp * halfex;
+		gy += two_kp * halfey;
+		gz += two_kp * halfez;
+	}
+
+	gx *= half_period;
+	gy *= half_period;
+	gz *= half_period;
+	const float qa = q0;
+	const float qb = q1;
+	const float qc = q2;
+	q0 += -qb * gx - qc * gy - q3 * gz;
+	q1 += qa * gx + qc * gz - q3 * gy;
+	q2 += qa * gy - qb * gz + q3 * gx;
+	q3 += qa * gz + qb * gy - qc * gx;
+	normalize();
+}
+
+void OrientationFilter::normalize() {
+	const float recip_norm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+	q0 *= recip_norm;
+	q1 *= recip_norm;
+	q2 *= recip_norm;
+	q3 *= recip_norm;
+}
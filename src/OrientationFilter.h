@@ -0,0 +1,143 @@
+/*
+ * OrientationFilter.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_ORIENTATIONFILTER_H_
+#define SRC_ORIENTATIONFILTER_H_
+
+#include <stdint.h>
+
+/**
+ * The sensor fusion algorithms an OrientationFilter can use.
+ */
+enum FusionAlgorithm {
+	FUSION_MADGWICK, FUSION_MAHONY, FUSION_ALGORITHMS
+};
+
+/**
+ * A single precision orientation filter estimating the direction of gravity.
+ * Implements the same Madgwick and Mahony filters as the Adafruit AHRS library,
+ * but takes the values in the units they are recorded in, rather than converting them for every sample.
+ */
+class OrientationFilter {
+public:
+	/**
+	 * The names of the FusionAlgorithms, as used in request arguments.
+	 */
+	static const char *const ALGORITHM_NAMES[FUSION_ALGORITHMS];
+
+	/**
+	 * Creates a new OrientationFilter, using the default gains of the Adafruit AHRS library.
+	 *
+	 * @param algorithm		The fusion algorithm to use.
+	 * @param frequency		The sample frequency to integrate the gyroscope values with.
+	 */
+	OrientationFilter(const FusionAlgorithm algorithm, const float frequency);
+
+	/**
+	 * Updates the orientation with the next sample.
+	 * The accelerometer and magnetometer values only define directions, so their units don't matter.
+	 * Falls back to a 6DOF update if no magnetometer values are given, or they are all zero.
+	 *
+	 * @param accel	The three accelerometer values.
+	 * @param gyro	The three gyroscope values. In rad/s.
+	 * @param mag	The three magnetometer values, or NULL to ignore the magnetometer.
+	 */
+	void update(const float *accel, const float *gyro, const float *mag);
+
+	/**
+	 * Writes the gravity vector in the sensor frame to the given array.
+	 *
+	 * @param gravity	The array to write the three values to. In m/s^2.
+	 */
+	void getGravity(float *gravity) const;
+
+	/**
+	 * Writes the current orientation quaternion to the given array.
+	 *
+	 * @param quaternion	The array to write w, x, y, and z to.
+	 */
+	void getQuaternion(float *quaternion) const;
+
+	/**
+	 * Calculates an approximation of 1/sqrt(x).
+	 * Uses the same bit level initial guess and two newton iterations as the Adafruit AHRS library,
+	 * so the results are comparable.
+	 *
+	 * @param x	The value to calculate the inverse square root of.
+	 * @return	The approximate inverse square root.
+	 */
+	static float invSqrt(const float x);
+
+private:
+	const FusionAlgorithm algorithm;
+
+	/**
+	 * Half the sample period, in seconds.
+	 */
+	const float half_period;
+
+	/**
+	 * The gradient descent step size of the Madgwick filter.
+	 */
+	const float beta;
+
+	/**
+	 * Twice the proportional and integral gain of the Mahony filter.
+	 */
+	const float two_kp;
+	const float two_ki;
+
+	/**
+	 * The orientation quaternion.
+	 */
+	float q0 = 1, q1 = 0, q2 = 0, q3 = 0;
+
+	/**
+	 * The integral error feedback of the Mahony filter.
+	 */
+	float integral[3] = { 0, 0, 0 };
+
+	/**
+	 * Updates the orientation using the Madgwick filter.
+	 * The accelerometer and magnetometer values have to be normalized already.
+	 *
+	 * @param a	The normalized accelerometer values, or NULL if they are all zero.
+	 * @param g	The gyroscope values. In rad/s.
+	 * @param m	The normalized magnetometer values, or NULL to use a 6DOF update.
+	 */
+	void updateMadgwick(const float *a, const float *g, const float *m);
+
+	/**
+	 * Updates the orientation using the Mahony filter.
+	 * The accelerometer and magnetometer values have to be normalized already.
+	 *
+	 * @param a	The normalized accelerometer values, or NULL if they are all zero.
+	 * @param g	The gyroscope values. In rad/s.
+	 * @param m	The normalized magnetometer values, or NULL to use a 6DOF update.
+	 */
+	void updateMahony(const float *a, const float *g, const float *m);
+
+	/**
+	 * Normalizes the orientation quaternion.
+	 */
+	void normalize();
+};
+
+#endif /* SRC_ORIENTATIONFILTER_H_ */
@@ -0,0 +1,173 @@
+/*
+ * OverviewPyramid.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OverviewPyramid.h"
+#include <algorithm>
+#include <math.h>
+
+size_t OverviewPyramid::getSize(const uint32_t capacity, const uint8_t stride) {
+	if (capacity == 0) {
+		return 0;
+	}
+
+	size_t buckets = 0;
+	uint32_t level_buckets = capacity;
+	uint8_t level = 0;
+	do {
+		level_buckets = (level_buckets + (level == 0 ? BASE_SAMPLES : 2) - 1)
+				/ (level == 0 ? BASE_SAMPLES : 2);
+		buckets += level_buckets;
+		level++;
+	} while (level_buckets > 1 && level < MAX_LEVELS);
+
+	return buckets * (1 + 3 * (stride - 1));
+}
+
+void OverviewPyramid::reset(float *memory, const SampleStream *samples) {
+	OverviewPyramid::memory = memory;
+	OverviewPyramid::samples = samples;
+	count = 0;
+	levels = 0;
+	if (!isValid() || samples->getCapacity() == 0) {
+		values = 0;
+		return;
+	}
+
+	values = samples->getStride() - 1;
+	uint32_t offset = 0;
+	uint32_t level_buckets = samples->getCapacity();
+	do {
+		level_buckets = (level_buckets
+				+ (levels == 0 ? BASE_SAMPLES : 2) - 1)
+				/ (levels == 0 ? BASE_SAMPLES : 2);
+		level_offsets[levels++] = offset;
+		offset += level_buckets * (1 + 3 * values);
+	} while (level_buckets > 1 && levels < MAX_LEVELS);
+}
+
+void OverviewPyramid::update() {
+	if (levels == 0) {
+		return;
+	}
+
+	const uint32_t stored = samples->getStored();
+	float sample[SampleStream::MAX_STRIDE];
+	while (count < stored) {
+		samples->getValues(count, 0, values + 1, sample);
+		uint32_t index = count >> BASE_BITS;
+		float *bucket = getBucket(0, index);
+		if ((count & (BASE_SAMPLES - 1)) == 0) {
+			bucket[0] = sample[0];
+			for (uint8_t i = 0; i < values; i++) {
+				bucket[1 + i] = sample[1 + i];
+				bucket[1 + values + i] = sample[1 + i];
+				bucket[1 + values * 2 + i] = sample[1 + i];
+			}
+		} else {
+			for (uint8_t i = 0; i < values; i++) {
+				bucket[1 + i] = std::min(bucket[1 + i], sample[1 + i]);
+				bucket[1 + values + i] = std::max(bucket[1 + values + i], sample[1 + i]);
+				bucket[1 + values * 2 + i] += sample[1 + i];
+			}
+		}
+
+		// Combine every second completed bucket with its predecessor into a bucket of the next level.
+		if (((count + 1) & (BASE_SAMPLES - 1)) == 0) {
+			for (uint8_t level = 0; (index & 1) && level + 1 < levels;
+					level++, index >>= 1) {
+				const float *left = getBucket(level, index - 1);
+				const float *right = getBucket(level, index);
+				float *parent = getBucket(level + 1, index >> 1);
+				parent[0] = left[0];
+				for (uint8_t i = 0; i < values; i++) {
+					parent[1 + i] = std::min(left[1 + i], right[1 + i]);
+					parent[1 + values + i] = std::max(left[1 + values + i],
+							right[1 + values + i]);
+					parent[1 + values * 2 + i] = left[1 + values * 2 + i]
+							+ right[1 + values * 2 + i];
+				}
+			}
+		}
+
+		// Only increase the count once the buckets are complete, since they may be read from another task.
+		count++;
+	}
+}
+
+void OverviewPyramid::aggregate(const uint32_t start, const uint32_t end,
+		float *min, float *max, float *mean) const {
+	for (uint8_t i = 0; i < values; i++) {
+		min[i] = INFINITY;
+		max[i] = -INFINITY;
+		mean[i] = 0;
+	}
+
+	const uint32_t available = std::min(end, (uint32_t) count);
+	uint32_t position = start;
+	while (position < available) {
+		// Use the largest complete bucket starting at the current position, if there is one.
+		if ((position & (BASE_SAMPLES - 1)) == 0
+				&& position + BASE_SAMPLES <= available) {
+			uint8_t level = 0;
+			while (level + 1 < levels
+					&& (position & ((BASE_SAMPLES << (level + 1)) - 1)) == 0
+					&& position + (BASE_SAMPLES << (level + 1)) <= available) {
+				level++;
+			}
+
+			const float *bucket = getBucket(level,
+					position >> (BASE_BITS + level));
+			for (uint8_t i = 0; i < values; i++) {
+				min[i] = std::min(min[i], bucket[1 + i]);
+				max[i] = std::max(max[i], bucket[1 + values + i]);
+				mean[i] += bucket[1 + values * 2 + i];
+			}
+			position += BASE_SAMPLES << level;
+		} else {
+			float sample[SampleStream::MAX_STRIDE];
+			samples->getValues(position, 1, values, sample);
+			for (uint8_t i = 0; i < values; i++) {
+				min[i] = std::min(min[i], sample[i]);
+				max[i] = std::max(max[i], sample[i]);
+				mean[i] += sample[i];
+			}
+			position++;
+		}
+	}
+
+	for (uint8_t i = 0; i < values; i++) {
+		mean[i] = available > start ? mean[i] / (available - start) : NAN;
+	}
+}
+
+uint32_t OverviewPyramid::getBucketSamples(const uint32_t samples,
+		const uint32_t buckets) {
+	const uint32_t required = std::max((uint32_t) 1,
+			(samples + buckets - 1) / std::max((uint32_t) 1, buckets));
+	if (required < BASE_SAMPLES) {
+		return required;
+	}
+
+	uint32_t bucket_samples = BASE_SAMPLES;
+	while (bucket_samples < required) {
+		bucket_samples <<= 1;
+	}
+	return bucket_samples;
+}
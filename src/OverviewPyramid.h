@@ -0,0 +1,152 @@
+/*
+ * OverviewPyramid.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_OVERVIEWPYRAMID_H_
+#define SRC_OVERVIEWPYRAMID_H_
+
+#include "SampleStream.h"
+
+/**
+ * A multi resolution min/max/mean summary of a SampleStream, used to quickly plot long recordings.
+ * Level 0 consists of buckets of BASE_SAMPLES samples, and each following level combines two buckets of the previous one.
+ * The pyramid is built incrementally while the samples are recorded.
+ *
+ * Each bucket consists of the timestamp of its first sample,
+ * followed by the min, max, and sum of each value of its samples.
+ */
+class OverviewPyramid {
+public:
+	/**
+	 * The number of samples per level 0 bucket is 2 to the power of this.
+	 */
+	static const uint8_t BASE_BITS = 7;
+
+	/**
+	 * The number of samples per level 0 bucket.
+	 */
+	static const uint32_t BASE_SAMPLES = 1 << BASE_BITS;
+
+	/**
+	 * The max number of levels of a pyramid.
+	 */
+	static const uint8_t MAX_LEVELS = 24;
+
+	/**
+	 * Creates a new OverviewPyramid without any storage.
+	 */
+	OverviewPyramid() {
+	}
+
+	/**
+	 * Calculates the number of floats required for the pyramid of a SampleStream.
+	 *
+	 * @param capacity	The max number of samples in the stream.
+	 * @param stride	The number of floats per sample, including the timestamp.
+	 * @return	The number of floats to reserve for the pyramid.
+	 */
+	static size_t getSize(const uint32_t capacity, const uint8_t stride);
+
+	/**
+	 * Removes all buckets from this pyramid, and sets the stream to summarize.
+	 *
+	 * @param memory	A pointer to getSize(capacity, stride) floats to use as storage.
+	 * 					NULL to disable this pyramid.
+	 * @param samples	The stream to summarize. Should be empty.
+	 */
+	void reset(float *memory, const SampleStream *samples);
+
+	/**
+	 * Adds all samples committed to the stream since the last update to this pyramid.
+	 */
+	void update();
+
+	/**
+	 * Calculates the min, max, and mean of each value of a range of samples.
+	 * Uses the largest complete buckets covering the range, so the time this takes only depends on the alignment of the range.
+	 *
+	 * @param start	The index of the first sample to summarize.
+	 * @param end	The index after the last sample to summarize.
+	 * @param min	The array to write the min of each value to.
+	 * @param max	The array to write the max of each value to.
+	 * @param mean	The array to write the mean of each value to.
+	 */
+	void aggregate(const uint32_t start, const uint32_t end, float *min,
+			float *max, float *mean) const;
+
+	/**
+	 * Calculates the number of samples per bucket to use to split a range into at most the given number of buckets.
+	 * Returns a level bucket size if possible, so that the full buckets can be read directly from the pyramid.
+	 *
+	 * @param samples	The number of samples in the range.
+	 * @param buckets	The max number of buckets to split the range into.
+	 * @return	The number of samples per bucket.
+	 */
+	static uint32_t getBucketSamples(const uint32_t samples,
+			const uint32_t buckets);
+
+	/**
+	 * Checks whether this pyramid has storage and summarizes a stream.
+	 *
+	 * @return	True if this pyramid can be used.
+	 */
+	bool isValid() const {
+		return memory != NULL && samples != NULL;
+	}
+
+	/**
+	 * Gets the number of samples added to this pyramid.
+	 * This can be slightly lower than the number of samples in the stream while recording.
+	 *
+	 * @return	The number of summarized samples.
+	 */
+	uint32_t getCount() const {
+		return count;
+	}
+
+	/**
+	 * Gets the number of values per sample.
+	 *
+	 * @return	The number of values, excluding the timestamp.
+	 */
+	uint8_t getValues() const {
+		return values;
+	}
+
+private:
+	float *memory = NULL;
+	const SampleStream *samples = NULL;
+	uint8_t values = 0;
+	uint8_t levels = 0;
+	uint32_t level_offsets[MAX_LEVELS];
+	volatile uint32_t count = 0;
+
+	/**
+	 * Gets a pointer to a bucket of this pyramid.
+	 *
+	 * @param level	The level of the bucket.
+	 * @param index	The index of the bucket within its level.
+	 * @return	A pointer to the first float of the bucket.
+	 */
+	float* getBucket(const uint8_t level, const uint32_t index) const {
+		return memory + level_offsets[level] + index * (1 + 3 * values);
+	}
+};
+
+#endif /* SRC_OVERVIEWPYRAMID_H_ */
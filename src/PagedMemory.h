@@ -0,0 +1,67 @@
+/*
+ * PagedMemory.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_PAGEDMEMORY_H_
+#define SRC_PAGEDMEMORY_H_
+
+#include <stddef.h>
+
+/**
+ * A memory region that can't be addressed directly, so its values have to be copied through a mapped window.
+ * Used for the PSRAM of 8 MB modules beyond the directly mapped 4 MB.
+ *
+ * All methods have to be thread safe, since samples are written and exported by different tasks.
+ */
+class PagedMemory {
+public:
+	virtual ~PagedMemory() {
+	}
+
+	/**
+	 * Copies values with a constant distance between them from this memory.
+	 *
+	 * @param offset	The offset of the first value in floats.
+	 * @param count		The number of values to copy.
+	 * @param step		The distance between two values in floats.
+	 * @param values	The array to write the values to.
+	 */
+	virtual void read(const size_t offset, const size_t count, const size_t step,
+			float *values) = 0;
+
+	/**
+	 * Copies values to this memory, with a constant distance between them.
+	 *
+	 * @param offset	The offset of the first value in floats.
+	 * @param count		The number of values to copy.
+	 * @param step		The distance between two values in floats.
+	 * @param values	The values to write.
+	 */
+	virtual void write(const size_t offset, const size_t count, const size_t step,
+			const float *values) = 0;
+
+	/**
+	 * Gets the size of this memory region.
+	 *
+	 * @return	The number of floats in this memory region.
+	 */
+	virtual size_t getSize() const = 0;
+};
+
+#endif /* SRC_PAGEDMEMORY_H_ */
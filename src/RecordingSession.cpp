@@ -0,0 +1,70 @@
+/*
+ * RecordingSession.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RecordingSession.h"
+
+uint8_t RecordingSession::getChannelIndex(const SensorChannel channel) const {
+	if (!(channels & channel)) {
+		return 0;
+	}
+
+	uint8_t index = 1;
+	for (uint8_t previous = CHANNEL_ACCELEROMETER; previous < channel;
+			previous <<= 1) {
+		if (channels & previous) {
+			index += 3;
+		}
+	}
+
+	return index;
+}
+
+bool RecordingSession::getMagnetometerValues(const uint32_t position,
+		uint32_t &cursor, float *values) const {
+	if (!separate_mag) {
+		const uint8_t index = getChannelIndex(CHANNEL_MAGNETOMETER);
+		if (index == 0) {
+			return false;
+		}
+
+		samples.getValues(position, index, 3, values);
+		return true;
+	} else if (mag_samples.getStored() == 0) {
+		return false;
+	}
+
+	cursor = mag_samples.find(samples.getTimestamp(position), cursor);
+	mag_samples.getValues(cursor, 1, 3, values);
+	return true;
+}
+
+RecordingInfo RecordingSession::getRecordingInfo() const {
+	RecordingInfo info;
+	info.channels = channels;
+	info.separate_mag = separate_mag;
+	info.frequency = frequency;
+	info.duration = duration;
+	info.measuring_time = measuring_time;
+	info.strides[0] = samples.getStride();
+	info.strides[1] = mag_samples.getStride();
+	info.counts[0] = samples.getStored();
+	info.counts[1] = mag_samples.getStored();
+	return info;
+}
@@ -0,0 +1,343 @@
+/*
+ * RecordingSession.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_RECORDINGSESSION_H_
+#define SRC_RECORDINGSESSION_H_
+
+#include "ChannelStatistics.h"
+#include "EventIndex.h"
+#include "OverviewPyramid.h"
+#include "RecordingStore.h"
+#include "SampleStream.h"
+#include "SlotAllocator.h"
+#include <memory>
+
+/**
+ * The sensors of the LSM9DS1 that can be recorded.
+ * These are used as bits of the channel mask of a recording.
+ */
+enum SensorChannel : uint8_t {
+	CHANNEL_ACCELEROMETER = 1,
+	CHANNEL_GYROSCOPE = 1 << 1,
+	CHANNEL_MAGNETOMETER = 1 << 2,
+	CHANNEL_ALL = CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE | CHANNEL_MAGNETOMETER
+};
+
+/**
+ * The measurement csvs that can be downloaded for a recording, in the order their sizes are calculated in.
+ */
+enum MeasurementCsv : uint8_t {
+	CSV_ALL,
+	CSV_ACCELEROMETER,
+	CSV_LINEAR_ACCELERATION,
+	CSV_GYROSCOPE,
+	CSV_MAGNETOMETER,
+	MEASUREMENT_CSVS
+};
+
+/**
+ * The states of a recording session.
+ */
+enum SessionState : uint8_t {
+	/**
+	 * Samples are being added to the session.
+	 */
+	SESSION_RECORDING,
+
+	/**
+	 * The recording is finished, and the sizes of its csvs are being calculated.
+	 */
+	SESSION_CALCULATING,
+
+	/**
+	 * All the data of the session can be exported.
+	 */
+	SESSION_READY
+};
+
+/**
+ * A measurement csv rendered into a slot of otherwise unused memory, so downloads of it only have to copy it.
+ * The slot is returned to its SlotAllocator when the last reference is dropped.
+ */
+struct RenderedCsv {
+	/**
+	 * Creates a new empty RenderedCsv.
+	 *
+	 * @param allocator	The SlotAllocator the slot was allocated from.
+	 * @param slot		The memory to render the csv into.
+	 * @param size		The size of the full csv in bytes.
+	 */
+	RenderedCsv(SlotAllocator *allocator, float *slot, const size_t size) :
+			allocator(allocator), data((char*) slot), size(size) {
+	}
+
+	RenderedCsv(const RenderedCsv &other) = delete;
+	RenderedCsv& operator=(const RenderedCsv &other) = delete;
+
+	~RenderedCsv() {
+		allocator->release((float*) data);
+	}
+
+	/**
+	 * Checks whether the whole csv was rendered.
+	 *
+	 * @return	True if the csv can be downloaded from data.
+	 */
+	bool isComplete() const {
+		return rendered == size;
+	}
+
+	SlotAllocator *const allocator;
+	char *const data;
+	const size_t size;
+
+	/**
+	 * The number of bytes rendered so far.
+	 */
+	size_t rendered = 0;
+};
+
+/**
+ * A single recording, with its samples and everything derived from them.
+ *
+ * Sessions are shared using std::shared_ptr, and everything exporting a session holds a reference to it.
+ * So a session deleted while it is still being downloaded keeps its data until the download is finished.
+ * Its slot is returned to the SlotAllocator it came from when the last reference is dropped.
+ *
+ * Sessions too large for the directly mapped PSRAM keep their sample streams in a PagedMemory region instead.
+ * Their slot then only contains the overview pyramids.
+ */
+struct RecordingSession {
+	/**
+	 * The number of sensor values measured by the LSM9DS1, three for each SensorChannel.
+	 */
+	static const uint8_t SENSOR_VALUES = 9;
+
+	/**
+	 * Creates a new empty recording session.
+	 *
+	 * @param id		The unique id of the new session.
+	 * @param allocator	The SlotAllocator the slot of this session was allocated from.
+	 * @param slot		The memory for the sample streams and overview pyramids of this session.
+	 * 					May be NULL for sessions without any memory of their own.
+	 * @param size		The number of floats in the slot.
+	 * @param paged_allocator	The SlotAllocator of the PagedMemory region the sample streams are stored in.
+	 * 							NULL if they are stored in the slot.
+	 * @param paged_offset		The offset of the sample streams in the PagedMemory region.
+	 * @param paged_size		The number of floats of the PagedMemory region used by this session.
+	 */
+	RecordingSession(const uint32_t id, SlotAllocator *allocator, float *slot,
+			const size_t size, SlotAllocator *paged_allocator = NULL,
+			const size_t paged_offset = SlotAllocator::NO_SLOT,
+			const size_t paged_size = 0) :
+			id(id), allocator(allocator), slot(slot), size(slot == NULL ? 0 : size), paged_allocator(
+					paged_allocator), paged_offset(paged_offset), paged_size(
+					paged_allocator == NULL ? 0 : paged_size) {
+	}
+
+	RecordingSession(const RecordingSession &other) = delete;
+	RecordingSession& operator=(const RecordingSession &other) = delete;
+
+	~RecordingSession() {
+		allocator->release(slot);
+		if (paged_allocator != NULL) {
+			paged_allocator->releaseOffset(paged_offset);
+		}
+	}
+
+	/**
+	 * Gets the index of the first value of the given SensorChannel in a measurement of the main sample stream.
+	 *
+	 * @param channel	The channel to get the index for.
+	 * @return	The index of the channel, or 0 if the channel isn't part of the main sample stream.
+	 */
+	uint8_t getChannelIndex(const SensorChannel channel) const;
+
+	/**
+	 * Checks whether all the given SensorChannels are recorded by this session.
+	 *
+	 * @param channels	A bit mask of the SensorChannels to check.
+	 * @return	True if all of the given channels are recorded.
+	 */
+	bool isRecorded(const uint8_t channels) const {
+		return (RecordingSession::channels & channels) == channels;
+	}
+
+	/**
+	 * Gets the magnetometer values to use for the measurement with the given index.
+	 * If the magnetometer has its own stream this is the latest magnetometer sample at the time of the measurement.
+	 *
+	 * @param position	The index of the measurement in the main sample stream.
+	 * @param cursor	The index of the last used magnetometer sample, used to speed up sequential lookups.
+	 * 					Gets updated by this method.
+	 * @param values	The array to write the three magnetometer values to.
+	 * @return	False if there are no magnetometer values.
+	 */
+	bool getMagnetometerValues(const uint32_t position, uint32_t &cursor,
+			float *values) const;
+
+	/**
+	 * Gets the metadata of this session, for persisting it.
+	 *
+	 * @return	The metadata of this session.
+	 */
+	RecordingInfo getRecordingInfo() const;
+
+	/**
+	 * The unique id of this session.
+	 */
+	const uint32_t id;
+
+	/**
+	 * The allocator to return the slot of this session to.
+	 */
+	SlotAllocator *const allocator;
+
+	/**
+	 * The memory of this session, containing its sample streams followed by their overview pyramids.
+	 * The sample streams of a restored session are in flash instead, so its slot only contains the pyramids.
+	 */
+	float *const slot;
+
+	/**
+	 * The number of floats in the slot.
+	 */
+	const size_t size;
+
+	/**
+	 * The allocator to return the PagedMemory slot of this session to, if it has one.
+	 */
+	SlotAllocator *const paged_allocator;
+
+	/**
+	 * The offset of the sample streams in the PagedMemory region, if they aren't in the slot.
+	 */
+	const size_t paged_offset;
+
+	/**
+	 * The number of floats of the PagedMemory region used by this session.
+	 */
+	const size_t paged_size;
+
+	/**
+	 * The bit mask of the recorded SensorChannels.
+	 */
+	uint8_t channels = CHANNEL_ALL;
+
+	/**
+	 * Whether the magnetometer values are stored in mag_samples rather than samples.
+	 */
+	bool separate_mag = false;
+
+	/**
+	 * The index of the sensor recorded in this session.
+	 * Recordings of multiple sensors store each sensor in a session of its own.
+	 */
+	uint8_t sensor = 0;
+
+	/**
+	 * The number of sensors recorded at the same time as this one.
+	 */
+	uint8_t sensors = 1;
+
+	/**
+	 * The id of the session of the first sensor of the recording, which is the id of this session for single sensor recordings.
+	 */
+	uint32_t group = 0;
+
+	/**
+	 * The target measurement frequency, in measurements per second.
+	 */
+	uint16_t frequency = 50;
+
+	/**
+	 * The number of measurements to record.
+	 */
+	uint32_t measurements = 0;
+
+	/**
+	 * The average time between two measurements in microseconds.
+	 */
+	uint32_t measuring_time = 0;
+
+	/**
+	 * The time the recording was started at, in milliseconds since boot.
+	 */
+	uint64_t start = 0;
+
+	/**
+	 * The time spent recording in milliseconds. Only valid once the recording is finished.
+	 */
+	uint32_t duration = 0;
+
+	/**
+	 * Whether this session was loaded from flash.
+	 * In that case the sample streams point into the memory mapped recording partition.
+	 */
+	bool restored = false;
+
+	volatile SessionState state = SESSION_RECORDING;
+
+	/**
+	 * The measurements of the accelerometer and gyroscope.
+	 * Also contains the magnetometer values, unless separate_mag is set.
+	 */
+	SampleStream samples;
+
+	/**
+	 * The magnetometer measurements, if they are recorded at their own rate.
+	 */
+	SampleStream mag_samples;
+
+	/**
+	 * The min/max/mean overview of samples.
+	 */
+	OverviewPyramid overview;
+
+	/**
+	 * The min/max/mean overview of mag_samples.
+	 */
+	OverviewPyramid mag_overview;
+
+	/**
+	 * The impacts, shocks, and other threshold crossings detected while recording.
+	 * The indices of magnetometer events refer to mag_samples if separate_mag is set.
+	 */
+	EventIndex events;
+
+	/**
+	 * The running statistics for each sensor value, updated whenever a measurement is stored.
+	 */
+	ChannelStatistics statistics[SENSOR_VALUES];
+
+	/**
+	 * The sizes of the full measurement csvs in bytes, indexed by MeasurementCsv.
+	 * 0 for csvs whose size wasn't calculated.
+	 */
+	size_t csv_sizes[MEASUREMENT_CSVS] = { 0 };
+
+	/**
+	 * The measurement csvs rendered in the background, with the default separator, indexed by MeasurementCsv.
+	 * Guarded by the sessions mutex of the LSM9DS1Handler, since they are dropped whenever a new recording needs their memory.
+	 */
+	std::shared_ptr<RenderedCsv> rendered[MEASUREMENT_CSVS];
+};
+
+#endif /* SRC_RECORDINGSESSION_H_ */
@@ -0,0 +1,140 @@
+/*
+ * RecordingStore.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RecordingStore.h"
+#include <algorithm>
+#include <stddef.h>
+#include <string.h>
+
+RecordingStore::RecordingStore(FlashPartition *partition) :
+		partition(partition) {
+}
+
+size_t RecordingStore::getRequiredSize(const RecordingInfo &info) const {
+	size_t size = partition->getSectorSize();
+	for (uint8_t i = 0; i < RECORDING_STREAMS; i++) {
+		size += getStreamSize(info, i);
+	}
+	return size;
+}
+
+bool RecordingStore::write(const RecordingInfo &info,
+		const float *const streams[RECORDING_STREAMS]) {
+	written = 0;
+	const size_t sector = partition->getSectorSize();
+	const size_t end = getRequiredSize(info);
+	if (end > partition->getSize()) {
+		return false;
+	}
+
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.header_size = sizeof(Header);
+	header.info = info;
+
+	size_t offset = sector;
+	for (uint8_t i = 0; i < RECORDING_STREAMS; i++) {
+		header.offsets[i] = offset;
+		offset += getStreamSize(info, i);
+	}
+	header.checksum = getChecksum(header);
+
+	// Invalidate the previous recording first, in case writing this one gets interrupted.
+	partition->unmap();
+	if (!partition->erase(0, sector)) {
+		return false;
+	}
+
+	// The streams might be in external RAM, so each sector is copied to an internal buffer before writing it.
+	uint8_t *buffer = new uint8_t[sector];
+	uint8_t stream = 0;
+	size_t stream_offset = 0;
+	bool success = true;
+	for (size_t batch = sector; batch < end && success;
+			batch += sector * BATCH_SECTORS) {
+		const size_t batch_end = std::min(batch + sector * BATCH_SECTORS, end);
+		const size_t erase_length = (batch_end - batch + sector - 1) / sector
+				* sector;
+		success = partition->erase(batch, erase_length);
+
+		for (size_t position = batch; position < batch_end && success;
+				position += sector) {
+			const size_t length = std::min(sector, batch_end - position);
+			size_t filled = 0;
+			while (filled < length) {
+				const size_t stream_size = getStreamSize(info, stream);
+				const size_t copy = std::min(length - filled,
+						stream_size - stream_offset);
+				memcpy(buffer + filled,
+						(const uint8_t*) streams[stream] + stream_offset, copy);
+				filled += copy;
+				stream_offset += copy;
+				if (stream_offset >= stream_size) {
+					stream++;
+					stream_offset = 0;
+				}
+			}
+
+			success = partition->write(position, buffer, length);
+			written = position + length;
+		}
+	}
+	delete[] buffer;
+
+	if (success) {
+		success = partition->write(0, &header, sizeof(Header));
+	}
+
+	return success;
+}
+
+bool RecordingStore::load(RecordingInfo &info,
+		const float *streams[RECORDING_STREAMS]) {
+	Header header;
+	if (!partition->read(0, &header, sizeof(Header))
+			|| header.magic != MAGIC || header.version != VERSION
+			|| header.header_size != sizeof(Header)
+			|| header.checksum != getChecksum(header)
+			|| getRequiredSize(header.info) > partition->getSize()) {
+		return false;
+	}
+
+	const uint8_t *mapped = (const uint8_t*) partition->map();
+	if (mapped == NULL) {
+		return false;
+	}
+
+	info = header.info;
+	for (uint8_t i = 0; i < RECORDING_STREAMS; i++) {
+		streams[i] = (const float*) (mapped + header.offsets[i]);
+	}
+	return true;
+}
+
+uint32_t RecordingStore::getChecksum(const Header &header) {
+	const uint8_t *bytes = (const uint8_t*) &header;
+	uint32_t hash = 2166136261;
+	for (size_t i = 0; i < offsetof(Header, checksum); i++) {
+		hash = (hash ^ bytes[i]) * 16777619;
+	}
+	return hash;
+}
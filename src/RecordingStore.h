@@ -0,0 +1,178 @@
+/*
+ * RecordingStore.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_RECORDINGSTORE_H_
+#define SRC_RECORDINGSTORE_H_
+
+#include "FlashPartition.h"
+#include "SampleStream.h"
+#include <stdint.h>
+
+/**
+ * The number of sample streams of a recording.
+ */
+const uint8_t RECORDING_STREAMS = 2;
+
+/**
+ * The metadata of a persisted recording.
+ */
+struct RecordingInfo {
+	/**
+	 * The bit mask of the recorded sensor channels.
+	 */
+	uint8_t channels;
+
+	/**
+	 * Whether the magnetometer values are stored in the second stream.
+	 */
+	bool separate_mag;
+
+	/**
+	 * The target measurement frequency, in measurements per second.
+	 */
+	uint16_t frequency;
+
+	/**
+	 * The duration of the recording in milliseconds.
+	 */
+	uint32_t duration;
+
+	/**
+	 * The average time between two measurements in microseconds.
+	 */
+	uint32_t measuring_time;
+
+	/**
+	 * The number of floats per sample of each stream, including the timestamp.
+	 */
+	uint8_t strides[RECORDING_STREAMS];
+
+	/**
+	 * The number of samples in each stream.
+	 */
+	uint32_t counts[RECORDING_STREAMS];
+};
+
+/**
+ * Persists a recording to a flash partition, and loads it from there after a reboot.
+ *
+ * The first sector contains a header describing the recording, followed by the storage of the sample streams as it is in RAM.
+ * So a loaded recording can be read directly from the memory mapped partition.
+ * The header is written last, so a recording that wasn't completely written is never loaded.
+ */
+class RecordingStore {
+public:
+	/**
+	 * Creates a new RecordingStore storing its recording in the given partition.
+	 *
+	 * @param partition	The partition to store the recording in.
+	 */
+	RecordingStore(FlashPartition *partition);
+
+	/**
+	 * Calculates the number of bytes of the partition a recording uses.
+	 *
+	 * @param info	The metadata of the recording.
+	 * @return	The required partition size.
+	 */
+	size_t getRequiredSize(const RecordingInfo &info) const;
+
+	/**
+	 * Writes a recording to the partition, replacing the previous one.
+	 * Unmaps the partition, so previously loaded streams may not be used anymore.
+	 * The data is written in batches of whole erase blocks, each erased right before it is written.
+	 *
+	 * @param info		The metadata of the recording.
+	 * @param streams	The samples of each stream.
+	 * @return	True if the recording was written completely.
+	 */
+	bool write(const RecordingInfo &info,
+			const float *const streams[RECORDING_STREAMS]);
+
+	/**
+	 * Gets the number of bytes written by the current or last write.
+	 *
+	 * @return	The number of bytes written so far.
+	 */
+	size_t getWritten() const {
+		return written;
+	}
+
+	/**
+	 * Loads the recording from the partition, if there is a valid one.
+	 * The streams point into the memory mapped partition, so they aren't copied.
+	 *
+	 * @param info		The variable to write the metadata of the recording to.
+	 * @param streams	The array to write pointers to the samples of each stream to.
+	 * @return	True if a recording was loaded.
+	 */
+	bool load(RecordingInfo &info, const float *streams[RECORDING_STREAMS]);
+
+	/**
+	 * The number of erase sectors erased and written in a single batch.
+	 * Large batches let the flash erase whole 64KiB blocks at once.
+	 */
+	static const uint8_t BATCH_SECTORS = 16;
+
+private:
+	/**
+	 * The header in the first sector of the partition.
+	 */
+	struct Header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t header_size;
+		RecordingInfo info;
+		uint32_t offsets[RECORDING_STREAMS];
+		uint32_t checksum;
+	};
+
+	static const uint32_t MAGIC = 0x524D534C; // "LSMR"
+	/**
+	 * The version of the recording format.
+	 * Version 2 stores the samples in blocks, as used by SampleStream.
+	 */
+	static const uint16_t VERSION = 2;
+
+	/**
+	 * Calculates the number of bytes a stream of a recording uses, including the unused part of its last block.
+	 *
+	 * @param info		The metadata of the recording.
+	 * @param stream	The index of the stream.
+	 * @return	The size of the stream in bytes.
+	 */
+	static size_t getStreamSize(const RecordingInfo &info, const uint8_t stream) {
+		return SampleStream::getSize(info.counts[stream], info.strides[stream])
+				* sizeof(float);
+	}
+
+	/**
+	 * Calculates the checksum of all header fields before the checksum.
+	 *
+	 * @param header	The header to calculate the checksum of.
+	 * @return	The FNV-1a hash of the header.
+	 */
+	static uint32_t getChecksum(const Header &header);
+
+	FlashPartition *partition;
+	volatile size_t written = 0;
+};
+
+#endif /* SRC_RECORDINGSTORE_H_ */
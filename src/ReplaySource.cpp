@@ -0,0 +1,77 @@
+/*
+ * ReplaySource.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ReplaySource.h"
+#include <math.h>
+
+ReplaySource::ReplaySource(const SensorScales &scales) :
+		scales(scales) {
+}
+
+uint32_t ReplaySource::setDataRate(const uint8_t /*channels*/,
+		const uint16_t frequency) {
+	position = 0;
+	mag_cursor = 0;
+	return 1000000 / frequency;
+}
+
+void ReplaySource::read(const uint8_t sensors, int16_t *accel,
+		int16_t *gyro, int16_t *mag) {
+	if (sensors & CHANNEL_ACCELEROMETER) {
+		readRaw(CHANNEL_ACCELEROMETER, scales.accel, accel);
+	}
+
+	if (sensors & CHANNEL_GYROSCOPE) {
+		readRaw(CHANNEL_GYROSCOPE, scales.gyro, gyro);
+	}
+
+	if (sensors & CHANNEL_MAGNETOMETER) {
+		readRaw(CHANNEL_MAGNETOMETER, scales.mag, mag);
+	}
+
+	if (++position >= session->samples.getStored()) {
+		position = 0;
+		mag_cursor = 0;
+	}
+}
+
+void ReplaySource::setSession(
+		const std::shared_ptr<const RecordingSession> session) {
+	ReplaySource::session = session;
+	position = 0;
+	mag_cursor = 0;
+}
+
+void ReplaySource::readRaw(const SensorChannel channel, const float scale,
+		int16_t *raw) {
+	float values[3] = { 0, 0, 0 };
+	if (channel == CHANNEL_MAGNETOMETER) {
+		session->getMagnetometerValues(position, mag_cursor, values);
+	} else if (session->isRecorded(channel)) {
+		session->samples.getValues(position, session->getChannelIndex(channel),
+				3, values);
+	}
+
+	for (uint8_t i = 0; i < 3; i++) {
+		const float value = roundf(values[i] / scale);
+		raw[i] = value > INT16_MAX ? INT16_MAX :
+					value < INT16_MIN ? INT16_MIN : value;
+	}
+}
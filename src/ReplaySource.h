@@ -0,0 +1,115 @@
+/*
+ * ReplaySource.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_REPLAYSOURCE_H_
+#define SRC_REPLAYSOURCE_H_
+
+#include "RecordingSession.h"
+#include "SensorSource.h"
+#include <memory>
+
+/**
+ * A SensorSource replaying the samples of an earlier recording session.
+ * This can be a session recorded since booting, the one restored from flash, or one loaded from an exported csv on the host.
+ * Every read returns the next recorded measurement, so the target frequency of the new recording sets the replay speed.
+ * The replay starts over after the last measurement.
+ */
+class ReplaySource: public SensorSource {
+public:
+	/**
+	 * Creates a new ReplaySource without a session to replay.
+	 *
+	 * @param scales	The factors converting the raw values to SI units, used to convert the recorded values back.
+	 */
+	ReplaySource(const SensorScales &scales);
+
+	const char* getName() const override {
+		return "replay";
+	}
+
+	bool isAvailable() const override {
+		return session && session->samples.getStored() > 0;
+	}
+
+	/**
+	 * Restarts the replay at the first measurement of the session.
+	 *
+	 * @param channels	The bit mask of the SensorChannels being recorded.
+	 * @param frequency	The target measurement frequency, in measurements per second.
+	 * @return	The time between two measurements at the target frequency, in microseconds.
+	 */
+	uint32_t setDataRate(const uint8_t channels, const uint16_t frequency)
+			override;
+
+	/**
+	 * Reads the next measurement of the replayed session.
+	 * Sensors that weren't recorded in the session read as 0.
+	 *
+	 * @param sensors	The bit mask of the SensorChannels to read.
+	 * @param accel		The array to write the three accelerometer values to.
+	 * @param gyro		The array to write the three gyroscope values to.
+	 * @param mag		The array to write the three magnetometer values to.
+	 */
+	void read(const uint8_t sensors, int16_t *accel, int16_t *gyro,
+			int16_t *mag) override;
+
+	/**
+	 * Gets the session being replayed.
+	 *
+	 * @return	The replayed session, or NULL if none was set.
+	 */
+	std::shared_ptr<const RecordingSession> getSession() const {
+		return session;
+	}
+
+	/**
+	 * Sets the session to replay, and keeps it alive while it is set.
+	 * Must not be called while a recording is reading this source.
+	 *
+	 * @param session	The session to replay, or NULL to release the current one.
+	 */
+	void setSession(const std::shared_ptr<const RecordingSession> session);
+
+private:
+	const SensorScales scales;
+
+	std::shared_ptr<const RecordingSession> session;
+
+	/**
+	 * The index of the next measurement to replay in the main sample stream of the session.
+	 */
+	uint32_t position = 0;
+
+	/**
+	 * The position of the last joined measurement of a separate magnetometer stream.
+	 */
+	uint32_t mag_cursor = 0;
+
+	/**
+	 * Reads three values of a recorded measurement, and converts them back to raw sensor units.
+	 *
+	 * @param channel	The sensor to read the values of.
+	 * @param scale		The SI value of one raw unit of the sensor.
+	 * @param raw		The array to write the raw values to.
+	 */
+	void readRaw(const SensorChannel channel, const float scale, int16_t *raw);
+};
+
+#endif /* SRC_REPLAYSOURCE_H_ */
@@ -0,0 +1,53 @@
+/*
+ * SampleStream.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SampleStream.h"
+#include <algorithm>
+
+uint32_t SampleStream::find(const float timestamp, const uint32_t hint) const {
+	if (stored == 0) {
+		return 0;
+	}
+
+	uint32_t low = 0;
+	uint32_t position = std::min(hint, stored - 1);
+	if (getTimestamp(position) <= timestamp) {
+		// Check a few following samples first, since most lookups are sequential.
+		for (uint8_t i = 0; i < 4; i++) {
+			if (position + 1 >= stored || getTimestamp(position + 1) > timestamp) {
+				return position;
+			}
+			position++;
+		}
+		low = position;
+	}
+
+	uint32_t high = stored;
+	while (high - low > 1) {
+		const uint32_t middle = low + (high - low) / 2;
+		if (getTimestamp(middle) <= timestamp) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
@@ -0,0 +1,279 @@
+/*
+ * SampleStream.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SAMPLESTREAM_H_
+#define SRC_SAMPLESTREAM_H_
+
+#include "PagedMemory.h"
+#include "Trace.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A sequence of samples stored in a part of the data array, or of a PagedMemory region.
+ * Each sample consists of a timestamp in milliseconds followed by its values.
+ * Samples have to be appended with monotonically increasing timestamps.
+ *
+ * The samples are stored in blocks of BLOCK_SAMPLES samples, with the values of a block stored column by column.
+ * So each PSRAM cache line contains a single value of consecutive samples,
+ * and exporting some of the values of a sample only reads the cache lines containing them.
+ *
+ * Streams in a PagedMemory region copy each value through its window, which is slower but uses the same layout.
+ */
+class SampleStream {
+public:
+	/**
+	 * The number of samples per block. One column of a block is a 32 byte PSRAM cache line.
+	 */
+	static const uint8_t BLOCK_SAMPLES = 8;
+
+	/**
+	 * The max number of floats per sample, including the timestamp.
+	 */
+	static const uint8_t MAX_STRIDE = 16;
+
+	/**
+	 * Creates a new empty SampleStream without any storage.
+	 */
+	SampleStream() {
+	}
+
+	/**
+	 * Gets the number of floats of storage required for a stream with the given capacity.
+	 * This is rounded up to full blocks.
+	 *
+	 * @param capacity	The max number of samples to store.
+	 * @param stride	The number of floats per sample, including the timestamp.
+	 * @return	The required storage in floats.
+	 */
+	static size_t getSize(const uint32_t capacity, const uint8_t stride) {
+		return (size_t) (capacity + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES
+				* BLOCK_SAMPLES * stride;
+	}
+
+	/**
+	 * Sets the storage for this stream and removes all samples from it.
+	 *
+	 * @param data		A pointer to the first float of the storage to use.
+	 * 					Has to be at least getSize(capacity, stride) floats large.
+	 * @param stride	The number of floats per sample, including the timestamp.
+	 * @param capacity	The max number of samples to store.
+	 * @param stored	The number of samples already in the storage.
+	 */
+	void reset(float *data, const uint8_t stride, const uint32_t capacity,
+			const uint32_t stored = 0) {
+		SampleStream::data = data;
+		paged = NULL;
+		paged_offset = 0;
+		SampleStream::stride = stride;
+		SampleStream::capacity = capacity;
+		SampleStream::stored = stored;
+	}
+
+	/**
+	 * Sets a part of a PagedMemory region as the storage for this stream, and removes all samples from it.
+	 *
+	 * @param memory	The memory region to store the samples in.
+	 * @param offset	The offset of the storage to use in floats.
+	 * 					The region has to contain at least getSize(capacity, stride) floats after it.
+	 * @param stride	The number of floats per sample, including the timestamp.
+	 * @param capacity	The max number of samples to store.
+	 */
+	void reset(PagedMemory *memory, const size_t offset, const uint8_t stride,
+			const uint32_t capacity) {
+		reset((float*) NULL, stride, capacity);
+		paged = memory;
+		paged_offset = offset;
+	}
+
+	/**
+	 * Gets a single value of the sample with the given index.
+	 *
+	 * @param position	The index of the sample.
+	 * @param index		The index of the value in the sample. 0 is the timestamp.
+	 * @return	The value.
+	 */
+	float getValue(const uint32_t position, const uint8_t index) const {
+		const size_t offset = getOffset(position) + index * BLOCK_SAMPLES;
+		if (paged != NULL) {
+			float value;
+			paged->read(paged_offset + offset, 1, 1, &value);
+			return value;
+		}
+
+		return data[offset];
+	}
+
+	/**
+	 * Copies consecutive values of the sample with the given index to the given array.
+	 *
+	 * @param position	The index of the sample.
+	 * @param index		The index of the first value to copy. 0 is the timestamp.
+	 * @param count		The number of values to copy.
+	 * @param values	The array to write the values to.
+	 */
+	void getValues(const uint32_t position, const uint8_t index,
+			const uint8_t count, float *values) const {
+		const size_t offset = getOffset(position) + index * BLOCK_SAMPLES;
+		if (paged != NULL) {
+			paged->read(paged_offset + offset, count, BLOCK_SAMPLES, values);
+			return;
+		}
+
+		const float *value = data + offset;
+		for (uint8_t i = 0; i < count; i++) {
+			values[i] = value[i * BLOCK_SAMPLES];
+		}
+	}
+
+	/**
+	 * Gets the timestamp of the sample with the given index.
+	 *
+	 * @param position	The index of the sample.
+	 * @return	The timestamp of the sample in milliseconds since the recording start.
+	 */
+	float getTimestamp(const uint32_t position) const {
+		return getValue(position, 0);
+	}
+
+	/**
+	 * Adds a sample to the end of this stream.
+	 * The sample only becomes visible to other tasks once all of its values are written.
+	 *
+	 * @param sample	The timestamp of the sample, followed by its values.
+	 * @return	False if the stream is full.
+	 */
+	bool append(const float *sample) {
+		if (stored >= capacity) {
+			return false;
+		}
+
+		TRACE_SPAN(TRACE_PSRAM_STORE);
+
+		if (paged != NULL) {
+			paged->write(paged_offset + getOffset(stored), stride, BLOCK_SAMPLES,
+					sample);
+			stored++;
+			return true;
+		}
+
+		float *value = data + getOffset(stored);
+		for (uint8_t i = 0; i < stride; i++) {
+			value[i * BLOCK_SAMPLES] = sample[i];
+		}
+		stored++;
+		return true;
+	}
+
+	/**
+	 * Gets the storage of this stream, for copying all of it at once.
+	 * The first getSize(getStored(), getStride()) floats contain all the stored samples.
+	 *
+	 * @return	A pointer to the first float of the storage, or NULL if it is in a PagedMemory region.
+	 */
+	const float* getData() const {
+		return data;
+	}
+
+	/**
+	 * Checks whether the samples of this stream are stored in a PagedMemory region.
+	 *
+	 * @return	True if the samples can't be addressed directly.
+	 */
+	bool isPaged() const {
+		return paged != NULL;
+	}
+
+	/**
+	 * Finds the last sample with a timestamp less than or equal to the given one.
+	 * If the timestamp is before the first sample, the first sample is returned.
+	 *
+	 * Sequential lookups with increasing timestamps are amortized O(1)
+	 * when the result of the last lookup is given as the hint.
+	 * Other lookups use a binary search.
+	 *
+	 * @param timestamp	The timestamp to look for in milliseconds.
+	 * @param hint		The index to start looking from.
+	 * @return	The index of the found sample.
+	 */
+	uint32_t find(const float timestamp, const uint32_t hint = 0) const;
+
+	/**
+	 * Gets the number of samples in this stream.
+	 *
+	 * @return	The number of stored samples.
+	 */
+	uint32_t getStored() const {
+		return stored;
+	}
+
+	/**
+	 * Gets the average rate at which the samples of this stream were taken.
+	 *
+	 * @return	The sample rate in samples per second, or 0 if there are less than two samples.
+	 */
+	float getRate() const {
+		if (stored < 2) {
+			return 0;
+		}
+
+		return (stored - 1) * 1000.0 / (getTimestamp(stored - 1) - getTimestamp(0));
+	}
+
+	/**
+	 * Gets the number of floats per sample, including the timestamp.
+	 *
+	 * @return	The number of floats per sample.
+	 */
+	uint8_t getStride() const {
+		return stride;
+	}
+
+	/**
+	 * Gets the max number of samples this stream can store.
+	 *
+	 * @return	The capacity of this stream.
+	 */
+	uint32_t getCapacity() const {
+		return capacity;
+	}
+
+private:
+	/**
+	 * Gets the offset of the timestamp of a sample in the storage.
+	 * The following values of the sample are BLOCK_SAMPLES floats apart.
+	 *
+	 * @param position	The index of the sample.
+	 * @return	The offset of the sample in floats.
+	 */
+	size_t getOffset(const uint32_t position) const {
+		return (size_t) (position & ~(uint32_t) (BLOCK_SAMPLES - 1)) * stride
+				+ (position & (BLOCK_SAMPLES - 1));
+	}
+
+	float *data = NULL;
+	PagedMemory *paged = NULL;
+	size_t paged_offset = 0;
+	uint8_t stride = 1;
+	uint32_t capacity = 0;
+	uint32_t stored = 0;
+};
+
+#endif /* SRC_SAMPLESTREAM_H_ */
@@ -0,0 +1,138 @@
+/*
+ * SensorSource.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SENSORSOURCE_H_
+#define SRC_SENSORSOURCE_H_
+
+#include <stdint.h>
+
+/**
+ * The max number of sensors sampled in one recording.
+ */
+const uint8_t MAX_SENSORS = 3;
+
+/**
+ * The factors converting the raw values of a SensorSource to SI units.
+ */
+struct SensorScales {
+	/**
+	 * The acceleration of one raw accelerometer unit, in m/s^2.
+	 */
+	float accel;
+
+	/**
+	 * The rotation rate of one raw gyroscope unit, in rad/s.
+	 */
+	float gyro;
+
+	/**
+	 * The magnetic field of one raw magnetometer unit, in uT.
+	 */
+	float mag;
+};
+
+/**
+ * A source of raw accelerometer, gyroscope, and magnetometer samples, read by the reader task of the LSM9DS1Handler.
+ * Besides the LSM9DS1 itself this can be a synthetic signal, or the replay of an earlier recording,
+ * so the acquisition and export paths can be exercised without the sensor.
+ */
+class SensorSource {
+public:
+	virtual ~SensorSource() {
+	}
+
+	/**
+	 * Gets the name of this source, as used to select it.
+	 *
+	 * @return	The name of this source.
+	 */
+	virtual const char* getName() const = 0;
+
+	/**
+	 * Checks whether this source can currently be read.
+	 *
+	 * @return	False if the sensor isn't connected, or there is nothing to replay.
+	 */
+	virtual bool isAvailable() const = 0;
+
+	/**
+	 * Prepares this source for a new recording.
+	 * Called by the reader task before reading the first sample of a recording.
+	 *
+	 * @param channels	The bit mask of the SensorChannels being recorded.
+	 * @param frequency	The target measurement frequency, in measurements per second.
+	 * @return	The time between two conversions of the source, in microseconds.
+	 */
+	virtual uint32_t setDataRate(const uint8_t channels,
+			const uint16_t frequency) = 0;
+
+	/**
+	 * Checks whether new conversions are signalled by the data ready interrupt of the LSM9DS1.
+	 * Sources without it are read whenever the next measurement is due.
+	 *
+	 * @param channels	The bit mask of the SensorChannels being recorded.
+	 * @return	True if the reader task should wait for the data ready interrupt.
+	 */
+	virtual bool isDataReadyDriven(const uint8_t /*channels*/) const {
+		return false;
+	}
+
+	/**
+	 * Checks whether this source buffers the accelerometer and gyroscope conversions in a FIFO.
+	 *
+	 * @return	True if setFifo can enable a FIFO.
+	 */
+	virtual bool hasFifo() const {
+		return false;
+	}
+
+	/**
+	 * Enables or disables buffering the accelerometer and gyroscope conversions in the FIFO.
+	 * While it is enabled, each read of the accelerometer and gyroscope returns the oldest buffered conversion.
+	 *
+	 * @param enabled	Whether to use the FIFO.
+	 */
+	virtual void setFifo(const bool /*enabled*/) {
+	}
+
+	/**
+	 * Gets the number of conversions waiting in the FIFO.
+	 *
+	 * @return	The number of buffered conversions.
+	 */
+	virtual uint8_t getFifoLevel() {
+		return 1;
+	}
+
+	/**
+	 * Reads the raw values of the latest conversion, or the oldest one in the FIFO.
+	 * The magnetometer has no FIFO, so it always returns its latest conversion.
+	 * Only the values of the given sensors are written.
+	 *
+	 * @param sensors	The bit mask of the SensorChannels to read. Never 0.
+	 * @param accel		The array to write the three accelerometer values to.
+	 * @param gyro		The array to write the three gyroscope values to.
+	 * @param mag		The array to write the three magnetometer values to.
+	 */
+	virtual void read(const uint8_t sensors, int16_t *accel, int16_t *gyro,
+			int16_t *mag) = 0;
+};
+
+#endif /* SRC_SENSORSOURCE_H_ */
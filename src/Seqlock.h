@@ -0,0 +1,85 @@
+/*
+ * Seqlock.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SEQLOCK_H_
+#define SRC_SEQLOCK_H_
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * A double buffered sequence lock, publishing a small value from exactly one writer task to any number of readers.
+ * Neither side ever blocks the other. The writer always writes the copy readers aren't using,
+ * so a reader only has to retry if the writer finished a write and started the next one while it was copying.
+ * That can't happen while a reader preempts the writer on the same core, so readers never spin on a preempted writer.
+ *
+ * @tparam T	The type of the published value. Has to be trivially copyable.
+ */
+template<typename T>
+class Seqlock {
+public:
+	/**
+	 * Creates a new Seqlock publishing a value initialized with zeros.
+	 */
+	Seqlock() {
+	}
+
+	Seqlock(const Seqlock &other) = delete;
+	Seqlock& operator=(const Seqlock &other) = delete;
+
+	/**
+	 * Publishes a new value. May only be called by the writer.
+	 *
+	 * @param value	The value to publish.
+	 */
+	void write(const T &value) {
+		// An odd sequence means the copy after the last completed one is being written.
+		const uint32_t sequence = this->sequence.load(std::memory_order_relaxed);
+		this->sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		copies[((sequence >> 1) + 1) & 1] = value;
+		this->sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	/**
+	 * Gets a consistent copy of the last published value. May be called by any task.
+	 *
+	 * @return	The last completely published value.
+	 */
+	T read() const {
+		T value;
+		uint32_t before;
+		uint32_t after;
+		do {
+			before = sequence.load(std::memory_order_acquire);
+			value = copies[(before >> 1) & 1];
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence.load(std::memory_order_relaxed);
+			// The copy is only written again by the second write starting after the one completed before.
+		} while (after - (before & ~1u) > 2);
+		return value;
+	}
+
+private:
+	std::atomic<uint32_t> sequence { 0 };
+	T copies[2] = { };
+};
+
+#endif /* SRC_SEQLOCK_H_ */
@@ -0,0 +1,125 @@
+/*
+ * SlotAllocator.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SlotAllocator.h"
+#include <algorithm>
+
+void SlotAllocator::reset(float *memory, const size_t size) {
+	std::lock_guard<std::mutex> lock(mutex);
+	SlotAllocator::memory = memory;
+	SlotAllocator::size = memory == NULL ? 0 : size;
+	slots.clear();
+}
+
+void SlotAllocator::reset(const size_t size) {
+	std::lock_guard<std::mutex> lock(mutex);
+	memory = NULL;
+	SlotAllocator::size = size;
+	slots.clear();
+}
+
+float* SlotAllocator::allocate(const size_t size) {
+	if (memory == NULL) {
+		return NULL;
+	}
+
+	const size_t offset = allocateOffset(size);
+	return offset == NO_SLOT ? NULL : memory + offset;
+}
+
+void SlotAllocator::release(float *slot) {
+	if (slot != NULL) {
+		releaseOffset(slot - memory);
+	}
+}
+
+size_t SlotAllocator::allocateOffset(const size_t size) {
+	if (size == 0) {
+		return NO_SLOT;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t best_offset = 0;
+	size_t best_size = 0;
+	size_t best_index = 0;
+	size_t offset = 0;
+	for (size_t i = 0; i <= slots.size(); i++) {
+		// The last extent is the one between the last slot and the end of the region.
+		const size_t end = i < slots.size() ? slots[i].offset : SlotAllocator::size;
+		const size_t free = end - offset;
+		if (free >= size && (best_size == 0 || free < best_size)) {
+			best_offset = offset;
+			best_size = free;
+			best_index = i;
+		}
+
+		if (i < slots.size()) {
+			offset = slots[i].offset + slots[i].size;
+		}
+	}
+
+	if (best_size == 0) {
+		return NO_SLOT;
+	}
+
+	slots.insert(slots.begin() + best_index, { best_offset, size });
+	return best_offset;
+}
+
+void SlotAllocator::releaseOffset(const size_t offset) {
+	if (offset == NO_SLOT) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::vector<Slot>::iterator it = slots.begin(); it != slots.end(); it++) {
+		if (it->offset == offset) {
+			slots.erase(it);
+			return;
+		}
+	}
+}
+
+size_t SlotAllocator::getLargestFree() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t largest = 0;
+	size_t offset = 0;
+	for (const Slot &slot : slots) {
+		largest = std::max(largest, slot.offset - offset);
+		offset = slot.offset + slot.size;
+	}
+
+	return std::max(largest, size - offset);
+}
+
+size_t SlotAllocator::getFree() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t free = size;
+	for (const Slot &slot : slots) {
+		free -= slot.size;
+	}
+
+	return free;
+}
+
+size_t SlotAllocator::getSlots() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return slots.size();
+}
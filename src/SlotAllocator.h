@@ -0,0 +1,150 @@
+/*
+ * SlotAllocator.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SLOTALLOCATOR_H_
+#define SRC_SLOTALLOCATOR_H_
+
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Splits a large memory region into slots of arbitrary size, which can be allocated and released in any order.
+ * Used to give each recording session its own part of the PSRAM.
+ *
+ * Slots are allocated from the smallest free extent they fit into, to keep large extents available.
+ * Adjacent free extents are merged implicitly, since only the allocated slots are tracked.
+ * All methods are thread safe, so slots can be released from whichever task drops the last reference to them.
+ */
+class SlotAllocator {
+public:
+	/**
+	 * The offset returned by allocateOffset if there is no free extent large enough.
+	 */
+	static const size_t NO_SLOT = (size_t) -1;
+
+	/**
+	 * Creates a new SlotAllocator without any memory.
+	 */
+	SlotAllocator() {
+	}
+
+	/**
+	 * Sets the memory region to allocate slots from.
+	 * Must not be called while slots are allocated.
+	 *
+	 * @param memory	A pointer to the first float of the memory region.
+	 * @param size		The number of floats in the memory region.
+	 */
+	void reset(float *memory, const size_t size);
+
+	/**
+	 * Sets the size of a memory region that can't be addressed directly, like the himem of the ESP32.
+	 * Slots of it can only be allocated using allocateOffset.
+	 * Must not be called while slots are allocated.
+	 *
+	 * @param size	The number of floats in the memory region.
+	 */
+	void reset(const size_t size);
+
+	/**
+	 * Allocates a slot of the given size.
+	 *
+	 * @param size	The number of floats to allocate.
+	 * @return	A pointer to the first float of the slot, or NULL if there is no free extent large enough.
+	 */
+	float* allocate(const size_t size);
+
+	/**
+	 * Releases a slot previously returned by allocate.
+	 * Does nothing if the given pointer is NULL.
+	 *
+	 * @param slot	A pointer to the first float of the slot to release.
+	 */
+	void release(float *slot);
+
+	/**
+	 * Allocates a slot of the given size, and returns its offset in the memory region.
+	 *
+	 * @param size	The number of floats to allocate.
+	 * @return	The offset of the slot in floats, or NO_SLOT if there is no free extent large enough.
+	 */
+	size_t allocateOffset(const size_t size);
+
+	/**
+	 * Releases a slot previously returned by allocateOffset.
+	 * Does nothing if the given offset is NO_SLOT.
+	 *
+	 * @param offset	The offset of the slot to release.
+	 */
+	void releaseOffset(const size_t offset);
+
+	/**
+	 * Gets the size of the largest free extent, which is the largest slot that can currently be allocated.
+	 *
+	 * @return	The size of the largest free extent in floats.
+	 */
+	size_t getLargestFree() const;
+
+	/**
+	 * Gets the total size of all free extents.
+	 *
+	 * @return	The number of free floats.
+	 */
+	size_t getFree() const;
+
+	/**
+	 * Gets the size of the managed memory region.
+	 *
+	 * @return	The size of the memory region in floats.
+	 */
+	size_t getSize() const {
+		return size;
+	}
+
+	/**
+	 * Gets the number of currently allocated slots.
+	 *
+	 * @return	The number of allocated slots.
+	 */
+	size_t getSlots() const;
+
+private:
+	/**
+	 * An allocated part of the memory region.
+	 */
+	struct Slot {
+		size_t offset;
+		size_t size;
+	};
+
+	float *memory = NULL;
+	size_t size = 0;
+
+	/**
+	 * The allocated slots, ordered by offset.
+	 * The free extents are the gaps between them.
+	 */
+	std::vector<Slot> slots;
+
+	mutable std::mutex mutex;
+};
+
+#endif /* SRC_SLOTALLOCATOR_H_ */
@@ -0,0 +1,215 @@
+/*
+ * Spectrum.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Spectrum.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+/**
+ * Allocates memory in internal RAM, since the tables are accessed a lot more often than the recorded data.
+ *
+ * @param count	The number of floats to allocate.
+ * @return	The allocated memory, or NULL if allocation failed.
+ */
+static float* allocateInternal(const size_t count) {
+#ifdef ARDUINO
+	return (float*) heap_caps_malloc(count * sizeof(float),
+			MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+	return (float*) malloc(count * sizeof(float));
+#endif
+}
+
+static void freeInternal(float *memory) {
+#ifdef ARDUINO
+	heap_caps_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+RealFFT::RealFFT(const uint16_t size) :
+		size(size) {
+	if (size < 4 || (size & (size - 1)) != 0) {
+		return;
+	}
+
+	cos_table = allocateInternal(size / 2);
+	sin_table = allocateInternal(size / 2);
+	if (!isValid()) {
+		return;
+	}
+
+	for (uint16_t k = 0; k < size / 2; k++) {
+		const double angle = -2 * M_PI * k / size;
+		cos_table[k] = cos(angle);
+		sin_table[k] = sin(angle);
+	}
+}
+
+RealFFT::~RealFFT() {
+	freeInternal(cos_table);
+	freeInternal(sin_table);
+}
+
+void RealFFT::transform(float *data) const {
+	const uint16_t n = size / 2;
+
+	// Bit reversal permutation.
+	for (uint16_t i = 1, j = 0; i < n; i++) {
+		uint16_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+
+		if (i < j) {
+			float temp = data[i * 2];
+			data[i * 2] = data[j * 2];
+			data[j * 2] = temp;
+			temp = data[i * 2 + 1];
+			data[i * 2 + 1] = data[j * 2 + 1];
+			data[j * 2 + 1] = temp;
+		}
+	}
+
+	// The twiddle factors of an n point FFT are every second entry of the size point tables.
+	for (uint16_t length = 2; length <= n; length <<= 1) {
+		const uint16_t half = length / 2;
+		const uint16_t table_step = size / length;
+		for (uint16_t start = 0; start < n; start += length) {
+			for (uint16_t k = 0; k < half; k++) {
+				const float wr = cos_table[k * table_step];
+				const float wi = sin_table[k * table_step];
+				float *even = data + (start + k) * 2;
+				float *odd = data + (start + k + half) * 2;
+				const float tr = wr * odd[0] - wi * odd[1];
+				const float ti = wr * odd[1] + wi * odd[0];
+				odd[0] = even[0] - tr;
+				odd[1] = even[1] - ti;
+				even[0] += tr;
+				even[1] += ti;
+			}
+		}
+	}
+}
+
+void RealFFT::powerSpectrum(float *samples, float *power) const {
+	const uint16_t n = size / 2;
+
+	// Treat the even samples as real and the odd ones as imaginary parts.
+	transform(samples);
+
+	// Split the result into the spectrum of the real signal.
+	power[0] = (samples[0] + samples[1]) * (samples[0] + samples[1]);
+	power[n] = (samples[0] - samples[1]) * (samples[0] - samples[1]);
+	for (uint16_t k = 1; k < n; k++) {
+		const float zr = samples[k * 2];
+		const float zi = samples[k * 2 + 1];
+		const float cr = samples[(n - k) * 2];
+		const float ci = -samples[(n - k) * 2 + 1];
+
+		// Even part (Z[k] + conj(Z[n - k])) / 2, odd part (Z[k] - conj(Z[n - k])) / 2i.
+		const float er = (zr + cr) / 2;
+		const float ei = (zi + ci) / 2;
+		const float or_ = (zi - ci) / 2;
+		const float oi = -(zr - cr) / 2;
+
+		const float wr = cos_table[k];
+		const float wi = sin_table[k];
+		const float xr = er + wr * or_ - wi * oi;
+		const float xi = ei + wr * oi + wi * or_;
+		power[k] = xr * xr + xi * xi;
+	}
+}
+
+PowerSpectralDensity::PowerSpectralDensity(const uint16_t segment_size) :
+		fft(segment_size) {
+	if (!fft.isValid()) {
+		return;
+	}
+
+	window = allocateInternal(segment_size);
+	buffer = allocateInternal(segment_size);
+	spectrum = allocateInternal(segment_size / 2 + 1);
+	power = allocateInternal(segment_size / 2 + 1);
+	if (!isValid()) {
+		return;
+	}
+
+	memset(power, 0, (segment_size / 2 + 1) * sizeof(float));
+	for (uint16_t i = 0; i < segment_size; i++) {
+		window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / segment_size);
+		window_power += window[i] * window[i];
+	}
+}
+
+PowerSpectralDensity::~PowerSpectralDensity() {
+	freeInternal(window);
+	freeInternal(buffer);
+	freeInternal(spectrum);
+	freeInternal(power);
+}
+
+bool PowerSpectralDensity::isValid() const {
+	return fft.isValid() && window != NULL && buffer != NULL && spectrum != NULL
+			&& power != NULL;
+}
+
+void PowerSpectralDensity::addSegment() {
+	const uint16_t size = fft.getSize();
+
+	float mean = 0;
+	for (uint16_t i = 0; i < size; i++) {
+		mean += buffer[i];
+	}
+	mean /= size;
+
+	for (uint16_t i = 0; i < size; i++) {
+		buffer[i] = (buffer[i] - mean) * window[i];
+	}
+
+	fft.powerSpectrum(buffer, spectrum);
+	for (uint16_t k = 0; k <= size / 2; k++) {
+		power[k] += spectrum[k];
+	}
+	segments++;
+}
+
+void PowerSpectralDensity::getDensity(float *density,
+		const float sample_rate) const {
+	const uint16_t bins = fft.getSize() / 2 + 1;
+	if (segments == 0) {
+		memset(density, 0, bins * sizeof(float));
+		return;
+	}
+
+	const float scale = 1 / (sample_rate * window_power * segments);
+	for (uint16_t k = 0; k < bins; k++) {
+		// One-sided, so every bin except DC and nyquist also contains the negative frequency.
+		const float factor = (k == 0 || k == bins - 1) ? 1 : 2;
+		density[k] = power[k] * scale * factor;
+	}
+}
@@ -0,0 +1,148 @@
+/*
+ * Spectrum.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SPECTRUM_H_
+#define SRC_SPECTRUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A radix-2 FFT for real input, implemented as a half size complex FFT.
+ * The twiddle factors are precomputed into internal RAM.
+ */
+class RealFFT {
+public:
+	/**
+	 * Creates a new RealFFT for the given number of samples.
+	 * Use isValid to check whether the size is supported and the tables could be allocated.
+	 *
+	 * @param size	The number of real input samples. Has to be a power of two, and at least 4.
+	 */
+	RealFFT(const uint16_t size);
+	virtual ~RealFFT();
+
+	/**
+	 * Checks whether this RealFFT can be used.
+	 *
+	 * @return	False if the size isn't a power of two, or allocating the tables failed.
+	 */
+	bool isValid() const {
+		return cos_table != NULL && sin_table != NULL;
+	}
+
+	uint16_t getSize() const {
+		return size;
+	}
+
+	/**
+	 * Calculates the squared magnitude of each frequency bin of the given samples.
+	 * The samples array is used as working memory, so its content is destroyed.
+	 * The two arrays may not overlap.
+	 *
+	 * @param samples	The size real samples to transform.
+	 * @param power		The array to write the size / 2 + 1 squared magnitudes to.
+	 * 					Bin k is the frequency k * sample_rate / size.
+	 */
+	void powerSpectrum(float *samples, float *power) const;
+
+private:
+	const uint16_t size;
+
+	/**
+	 * The cosine and sine of -2 * pi * k / size for k < size / 2.
+	 */
+	float *cos_table = NULL;
+	float *sin_table = NULL;
+
+	/**
+	 * Calculates the complex FFT of size / 2 interleaved complex values in place.
+	 *
+	 * @param data	The interleaved real and imaginary parts to transform.
+	 */
+	void transform(float *data) const;
+};
+
+/**
+ * Estimates the one-sided power spectral density of a signal using Welch's method.
+ * Each segment gets its mean removed and a hann window applied before transforming it,
+ * and the resulting power spectra are averaged.
+ */
+class PowerSpectralDensity {
+public:
+	/**
+	 * Creates a new PowerSpectralDensity estimator.
+	 *
+	 * @param segment_size	The number of samples per segment. Has to be a power of two.
+	 */
+	PowerSpectralDensity(const uint16_t segment_size);
+	virtual ~PowerSpectralDensity();
+
+	/**
+	 * Checks whether all the memory required for this estimator could be allocated.
+	 *
+	 * @return	True if this estimator can be used.
+	 */
+	bool isValid() const;
+
+	/**
+	 * Gets the buffer to write the next segment to before calling addSegment.
+	 * This buffer is located in internal RAM.
+	 *
+	 * @return	A buffer for segment_size samples.
+	 */
+	float* getSegmentBuffer() {
+		return buffer;
+	}
+
+	/**
+	 * Adds the segment written to the segment buffer to this estimate.
+	 */
+	void addSegment();
+
+	/**
+	 * Gets the number of segments added to this estimate.
+	 *
+	 * @return	The number of averaged segments.
+	 */
+	uint32_t getSegments() const {
+		return segments;
+	}
+
+	/**
+	 * Calculates the power spectral density from the segments added so far.
+	 *
+	 * @param density		The array to write the segment_size / 2 + 1 bins to.
+	 * 						In squared signal units per Hz.
+	 * @param sample_rate	The rate at which the signal was sampled, in samples per second.
+	 */
+	void getDensity(float *density, const float sample_rate) const;
+
+private:
+	RealFFT fft;
+	float *window = NULL;
+	float *buffer = NULL;
+	float *spectrum = NULL;
+	float *power = NULL;
+	float window_power = 0;
+	uint32_t segments = 0;
+};
+
+#endif /* SRC_SPECTRUM_H_ */
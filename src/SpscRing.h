@@ -0,0 +1,134 @@
+/*
+ * SpscRing.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SPSCRING_H_
+#define SRC_SPSCRING_H_
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * A lock-free ring buffer for passing items from exactly one producer task to exactly one consumer task.
+ * The items are stored in the object itself, so a statically allocated ring lives in internal RAM.
+ *
+ * @tparam T	The type of the items. Should be small and trivially copyable.
+ * @tparam SIZE	The max number of items in the ring. Has to be a power of two.
+ */
+template<typename T, uint16_t SIZE>
+class SpscRing {
+	static_assert((SIZE & (SIZE - 1)) == 0, "SIZE has to be a power of two.");
+
+public:
+	/**
+	 * Adds an item to the ring. May only be called by the producer.
+	 * If the ring is full, the item is dropped and counted as an overflow.
+	 *
+	 * @param item	The item to add.
+	 * @return	False if the ring was full.
+	 */
+	bool push(const T &item) {
+		const uint32_t head = this->head.load(std::memory_order_relaxed);
+		const uint32_t used = head - tail.load(std::memory_order_acquire);
+		if (used >= SIZE) {
+			overflows.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		buffer[head & (SIZE - 1)] = item;
+		this->head.store(head + 1, std::memory_order_release);
+
+		if (used + 1 > high_water.load(std::memory_order_relaxed)) {
+			high_water.store(used + 1, std::memory_order_relaxed);
+		}
+		return true;
+	}
+
+	/**
+	 * Removes the oldest item from the ring. May only be called by the consumer.
+	 *
+	 * @param item	The variable to write the removed item to.
+	 * @return	False if the ring was empty.
+	 */
+	bool pop(T &item) {
+		const uint32_t tail = this->tail.load(std::memory_order_relaxed);
+		if (tail == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		item = buffer[tail & (SIZE - 1)];
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Gets the number of items currently in the ring.
+	 *
+	 * @return	The number of items that can be popped.
+	 */
+	uint32_t available() const {
+		return head.load(std::memory_order_acquire)
+				- tail.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Gets the max number of items that were in the ring at the same time since the last resetStatistics.
+	 *
+	 * @return	The high-water mark.
+	 */
+	uint32_t getHighWater() const {
+		return high_water.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Gets the number of items dropped because the ring was full since the last resetStatistics.
+	 *
+	 * @return	The number of dropped items.
+	 */
+	uint32_t getOverflows() const {
+		return overflows.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Gets the max number of items in this ring.
+	 *
+	 * @return	The capacity of this ring.
+	 */
+	constexpr uint16_t getCapacity() const {
+		return SIZE;
+	}
+
+	/**
+	 * Resets the high-water mark and the overflow count.
+	 * Should only be called while the producer is idle.
+	 */
+	void resetStatistics() {
+		high_water.store(available(), std::memory_order_relaxed);
+		overflows.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	T buffer[SIZE];
+	std::atomic<uint32_t> head { 0 };
+	std::atomic<uint32_t> tail { 0 };
+	std::atomic<uint32_t> high_water { 0 };
+	std::atomic<uint32_t> overflows { 0 };
+};
+
+#endif /* SRC_SPSCRING_H_ */
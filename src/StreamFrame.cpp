@@ -0,0 +1,91 @@
+/*
+ * StreamFrame.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StreamFrame.h"
+#include <algorithm>
+#include <string.h>
+
+size_t StreamFrameWriter::peekFrame(const FrameBacklog &backlog,
+		uint8_t *buffer) {
+	StreamFrameHeader header;
+	if (backlog.copy(0, (uint8_t*) &header, sizeof(header)) < sizeof(header)) {
+		return 0;
+	}
+
+	// Frames are only ever pushed whole, so the rest of the frame is there too.
+	const size_t size = getFrameSize(header.samples, header.values);
+	return backlog.copy(0, buffer, size);
+}
+
+void StreamFrameWriter::reset(FrameBacklog *backlog, const uint8_t channels,
+		const uint8_t values, const uint16_t frequency,
+		const uint16_t samples) {
+	StreamFrameWriter::backlog = backlog;
+	frame_samples = std::max((uint16_t) 1, std::min(samples, (uint16_t) MAX_SAMPLES));
+	StreamFrameWriter::samples = 0;
+	header = { };
+	header.magic = STREAM_FRAME_MAGIC;
+	header.version = STREAM_FRAME_VERSION;
+	header.channels = channels;
+	header.values = std::min(values, (uint8_t) MAX_VALUES);
+	header.frequency = frequency;
+	length = sizeof(StreamFrameHeader);
+}
+
+bool StreamFrameWriter::add(const uint64_t time_us, const float *values) {
+	if (header.samples == 0) {
+		header.first_sample = samples;
+		header.start_us = time_us;
+	}
+
+	const uint32_t offset = time_us - header.start_us;
+	memcpy(frame + length, &offset, sizeof(offset));
+	length += sizeof(offset);
+	memcpy(frame + length, values, header.values * sizeof(float));
+	length += header.values * sizeof(float);
+	header.samples++;
+	samples++;
+
+	if (header.samples >= frame_samples) {
+		return flush();
+	}
+
+	return true;
+}
+
+bool StreamFrameWriter::flush() {
+	if (header.samples == 0) {
+		return true;
+	}
+
+	memcpy(frame, &header, sizeof(header));
+	const bool pushed = backlog != NULL && backlog->push(frame, length);
+	if (pushed) {
+		header.sequence++;
+		header.flags &= ~STREAM_FRAME_OVERFLOW;
+	} else {
+		header.dropped += header.samples;
+		header.flags |= STREAM_FRAME_OVERFLOW;
+	}
+
+	header.samples = 0;
+	length = sizeof(StreamFrameHeader);
+	return pushed;
+}
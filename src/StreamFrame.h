@@ -0,0 +1,251 @@
+/*
+ * StreamFrame.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STREAMFRAME_H_
+#define SRC_STREAMFRAME_H_
+
+#include "FrameBacklog.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * It is shared with the host side stream collector in the tools directory.
+ */
+
+/**
+ * The first four bytes of every stream frame, "LSMF" in ASCII.
+ */
+const uint32_t STREAM_FRAME_MAGIC = 0x464D534C;
+
+/**
+ * The version of the stream frame format.
+ */
+const uint8_t STREAM_FRAME_VERSION = 1;
+
+/**
+ * The flag set in the first frame after samples were dropped, because the backlog was full.
+ */
+const uint8_t STREAM_FRAME_OVERFLOW = 1;
+
+/**
+ * The header of a batch of samples streamed to a host collector.
+ * All values are little endian, which is the native byte order of both the ESP32 and common hosts.
+ *
+ * The header is followed by the samples of the frame.
+ * Each sample consists of its time as a uint32_t in microseconds since start_us, followed by its values as floats.
+ * The values are those of the streamed SensorChannels, in the order accelerometer, gyroscope, magnetometer.
+ * They are in m/s^2, rad/s, and micro tesla.
+ */
+struct __attribute__((packed)) StreamFrameHeader {
+	/**
+	 * Always STREAM_FRAME_MAGIC, to detect a stream that isn't at a frame boundary.
+	 */
+	uint32_t magic;
+
+	/**
+	 * The format version, STREAM_FRAME_VERSION.
+	 */
+	uint8_t version;
+
+	/**
+	 * The bit mask of the streamed SensorChannels.
+	 */
+	uint8_t channels;
+
+	/**
+	 * The number of float values per sample, not counting its time.
+	 */
+	uint8_t values;
+
+	/**
+	 * A combination of the STREAM_FRAME_* flags.
+	 */
+	uint8_t flags;
+
+	/**
+	 * The number of this frame, counting only frames that weren't dropped.
+	 * A gap means frames got lost after leaving the backlog, for example due to a reconnect.
+	 */
+	uint32_t sequence;
+
+	/**
+	 * The index of the first sample of this frame, counting all samples since the stream was started.
+	 * A gap means samples got lost, either in the backlog or in transit.
+	 */
+	uint64_t first_sample;
+
+	/**
+	 * The time of the first sample of this frame, in microseconds since the stream was started.
+	 */
+	uint64_t start_us;
+
+	/**
+	 * The total number of samples dropped because the backlog was full, since the stream was started.
+	 */
+	uint32_t dropped;
+
+	/**
+	 * The number of samples in this frame.
+	 */
+	uint16_t samples;
+
+	/**
+	 * The target sample rate of the stream, in samples per second.
+	 */
+	uint16_t frequency;
+};
+
+/**
+ * Batches samples into stream frames, and pushes them into a FrameBacklog.
+ * Frames that don't fit into the backlog are dropped, and reported in the header of the next frame.
+ */
+class StreamFrameWriter {
+public:
+	/**
+	 * The max number of samples per frame.
+	 */
+	static const uint16_t MAX_SAMPLES = 50;
+
+	/**
+	 * The max number of float values per sample.
+	 */
+	static const uint8_t MAX_VALUES = 9;
+
+	/**
+	 * The size of the largest possible frame in bytes.
+	 */
+	static const size_t MAX_FRAME_SIZE = sizeof(StreamFrameHeader)
+			+ MAX_SAMPLES * (sizeof(uint32_t) + MAX_VALUES * sizeof(float));
+
+	/**
+	 * Gets the size of a frame.
+	 *
+	 * @param samples	The number of samples in the frame.
+	 * @param values	The number of values per sample.
+	 * @return	The size of the frame in bytes.
+	 */
+	static size_t getFrameSize(const uint16_t samples, const uint8_t values) {
+		return sizeof(StreamFrameHeader)
+				+ samples * (sizeof(uint32_t) + values * sizeof(float));
+	}
+
+	/**
+	 * Copies the first frame of a backlog, without removing it.
+	 *
+	 * @param backlog	The backlog to copy the frame from.
+	 * @param buffer	The buffer to copy the frame to. Has to be at least MAX_FRAME_SIZE bytes large.
+	 * @return	The size of the frame, or 0 if the backlog is empty.
+	 */
+	static size_t peekFrame(const FrameBacklog &backlog, uint8_t *buffer);
+
+	/**
+	 * Creates a new StreamFrameWriter without a backlog.
+	 */
+	StreamFrameWriter() {
+	}
+
+	/**
+	 * Starts a new stream, and resets all counters.
+	 *
+	 * @param backlog	The backlog to push the frames to.
+	 * @param channels	The bit mask of the streamed SensorChannels.
+	 * @param values	The number of values per sample. At most MAX_VALUES.
+	 * @param frequency	The target sample rate in samples per second.
+	 * @param samples	The number of samples per frame. At most MAX_SAMPLES.
+	 */
+	void reset(FrameBacklog *backlog, const uint8_t channels,
+			const uint8_t values, const uint16_t frequency,
+			const uint16_t samples = MAX_SAMPLES);
+
+	/**
+	 * Adds a sample to the current frame, and pushes the frame if it is full.
+	 *
+	 * @param time_us	The time of the sample in microseconds since the stream was started.
+	 * @param values	The values of the sample.
+	 * @return	False if a frame had to be dropped.
+	 */
+	bool add(const uint64_t time_us, const float *values);
+
+	/**
+	 * Pushes the current frame, if it has any samples.
+	 *
+	 * @return	False if the frame had to be dropped.
+	 */
+	bool flush();
+
+	/**
+	 * Gets the time of the first sample of the current frame.
+	 *
+	 * @return	The time in microseconds since the stream was started, or 0 if the current frame is empty.
+	 */
+	uint64_t getFrameStart() const {
+		return header.samples > 0 ? header.start_us : 0;
+	}
+
+	/**
+	 * Gets the number of samples in the current frame.
+	 *
+	 * @return	The number of samples not pushed yet.
+	 */
+	uint16_t getPending() const {
+		return header.samples;
+	}
+
+	/**
+	 * Gets the number of samples added since the stream was started.
+	 *
+	 * @return	The number of samples.
+	 */
+	uint64_t getSamples() const {
+		return samples;
+	}
+
+	/**
+	 * Gets the number of frames pushed to the backlog.
+	 *
+	 * @return	The number of frames.
+	 */
+	uint32_t getFrames() const {
+		return header.sequence;
+	}
+
+	/**
+	 * Gets the number of samples dropped because the backlog was full.
+	 *
+	 * @return	The number of dropped samples.
+	 */
+	uint32_t getDropped() const {
+		return header.dropped;
+	}
+
+private:
+	FrameBacklog *backlog = NULL;
+	StreamFrameHeader header = { };
+	uint16_t frame_samples = MAX_SAMPLES;
+	uint64_t samples = 0;
+	size_t length = 0;
+
+	/**
+	 * The frame being assembled, including its header.
+	 */
+	uint8_t frame[MAX_FRAME_SIZE];
+};
+
+#endif /* SRC_STREAMFRAME_H_ */
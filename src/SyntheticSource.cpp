@@ -0,0 +1,128 @@
+/*
+ * SyntheticSource.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SyntheticSource.h"
+#include "RecordingSession.h"
+#include <math.h>
+
+/**
+ * The standard gravity, in m/s^2.
+ */
+static const float GRAVITY = 9.80665;
+
+/**
+ * The magnetic field of the earth in central europe, in uT.
+ */
+static const float EARTH_FIELD[3] = { 20, 0, -44 };
+
+SyntheticSource::SyntheticSource(const SensorScales &scales,
+		const uint8_t sensor) :
+		scales(scales), sensor(sensor) {
+}
+
+uint32_t SyntheticSource::setDataRate(const uint8_t /*channels*/,
+		const uint16_t frequency) {
+	const float odr = settings.odr > 0 ? settings.odr : frequency;
+	const uint32_t interval_us = odr < 1000000 ? 1000000 / odr : 1;
+
+	// Like a real sensor read at the target frequency, every read returns the conversion closest to it.
+	const float conversions = roundf(1000000.0f / frequency / interval_us);
+	step_us = interval_us * (conversions < 1 ? 1 : conversions);
+	time_us = 0;
+	random_state = settings.seed + sensor;
+	if (random_state == 0) {
+		random_state = 1;
+	}
+	return interval_us;
+}
+
+void SyntheticSource::read(const uint8_t sensors, int16_t *accel,
+		int16_t *gyro, int16_t *mag) {
+	const float time = time_us / 1000000.0f;
+	const float phase = 2 * M_PI * settings.vibration_frequency * time
+			+ sensor * M_PI / 4;
+
+	float shock = 0;
+	if (settings.shock_interval_ms > 0) {
+		const uint32_t since_shock = (time_us / 1000)
+				% settings.shock_interval_ms;
+		if (since_shock < SHOCK_DURATION_MS) {
+			const float shock_time = since_shock / 1000.0f
+					+ (time_us % 1000) / 1000000.0f;
+			// Decays to 1% of the peak within SHOCK_DURATION_MS.
+			shock = settings.shock_amplitude
+					* expf(-4.6f * shock_time * 1000 / SHOCK_DURATION_MS)
+					* sinf(2 * M_PI * SHOCK_FREQUENCY * shock_time + M_PI_2);
+		}
+	}
+
+	const float amplitude = settings.vibration_amplitude;
+	const float accel_values[3] = { amplitude * sinf(phase) + shock, amplitude
+			/ 2 * sinf(phase + M_PI / 3) + shock / 2, GRAVITY
+			+ amplitude / 4 * cosf(phase) };
+	const float rotation = settings.rotation_amplitude;
+	const float gyro_values[3] = { rotation * sinf(phase), rotation / 2
+			* cosf(phase), 0 };
+
+	// All values are generated, so the noise sequence is the same for any channel selection.
+	int16_t values[9];
+	for (uint8_t i = 0; i < 3; i++) {
+		values[i] = toRaw(accel_values[i], scales.accel);
+		values[i + 3] = toRaw(gyro_values[i], scales.gyro);
+		values[i + 6] = toRaw(EARTH_FIELD[i], scales.mag);
+	}
+
+	for (uint8_t i = 0; i < 3; i++) {
+		if (sensors & CHANNEL_ACCELEROMETER) {
+			accel[i] = values[i];
+		}
+		if (sensors & CHANNEL_GYROSCOPE) {
+			gyro[i] = values[i + 3];
+		}
+		if (sensors & CHANNEL_MAGNETOMETER) {
+			mag[i] = values[i + 6];
+		}
+	}
+
+	time_us += step_us;
+}
+
+float SyntheticSource::nextNoise() {
+	float sum = 0;
+	for (uint8_t i = 0; i < 4; i++) {
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 17;
+		random_state ^= random_state << 5;
+		sum += random_state / 4294967296.0f;
+	}
+
+	// The sum of four uniform values has a mean of 2 and a variance of 1/3.
+	return (sum - 2) * 1.7320508f;
+}
+
+int16_t SyntheticSource::toRaw(const float value, const float scale) {
+	const float raw = roundf(value / scale + settings.noise * nextNoise());
+	if (raw > INT16_MAX) {
+		return INT16_MAX;
+	} else if (raw < INT16_MIN) {
+		return INT16_MIN;
+	}
+	return raw;
+}
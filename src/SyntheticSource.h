@@ -0,0 +1,190 @@
+/*
+ * SyntheticSource.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SYNTHETICSOURCE_H_
+#define SRC_SYNTHETICSOURCE_H_
+
+#include "SensorSource.h"
+
+/**
+ * The signal generated by a SyntheticSource.
+ */
+struct SyntheticSettings {
+	/**
+	 * The simulated output data rate, in conversions per second.
+	 * 0 makes it follow the target measurement frequency of the recording.
+	 */
+	float odr;
+
+	/**
+	 * The frequency of the simulated vibration, in Hz.
+	 */
+	float vibration_frequency;
+
+	/**
+	 * The amplitude of the vibration of the accelerometer, in m/s^2.
+	 */
+	float vibration_amplitude;
+
+	/**
+	 * The amplitude of the rotation measured by the gyroscope, in rad/s.
+	 */
+	float rotation_amplitude;
+
+	/**
+	 * The standard deviation of the noise added to every value, in raw sensor units.
+	 */
+	float noise;
+
+	/**
+	 * The time between two shocks in milliseconds, or 0 to disable them.
+	 */
+	uint32_t shock_interval_ms;
+
+	/**
+	 * The peak acceleration of a shock, in m/s^2.
+	 */
+	float shock_amplitude;
+
+	/**
+	 * The seed of the noise generator.
+	 */
+	uint32_t seed;
+};
+
+/**
+ * A SensorSource generating a deterministic signal, made of sines, noise, and periodic shocks.
+ * The signal only depends on the settings and the number of samples read since the recording started,
+ * so recordings with the same settings contain the same values, independent of timing jitter.
+ */
+class SyntheticSource: public SensorSource {
+public:
+	/**
+	 * The time a shock takes to decay to about 1% of its peak, in milliseconds.
+	 */
+	static const uint32_t SHOCK_DURATION_MS = 100;
+
+	/**
+	 * The frequency the sensor rings at after a shock, in Hz.
+	 */
+	static const uint16_t SHOCK_FREQUENCY = 150;
+
+	/**
+	 * Creates a new SyntheticSource with default settings.
+	 * The sources of different sensors use different noise, and a shifted vibration phase.
+	 *
+	 * @param scales	The factors converting the raw values to SI units, used to generate the raw values.
+	 * @param sensor	The index of the simulated sensor.
+	 */
+	SyntheticSource(const SensorScales &scales, const uint8_t sensor = 0);
+
+	const char* getName() const override {
+		return "synthetic";
+	}
+
+	bool isAvailable() const override {
+		return true;
+	}
+
+	/**
+	 * Restarts the signal, and sets the time advanced per read to the conversion closest to the next measurement.
+	 *
+	 * @param channels	The bit mask of the SensorChannels being recorded.
+	 * @param frequency	The target measurement frequency, in measurements per second.
+	 * @return	The time between two simulated conversions, in microseconds.
+	 */
+	uint32_t setDataRate(const uint8_t channels, const uint16_t frequency)
+			override;
+
+	/**
+	 * Generates the values of the next measurement.
+	 * All values are generated, even those of sensors not read, so the noise doesn't depend on the recorded channels.
+	 *
+	 * @param sensors	The bit mask of the SensorChannels to read.
+	 * @param accel		The array to write the three accelerometer values to.
+	 * @param gyro		The array to write the three gyroscope values to.
+	 * @param mag		The array to write the three magnetometer values to.
+	 */
+	void read(const uint8_t sensors, int16_t *accel, int16_t *gyro,
+			int16_t *mag) override;
+
+	/**
+	 * Gets the settings of the generated signal.
+	 *
+	 * @return	The current settings.
+	 */
+	const SyntheticSettings& getSettings() const {
+		return settings;
+	}
+
+	/**
+	 * Sets the settings of the generated signal.
+	 * Applied when the next recording starts.
+	 *
+	 * @param settings	The new settings.
+	 */
+	void setSettings(const SyntheticSettings &settings) {
+		SyntheticSource::settings = settings;
+	}
+
+private:
+	const SensorScales scales;
+
+	/**
+	 * The index of the simulated sensor.
+	 */
+	const uint8_t sensor;
+
+	SyntheticSettings settings = { 0, 5, 2, 0.5, 8, 2000, 18, 1 };
+
+	/**
+	 * The time of the next generated measurement, in microseconds since the start of the recording.
+	 */
+	uint64_t time_us = 0;
+
+	/**
+	 * The time the signal advances by per read, in microseconds.
+	 */
+	uint32_t step_us = 1000;
+
+	/**
+	 * The state of the xorshift noise generator.
+	 */
+	uint32_t random_state = 1;
+
+	/**
+	 * Gets a pseudo random value with a mean of 0 and a standard deviation of about 1.
+	 * Approximates a normal distribution by summing four uniformly distributed values.
+	 *
+	 * @return	The random value.
+	 */
+	float nextNoise();
+
+	/**
+	 * Converts a value to raw sensor units, and adds noise.
+	 *
+	 * @param value	The value in SI units.
+	 * @param scale	The SI value of one raw unit.
+	 * @return	The raw value, saturated like the registers of a real sensor.
+	 */
+	int16_t toRaw(const float value, const float scale);
+};
+
+#endif /* SRC_SYNTHETICSOURCE_H_ */
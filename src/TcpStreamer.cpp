@@ -0,0 +1,153 @@
+/*
+ * TcpStreamer.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TcpStreamer.h"
+#include <WiFi.h>
+
+TcpStreamer::TcpStreamer(Metrics *metrics) :
+		metrics(metrics) {
+}
+
+bool TcpStreamer::start(const std::string &host, const uint16_t port,
+		const uint8_t channels, const uint8_t values, const uint16_t frequency,
+		SlotAllocator *allocator) {
+	if (state != STREAM_IDLE) {
+		return false;
+	}
+
+	float *slot = allocator->allocate(BACKLOG_SIZE / sizeof(float));
+	if (slot == NULL) {
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		TcpStreamer::host = host;
+		TcpStreamer::port = port;
+		TcpStreamer::allocator = allocator;
+		TcpStreamer::slot = slot;
+		backlog.reset((uint8_t*) slot, BACKLOG_SIZE);
+		writer.reset(&backlog, channels, values, frequency);
+		last_time_us = 0;
+		time_us = 0;
+		frames_sent = 0;
+		bytes_sent = 0;
+		connects = 0;
+		stopping = false;
+		state = STREAM_CONNECTING;
+	}
+
+	if (xTaskCreate(senderTask, "stream sender", 4096, this, 1, NULL)
+			!= pdPASS) {
+		std::lock_guard<std::mutex> lock(mutex);
+		backlog.reset(NULL, 0);
+		allocator->release(slot);
+		TcpStreamer::slot = NULL;
+		state = STREAM_IDLE;
+		return false;
+	}
+
+	return true;
+}
+
+void TcpStreamer::stop() {
+	if (state != STREAM_IDLE) {
+		stopping = true;
+		state = STREAM_STOPPING;
+	}
+}
+
+void TcpStreamer::add(const uint32_t time_us, const float *values) {
+	std::lock_guard<std::mutex> lock(mutex);
+	// Samples arrive in order, so the 32 bit time only has to be extended.
+	TcpStreamer::time_us += (uint32_t) (time_us - last_time_us);
+	last_time_us = time_us;
+	writer.add(TcpStreamer::time_us, values);
+}
+
+void TcpStreamer::poll(const uint32_t time_us) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const uint64_t now = TcpStreamer::time_us
+			+ (uint32_t) (time_us - last_time_us);
+	if (writer.getPending() > 0
+			&& now - writer.getFrameStart() >= FLUSH_INTERVAL_US) {
+		writer.flush();
+	}
+}
+
+uint64_t TcpStreamer::getSamples() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return writer.getSamples();
+}
+
+uint32_t TcpStreamer::getDropped() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return writer.getDropped();
+}
+
+void TcpStreamer::senderTask(void *streamer) {
+	((TcpStreamer*) streamer)->send();
+	vTaskDelete(NULL);
+}
+
+void TcpStreamer::send() {
+	WiFiClient client;
+	while (!stopping) {
+		if (!client.connected()) {
+			if (state == STREAM_CONNECTED && !stopping) {
+				state = STREAM_CONNECTING;
+			}
+			client.stop();
+			if (!client.connect(host.c_str(), port, CONNECT_TIMEOUT_MS)) {
+				delay(RECONNECT_DELAY_MS);
+				continue;
+			}
+			client.setNoDelay(true);
+			connects++;
+			if (!stopping) {
+				state = STREAM_CONNECTED;
+			}
+		}
+
+		const size_t size = StreamFrameWriter::peekFrame(backlog, buffer);
+		if (size == 0) {
+			delay(5);
+			continue;
+		}
+
+		// A partially written frame is sent again on the next connection, the collector drops the incomplete one.
+		if (client.write(buffer, size) != size) {
+			client.stop();
+			continue;
+		}
+
+		backlog.consume(size);
+		frames_sent++;
+		bytes_sent += size;
+	}
+	client.stop();
+	metrics->recordStack("stream sender");
+
+	std::lock_guard<std::mutex> lock(mutex);
+	backlog.reset(NULL, 0);
+	allocator->release(slot);
+	slot = NULL;
+	state = STREAM_IDLE;
+}
@@ -0,0 +1,236 @@
+/*
+ * TcpStreamer.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TCPSTREAMER_H_
+#define SRC_TCPSTREAMER_H_
+
+#include "FrameBacklog.h"
+#include "Metrics.h"
+#include "SlotAllocator.h"
+#include "StreamFrame.h"
+#include <mutex>
+#include <string>
+
+/**
+ * The states of a TcpStreamer.
+ */
+enum StreamState : uint8_t {
+	/**
+	 * Nothing is being streamed.
+	 */
+	STREAM_IDLE,
+
+	/**
+	 * Samples are being collected, but there is no connection to the collector.
+	 */
+	STREAM_CONNECTING,
+
+	/**
+	 * Samples are being sent to the collector.
+	 */
+	STREAM_CONNECTED,
+
+	/**
+	 * The stream was stopped, but the sender task didn't exit yet.
+	 */
+	STREAM_STOPPING
+};
+
+/**
+ * Streams samples to a host collector over a plain TCP connection, while they are being measured.
+ *
+ * The samples are batched into frames in internal RAM, and pushed into a backlog in PSRAM.
+ * A separate sender task sends the frames from there, so WiFi stalls only fill the backlog.
+ * If the backlog is full, frames are dropped, and the number of dropped samples is reported in the next frame.
+ * A frame is only removed from the backlog once it was written completely, so reconnects start at a frame boundary.
+ */
+class TcpStreamer {
+public:
+	/**
+	 * The size of the PSRAM backlog in bytes.
+	 * About 20 seconds of all channels at 1000 samples per second.
+	 */
+	static const size_t BACKLOG_SIZE = 768 * 1024;
+
+	/**
+	 * The max time a sample waits in a partial frame, in microseconds.
+	 */
+	static const uint32_t FLUSH_INTERVAL_US = 100000;
+
+	/**
+	 * The time to wait before trying to connect again after a failed connection attempt, in milliseconds.
+	 */
+	static const uint16_t RECONNECT_DELAY_MS = 1000;
+
+	/**
+	 * The max time to wait for the collector to accept a connection, in milliseconds.
+	 */
+	static const uint16_t CONNECT_TIMEOUT_MS = 3000;
+
+	/**
+	 * Creates a new idle TcpStreamer.
+	 *
+	 * @param metrics	The metrics to report the stack of the sender task to.
+	 */
+	TcpStreamer(Metrics *metrics);
+
+	TcpStreamer(const TcpStreamer &other) = delete;
+	TcpStreamer& operator=(const TcpStreamer &other) = delete;
+
+	/**
+	 * Starts a new stream, and the sender task connecting to the collector.
+	 *
+	 * @param host		The host name or IP address of the collector.
+	 * @param port		The TCP port of the collector.
+	 * @param channels	The bit mask of the streamed SensorChannels.
+	 * @param values	The number of values per sample.
+	 * @param frequency	The target sample rate in samples per second.
+	 * @param allocator	The allocator to allocate the backlog from. Its slot is released when the sender task exits.
+	 * @return	False if the streamer isn't idle, or the backlog or the sender task couldn't be created.
+	 */
+	bool start(const std::string &host, const uint16_t port,
+			const uint8_t channels, const uint8_t values,
+			const uint16_t frequency, SlotAllocator *allocator);
+
+	/**
+	 * Stops the current stream.
+	 * The frames still in the backlog are dropped, and the sender task exits as soon as its current write is done.
+	 * The producer has to stop adding samples before calling this.
+	 */
+	void stop();
+
+	/**
+	 * Adds a sample to the stream. May only be called by a single producer task.
+	 *
+	 * @param time_us	The time of the sample in microseconds since the stream was started.
+	 * 					May wrap around, as long as samples are at most about an hour apart.
+	 * @param values	The values of the sample.
+	 */
+	void add(const uint32_t time_us, const float *values);
+
+	/**
+	 * Pushes the current frame to the backlog if its first sample is older than FLUSH_INTERVAL_US.
+	 * Has to be called regularly by the producer, so slow streams don't wait for a full frame.
+	 *
+	 * @param time_us	The current time in microseconds since the stream was started.
+	 */
+	void poll(const uint32_t time_us);
+
+	StreamState getState() const {
+		return state;
+	}
+
+	const std::string& getHost() const {
+		return host;
+	}
+
+	uint16_t getPort() const {
+		return port;
+	}
+
+	/**
+	 * Gets the number of samples added to the current or last stream.
+	 *
+	 * @return	The number of samples.
+	 */
+	uint64_t getSamples() const;
+
+	/**
+	 * Gets the number of samples of the current or last stream dropped because the backlog was full.
+	 *
+	 * @return	The number of dropped samples.
+	 */
+	uint32_t getDropped() const;
+
+	/**
+	 * Gets the number of frames completely written to the collector.
+	 *
+	 * @return	The number of sent frames.
+	 */
+	uint32_t getFramesSent() const {
+		return frames_sent;
+	}
+
+	/**
+	 * Gets the number of bytes completely written to the collector.
+	 *
+	 * @return	The number of sent bytes.
+	 */
+	uint64_t getBytesSent() const {
+		return bytes_sent;
+	}
+
+	/**
+	 * Gets the number of successful connections to the collector.
+	 * More than one means the connection was lost and reestablished.
+	 *
+	 * @return	The number of connections.
+	 */
+	uint32_t getConnects() const {
+		return connects;
+	}
+
+	const FrameBacklog& getBacklog() const {
+		return backlog;
+	}
+
+private:
+	/**
+	 * The function of the task sending the frames from the backlog.
+	 *
+	 * @param streamer	A pointer to the TcpStreamer to send the frames of.
+	 */
+	static void senderTask(void *streamer);
+
+	/**
+	 * Sends the frames of the backlog until the stream is stopped.
+	 */
+	void send();
+
+	Metrics *const metrics;
+	std::string host;
+	uint16_t port = 0;
+	volatile StreamState state = STREAM_IDLE;
+	volatile bool stopping = false;
+
+	SlotAllocator *allocator = NULL;
+	float *slot = NULL;
+	FrameBacklog backlog;
+	StreamFrameWriter writer;
+
+	/**
+	 * Guards the writer, so the backlog can't be released while a frame is pushed to it.
+	 */
+	mutable std::mutex mutex;
+
+	uint32_t last_time_us = 0;
+	uint64_t time_us = 0;
+
+	volatile uint32_t frames_sent = 0;
+	volatile uint64_t bytes_sent = 0;
+	volatile uint32_t connects = 0;
+
+	/**
+	 * The frame being sent, copied out of the backlog.
+	 */
+	uint8_t buffer[StreamFrameWriter::MAX_FRAME_SIZE];
+};
+
+#endif /* SRC_TCPSTREAMER_H_ */
@@ -0,0 +1,99 @@
+/*
+ * Trace.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Trace.h"
+#include <string.h>
+
+const char *const TRACE_SPAN_NAMES[TRACE_SPANS] = { "loop", "csv_generator",
+		"csv_chunk", "format_value", "sensor_read", "psram_store",
+		"orientation_update", "buffer_write", "buffer_read" };
+
+#ifdef ENABLE_TRACE
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static_assert((Trace::RING_SIZE & (Trace::RING_SIZE - 1)) == 0,
+		"RING_SIZE has to be a power of two.");
+
+/**
+ * The ring is a static array, so it lives in internal RAM, and recording a span never allocates.
+ */
+static TraceRecord trace_ring[Trace::RING_SIZE];
+
+/**
+ * The number of records written since booting.
+ */
+static std::atomic<uint32_t> trace_next { 0 };
+
+void Trace::record(const TraceSpan span, const uint32_t start,
+		const uint32_t end) {
+	const uint32_t index = trace_next.fetch_add(1, std::memory_order_relaxed);
+	TraceRecord &record = trace_ring[index & (RING_SIZE - 1)];
+	record.start = start;
+	record.cycles = end - start;
+	record.task = (uint32_t) (uintptr_t) xTaskGetCurrentTaskHandle();
+	record.span = span;
+	record.core = xPortGetCoreID();
+	record.reserved = 0;
+}
+
+size_t Trace::getDumpSize() {
+	size_t size = sizeof(TraceDumpHeader) + RING_SIZE * sizeof(TraceRecord);
+	for (uint8_t span = 0; span < TRACE_SPANS; span++) {
+		size += strlen(TRACE_SPAN_NAMES[span]) + 1;
+	}
+	return size;
+}
+
+size_t Trace::dump(uint8_t *buffer, const size_t size, const uint32_t cpu_mhz) {
+	const uint32_t total = trace_next.load(std::memory_order_relaxed);
+	const uint32_t records = total < RING_SIZE ? total : RING_SIZE;
+
+	TraceDumpHeader header;
+	header.magic = TRACE_DUMP_MAGIC;
+	header.version = 1;
+	header.spans = TRACE_SPANS;
+	header.record_size = sizeof(TraceRecord);
+	header.cpu_mhz = cpu_mhz;
+	header.records = records;
+	header.total = total;
+	if (size < getDumpSize()) {
+		return 0;
+	}
+
+	size_t length = 0;
+	memcpy(buffer, &header, sizeof(header));
+	length += sizeof(header);
+	for (uint8_t span = 0; span < TRACE_SPANS; span++) {
+		const size_t name_length = strlen(TRACE_SPAN_NAMES[span]) + 1;
+		memcpy(buffer + length, TRACE_SPAN_NAMES[span], name_length);
+		length += name_length;
+	}
+
+	// The oldest record is the one the next span will overwrite.
+	for (uint32_t i = total - records; i != total; i++) {
+		memcpy(buffer + length, &trace_ring[i & (RING_SIZE - 1)],
+				sizeof(TraceRecord));
+		length += sizeof(TraceRecord);
+	}
+	return length;
+}
+#endif /* ENABLE_TRACE */
@@ -0,0 +1,243 @@
+/*
+ * Trace.h
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_H_
+#define SRC_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Without ENABLE_TRACE, which is only set by the esp32dev_profile environment, TRACE_SPAN compiles to nothing.
+ */
+
+/**
+ * The traced hot paths.
+ */
+enum TraceSpan : uint8_t {
+	/**
+	 * One call of LSM9DS1Handler::loop.
+	 */
+	TRACE_LOOP,
+
+	/**
+	 * One wake-up of a csv generator task that generates a chunk.
+	 */
+	TRACE_CSV_GENERATOR,
+
+	/**
+	 * Generating one chunk of a measurement csv.
+	 */
+	TRACE_CSV_CHUNK,
+
+	/**
+	 * Formatting a single value of a measurement csv.
+	 */
+	TRACE_FORMAT_VALUE,
+
+	/**
+	 * Reading the register blocks of one sample over the sensor bus.
+	 */
+	TRACE_SENSOR_READ,
+
+	/**
+	 * Appending one sample to a sample stream in PSRAM.
+	 */
+	TRACE_PSRAM_STORE,
+
+	/**
+	 * One update of the orientation filter.
+	 */
+	TRACE_ORIENTATION_UPDATE,
+
+	/**
+	 * Writing to the buffer of a csv download.
+	 */
+	TRACE_BUFFER_WRITE,
+
+	/**
+	 * Reading from the buffer of a csv download.
+	 */
+	TRACE_BUFFER_READ,
+
+	TRACE_SPANS
+};
+
+/**
+ * The names of the TraceSpans, in the order of their values.
+ */
+extern const char *const TRACE_SPAN_NAMES[TRACE_SPANS];
+
+/**
+ * A single finished span, as stored in the trace ring.
+ */
+struct TraceRecord {
+	/**
+	 * The cycle counter of the core at the start of the span.
+	 */
+	uint32_t start;
+
+	/**
+	 * The number of cycles the span took.
+	 */
+	uint32_t cycles;
+
+	/**
+	 * The handle of the task running the span, to tell interleaved tasks apart.
+	 */
+	uint32_t task;
+
+	/**
+	 * The TraceSpan.
+	 */
+	uint8_t span;
+
+	/**
+	 * The core the span ran on. Each core has its own cycle counter.
+	 */
+	uint8_t core;
+
+	uint16_t reserved;
+};
+
+/**
+ * The header of a trace dump, as sent by /trace.bin.
+ * It is followed by the NUL terminated names of the TraceSpans, and then the TraceRecords, oldest first.
+ */
+struct __attribute__((packed)) TraceDumpHeader {
+	/**
+	 * Always TRACE_DUMP_MAGIC.
+	 */
+	uint32_t magic;
+	uint8_t version;
+
+	/**
+	 * The number of span names following the header.
+	 */
+	uint8_t spans;
+
+	/**
+	 * The size of a TraceRecord in bytes.
+	 */
+	uint16_t record_size;
+
+	/**
+	 * The frequency of the cycle counter, in MHz.
+	 */
+	uint32_t cpu_mhz;
+
+	/**
+	 * The number of records in this dump.
+	 */
+	uint32_t records;
+
+	/**
+	 * The number of records written since booting, including those overwritten since.
+	 */
+	uint32_t total;
+};
+
+/**
+ * The first four bytes of a trace dump, "TRCE" in ASCII.
+ */
+const uint32_t TRACE_DUMP_MAGIC = 0x45435254;
+
+#ifdef ENABLE_TRACE
+/**
+ * A fixed size ring of the last traced spans, in internal RAM.
+ * Spans are recorded by any task on either core without locking, so a dump may contain a record that is being overwritten.
+ */
+class Trace {
+public:
+	/**
+	 * The number of records in the ring. Has to be a power of two.
+	 */
+	static const uint16_t RING_SIZE = 2048;
+
+	/**
+	 * Reads the cycle counter of the current core.
+	 *
+	 * @return	The number of cycles since the core started, wrapping around.
+	 */
+	static inline uint32_t getCycles() {
+#ifdef __XTENSA__
+		uint32_t cycles;
+		__asm__ __volatile__("rsr %0, ccount" : "=a"(cycles));
+		return cycles;
+#else
+		return 0;
+#endif
+	}
+
+	/**
+	 * Adds a finished span to the ring.
+	 *
+	 * @param span	The TraceSpan that finished.
+	 * @param start	The cycle counter at its start.
+	 * @param end	The cycle counter at its end.
+	 */
+	static void record(const TraceSpan span, const uint32_t start,
+			const uint32_t end);
+
+	/**
+	 * Calculates the size of a dump of the current ring.
+	 *
+	 * @return	The size in bytes.
+	 */
+	static size_t getDumpSize();
+
+	/**
+	 * Writes a dump of the ring, starting with a TraceDumpHeader.
+	 *
+	 * @param buffer	The buffer to write to. Has to be at least getDumpSize() bytes large.
+	 * @param size		The size of the buffer.
+	 * @param cpu_mhz	The frequency of the cycle counter, in MHz.
+	 * @return	The number of bytes written.
+	 */
+	static size_t dump(uint8_t *buffer, const size_t size,
+			const uint32_t cpu_mhz);
+};
+
+/**
+ * Records the time from its creation to the end of its scope as a span.
+ */
+class TraceScope {
+public:
+	TraceScope(const TraceSpan span) :
+			span(span), start(Trace::getCycles()) {
+	}
+
+	~TraceScope() {
+		Trace::record(span, start, Trace::getCycles());
+	}
+
+private:
+	const TraceSpan span;
+	const uint32_t start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(span) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(span)
+#else
+#define TRACE_SPAN(span) do {} while (0)
+#endif /* ENABLE_TRACE */
+
+#endif /* SRC_TRACE_H_ */
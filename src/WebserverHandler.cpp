@@ -19,10 +19,12 @@
  */
 
 #include "WebserverHandler.h"
+#include "Trace.h"
 #include <regex>
 
-WebserverHandler::WebserverHandler(LSM9DS1Handler *handler, uint16_t port) :
-		lsm9ds1(handler), server(port) {
+WebserverHandler::WebserverHandler(LSM9DS1Handler *handler, Metrics *metrics,
+		uint16_t port) :
+		lsm9ds1(handler), metrics(metrics), server(port) {
 	using namespace std::placeholders;
 
 	// register website pages
@@ -35,10 +37,14 @@ WebserverHandler::WebserverHandler(LSM9DS1Handler *handler, uint16_t port) :
 
 	register_static_handler(HTTP_GET, "/main.css", "text/css", main_css);
 
+	register_static_handler(HTTP_GET, "/settings.js", "text/javascript", settings_js);
+
 	register_static_handler(HTTP_GET, "/recording.js", "text/javascript", recording_js);
 
 	register_static_handler(HTTP_GET, "/calculating.js", "text/javascript", calculating_js);
 
+	register_static_handler(HTTP_GET, "/results.js", "text/javascript", results_js);
+
 	server.onNotFound(on_not_found);
 
 	// register dynamic pages
@@ -62,22 +68,111 @@ WebserverHandler::WebserverHandler(LSM9DS1Handler *handler, uint16_t port) :
 
 	register_url(HTTP_GET, "/calculations.json",
 			bind(&LSM9DS1Handler::sendCalculationsJson, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/summary.json",
+			bind(&LSM9DS1Handler::sendSummaryJson, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/spectrum.json",
+			bind(&LSM9DS1Handler::sendSpectrumJson, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/overview.json",
+			bind(&LSM9DS1Handler::sendOverviewJson, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/fusion_benchmark.json",
+			bind(&LSM9DS1Handler::sendFusionBenchmarkJson, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/persist.json",
+			bind(&LSM9DS1Handler::sendPersistJson, lsm9ds1, _1));
+
+	register_url(HTTP_POST, "/persist.json",
+			bind(&LSM9DS1Handler::persist, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/sessions.json",
+			bind(&LSM9DS1Handler::sendSessionsJson, lsm9ds1, _1));
+
+	register_url(HTTP_DELETE, "/sessions.json",
+			bind(&LSM9DS1Handler::deleteSession, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/events.json",
+			bind(&LSM9DS1Handler::sendEventsJson, lsm9ds1, _1));
+
+	register_url(HTTP_POST, "/events.json",
+			bind(&LSM9DS1Handler::setEventSettings, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/stream.json",
+			bind(&LSM9DS1Handler::sendStreamJson, lsm9ds1, _1));
+
+	register_url(HTTP_POST, "/stream.json",
+			bind(&LSM9DS1Handler::startStream, lsm9ds1, _1));
+
+	register_url(HTTP_DELETE, "/stream.json",
+			bind(&LSM9DS1Handler::stopStream, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/source.json",
+			bind(&LSM9DS1Handler::sendSourceJson, lsm9ds1, _1));
+
+	register_url(HTTP_POST, "/source.json",
+			bind(&LSM9DS1Handler::setSource, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/capabilities.json",
+			bind(&LSM9DS1Handler::sendCapabilitiesJson, lsm9ds1, _1));
+
+	register_url(HTTP_POST, "/capabilities.json",
+			bind(&LSM9DS1Handler::probe, lsm9ds1, _1));
+
+	register_url(HTTP_GET, "/metrics",
+			bind(&Metrics::sendMetrics, metrics, _1));
+
+	register_url(HTTP_GET, "/trace.bin",
+			bind(&WebserverHandler::on_get_trace, this, _1));
 }
 
 void WebserverHandler::register_url(const uint8_t http_code, const char *uri,
 		std::function<void(AsyncWebServerRequest*)> callback) {
-	server.on(uri, http_code, [this, callback](AsyncWebServerRequest *request) {
+	const uint8_t endpoint = metrics->addEndpoint(uri);
+	server.on(uri, http_code, [this, callback, endpoint](AsyncWebServerRequest *request) {
+		metrics->track(request, endpoint);
 		callback(request);
 	});
 }
 
 void WebserverHandler::register_static_handler(const uint8_t http_code,
 		const char *uri, const char *content_type, const char *content) {
-	server.on(uri, http_code, [content_type, content](AsyncWebServerRequest *request) {
+	const uint8_t endpoint = metrics->addEndpoint(uri);
+	server.on(uri, http_code, [this, content_type, content, endpoint](AsyncWebServerRequest *request) {
+		metrics->track(request, endpoint);
+		metrics->addSent(endpoint, strlen(content));
 		request->send_P(200, content_type, content);
 	});
 }
 
+void WebserverHandler::on_get_trace(AsyncWebServerRequest *request) {
+#ifdef ENABLE_TRACE
+	// The ring keeps changing while it is being sent, so a snapshot of it is sent instead.
+	const size_t size = Trace::getDumpSize();
+	std::shared_ptr<uint8_t> dump((uint8_t*) ps_malloc(size), free);
+	if (!dump) {
+		request->send(503, "text/plain", "Not enough free memory for the trace dump.");
+		return;
+	}
+
+	const size_t length = Trace::dump(dump.get(), size, getCpuFrequencyMhz());
+	AsyncWebServerResponse *response = request->beginResponse(
+			"application/octet-stream", length,
+			metrics->countSent(request,
+				[dump, length](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+					const size_t chunk = min(maxLen, length - index);
+					memcpy(buffer, dump.get() + index, chunk);
+					return chunk;
+				}));
+	response->addHeader("Cache-Control", "no-cache");
+	request->send(response);
+#else
+	request->send(404, "text/plain",
+			"Tracing is only available in the esp32dev_profile build.");
+#endif
+}
+
 void WebserverHandler::on_not_found(AsyncWebServerRequest *request) {
 	std::string response = std::string(not_found_html);
 	response = std::regex_replace(response, std::regex("\\$requested"),
@@ -86,64 +181,98 @@ void WebserverHandler::on_not_found(AsyncWebServerRequest *request) {
 }
 
 void WebserverHandler::on_get_index(AsyncWebServerRequest *request) {
-	if (!lsm9ds1->isMeasuring() && lsm9ds1->getStoredMeasurements() == 0) {
-		request->send_P(200, "text/html", settings_html);
-	} else if (lsm9ds1->isMeasuring()) {
+	const std::shared_ptr<const RecordingSession> session =
+			lsm9ds1->getCurrentSession();
+	if (!session
+			|| (session->state == SESSION_READY
+					&& session->samples.getStored() == 0)) {
+		std::string response(settings_html);
+		std::ostringstream converter;
+		converter << lsm9ds1->getMaxMeasurements();
+		response = std::regex_replace(response, std::regex("\\$max_measurements"),
+				converter.str());
+
+		// The max measured rate for each bit mask of the selected sensors, for the settings script.
+		converter.str("");
+		converter.clear();
+		for (uint8_t channels = 0; channels <= CHANNEL_ALL; channels++) {
+			converter << (channels > 0 ? "," : "")
+					<< lsm9ds1->getMaxFrequency(channels);
+		}
+		response = std::regex_replace(response, std::regex("\\$max_rates"),
+				converter.str());
+		send_page(request, response);
+	} else if (session->state == SESSION_RECORDING) {
 		std::string response(recording_html);
 		std::ostringstream converter;
 
-		converter << lsm9ds1->getStoredMeasurements();
+		const RecordingStatus status = lsm9ds1->getRecordingStatus();
+		const bool published = status.session == session->id;
+		const uint32_t stored = published ? status.stored : 0;
+		converter << stored;
 		response = std::regex_replace(response, std::regex("\\$recorded"),
 				converter.str());
 
 		converter.str("");
 		converter.clear();
-		converter << lsm9ds1->getMeasurements();
+		converter << session->measurements;
 		response = std::regex_replace(response, std::regex("\\$recordings"),
 				converter.str());
 
-		const uint32_t eta = (lsm9ds1->getMeasurements()
-				- lsm9ds1->getStoredMeasurements())
-				* lsm9ds1->getMeasuringTime() / 1000;
+		const uint32_t eta = (uint64_t) (session->measurements - stored)
+				* (published ? status.measuring_time : session->measuring_time)
+				/ 1000;
 		response = std::regex_replace(response, std::regex("\\$eta"),
 				format_time(eta));
 
 		response = std::regex_replace(response, std::regex("\\$time"),
-				format_time(millis() - lsm9ds1->getMeasurementStart()));
+				format_time(millis() - session->start));
 
-		request->send(200, "text/html", response.c_str());
-	} else if (lsm9ds1->isCalculating()) {
+		send_page(request, response);
+	} else if (session->state == SESSION_CALCULATING) {
 		std::string response(calculating_html);
 		std::ostringstream converter;
 
-		converter << (uint16_t) lsm9ds1->getFilesCalculated();
+		const CalculationStatus status = lsm9ds1->getCalculationStatus();
+		converter << (uint16_t) status.calculated;
 		response = std::regex_replace(response, std::regex("\\$calculated"),
 				converter.str());
 
 		converter.str("");
 		converter.clear();
-		converter << (uint16_t) lsm9ds1->MEASUREMENT_CSVS;
+		converter << (uint16_t) MEASUREMENT_CSVS;
 		response = std::regex_replace(response, std::regex("\\$files"),
 				converter.str());
 
 		response = std::regex_replace(response, std::regex("\\$file"),
-				lsm9ds1->getFileCalculating());
+				lsm9ds1->MEASUREMENT_CSV_NAMES[status.file]);
 
 		response = std::regex_replace(response, std::regex("\\$time"),
-				format_time(millis() - lsm9ds1->getCalculationStart()));
+				format_time(millis() - status.start));
 
-		request->send(200, "text/html", response.c_str());
+		send_page(request, response);
 	} else {
 		std::string response(results_html);
 		std::ostringstream converter;
 
-		converter << lsm9ds1->getStoredMeasurements();
+		converter << session->samples.getStored();
 		response = std::regex_replace(response, std::regex("\\$measurements"),
 				converter.str());
 		response = std::regex_replace(response, std::regex("\\$time"),
-				format_time(lsm9ds1->getMeasurementDuration()));
-
-		request->send(200, "text/html", response.c_str());
+				format_time(session->duration));
+
+		// Disable the download buttons for files whose sensors weren't recorded.
+		response = std::regex_replace(response, std::regex("\\$lin_acc_state"),
+				session->isRecorded(CHANNEL_ACCELEROMETER | CHANNEL_GYROSCOPE) ?
+						"" : "disabled");
+		response = std::regex_replace(response, std::regex("\\$acc_state"),
+				session->isRecorded(CHANNEL_ACCELEROMETER) ? "" : "disabled");
+		response = std::regex_replace(response, std::regex("\\$gyro_state"),
+				session->isRecorded(CHANNEL_GYROSCOPE) ? "" : "disabled");
+		response = std::regex_replace(response, std::regex("\\$mag_state"),
+				session->isRecorded(CHANNEL_MAGNETOMETER) ? "" : "disabled");
+
+		send_page(request, response);
 	}
 }
 
@@ -153,18 +282,45 @@ void WebserverHandler::on_post_index(AsyncWebServerRequest *request) {
 			&& request->hasParam("rate", true)) {
 		const uint32_t measurements = atoi(request->arg("measurements").c_str());
 		const uint16_t rate = atoi(request->arg("rate").c_str());
-		lsm9ds1->measure(measurements, rate);
+
+		uint8_t channels = 0;
+		if (request->hasParam("accelerometer", true)) {
+			channels |= CHANNEL_ACCELEROMETER;
+		}
+		if (request->hasParam("gyroscope", true)) {
+			channels |= CHANNEL_GYROSCOPE;
+		}
+		if (request->hasParam("magnetometer", true)) {
+			channels |= CHANNEL_MAGNETOMETER;
+		}
+
+		// A recording without any sensor would be pointless.
+		if (channels != 0 && lsm9ds1->isPersisting()) {
+			request->send(409, "text/plain",
+					"A recording is being written to flash, wait until /persist.json reports it as done.");
+			return;
+		} else if (channels != 0
+				&& !lsm9ds1->measure(measurements, rate, channels)) {
+			request->send(507, "text/plain",
+					"Not enough free memory for a new recording, delete a session from /sessions.json first.");
+			return;
+		}
 	}
 
-	if (lsm9ds1->getStoredMeasurements() > 0
-			&& (request->hasParam("back", true)
-					|| request->hasParam("cancel", true))) {
+	// Leaving the results deletes the session, its memory is reclaimed once running downloads are finished.
+	if (request->hasParam("back", true) || request->hasParam("cancel", true)) {
 		lsm9ds1->resetMeasurements();
 	}
 
 	on_get_index(request);
 }
 
+void WebserverHandler::send_page(AsyncWebServerRequest *request,
+		const std::string &page) {
+	metrics->addSent(metrics->getEndpoint(request), page.length());
+	request->send(200, "text/html", page.c_str());
+}
+
 const std::string WebserverHandler::format_time(uint64_t time_ms) {
 	std::ostringstream result;
 	uint8_t printed = 0;
@@ -22,6 +22,7 @@
 #define SRC_WEBSERVERHANDLER_H_
 
 #include "LSM9DS1Handler.h"
+#include "Metrics.h"
 #include <ESPAsyncWebServer.h>
 
 extern const char calculating_html[] asm("_binary_src_html_calculating_html_start");
@@ -31,12 +32,15 @@ extern const char results_html[] asm("_binary_src_html_results_html_start");
 extern const char settings_html[] asm("_binary_src_html_settings_html_start");
 extern const char unavailable_html[] asm("_binary_src_html_unavailable_html_start");
 extern const char main_css[] asm("_binary_src_html_main_css_start");
+extern const char settings_js[] asm("_binary_src_html_settings_js_start");
 extern const char calculating_js[] asm("_binary_src_html_calculating_js_start");
 extern const char recording_js[] asm("_binary_src_html_recording_js_start");
+extern const char results_js[] asm("_binary_src_html_results_js_start");
 
 class WebserverHandler {
 public:
-	WebserverHandler(LSM9DS1Handler *handler, uint16_t port = 80);
+	WebserverHandler(LSM9DS1Handler *handler, Metrics *metrics,
+			uint16_t port = 80);
 	virtual ~WebserverHandler() {
 	}
 
@@ -48,8 +52,16 @@ public:
 	void on_get_index(AsyncWebServerRequest *request);
 	void on_post_index(AsyncWebServerRequest *request);
 
+	/**
+	 * Sends a dump of the trace ring, if this is a profiling build.
+	 *
+	 * @param request	The HTTP web request requesting the trace.
+	 */
+	void on_get_trace(AsyncWebServerRequest *request);
+
 private:
 	LSM9DS1Handler *lsm9ds1;
+	Metrics *metrics;
 	AsyncWebServer server;
 
 	void register_url(const uint8_t http_code, const char *uri,
@@ -67,6 +79,14 @@ private:
 	void register_static_handler(const uint8_t http_code, const char *uri,
 			const char *content_type, const char *content);
 
+	/**
+	 * Sends a filled in html page, and counts its size as sent for the endpoint of the request.
+	 *
+	 * @param request	The HTTP web request to respond to.
+	 * @param page		The html page to send.
+	 */
+	void send_page(AsyncWebServerRequest *request, const std::string &page);
+
 	/**
 	 * Formats the given time in milliseconds as a human readable string.
 	 * The resulting string only contains the two biggest time units which have a non zero value.
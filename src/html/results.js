@@ -0,0 +1,37 @@
+var interval
+var rendered
+
+window.onload = init
+
+function init() {
+	interval = window.setInterval(update, 2000)
+
+	rendered = document.getElementById('rendered')
+
+	update()
+}
+
+function update() {
+	fetch('sessions.json', { method: 'get' })
+		.then((res) => {
+			return res.json();
+		})
+		.then((out) => {
+			var session = out.sessions.find((session) => session.current)
+			if (session === undefined) {
+				window.clearInterval(interval)
+				return
+			}
+
+			rendered.innerText = session.rendered.length > 0 ? session.rendered.join(', ') : 'none yet'
+
+			// Stop once every file that can be downloaded is pre-rendered.
+			var files = document.querySelectorAll('button[formaction$=".csv"]:not([disabled])').length
+			if (session.rendered.length >= files) {
+				window.clearInterval(interval)
+			}
+		})
+		.catch((err) => {
+			throw err
+		})
+}
@@ -0,0 +1,55 @@
+var measurements
+var rate
+var sensors
+var valuesMax
+var maxRates
+
+window.onload = init
+
+function init() {
+	measurements = document.getElementById('measurements')
+	rate = document.getElementById('rate')
+	sensors = [document.getElementById('accelerometer'),
+		document.getElementById('gyroscope'),
+		document.getElementById('magnetometer')]
+
+	// The max measurements in the html are for recordings with all sensors.
+	// Each of those has a timestamp and three values per sensor.
+	valuesMax = Number(measurements.max) * (1 + 3 * sensors.length)
+
+	// The max rates the esp measured for each bit mask of the selected sensors.
+	maxRates = rate.dataset.maxRates.split(',').map(Number)
+
+	for (var sensor of sensors) {
+		sensor.onchange = update
+	}
+	rate.oninput = update
+
+	update()
+}
+
+function update() {
+	var values = 1
+	var channels = 0
+	for (var i = 0; i < sensors.length; i++) {
+		if (sensors[i].checked) {
+			values += 3
+			channels |= 1 << i
+		}
+	}
+
+	measurements.max = Math.floor(valuesMax / values)
+
+	rate.max = maxRates[channels]
+	if (Number(rate.value) > maxRates[channels]) {
+		rate.setCustomValidity('The esp can only read and store ' + maxRates[channels] + ' measurements per second of these sensors.')
+	} else {
+		rate.setCustomValidity('')
+	}
+
+	if (values == 1) {
+		sensors[0].setCustomValidity('At least one sensor has to be recorded.')
+	} else {
+		sensors[0].setCustomValidity('')
+	}
+}
@@ -24,6 +24,9 @@
 #include <SPIFFS.h>
 
 void setup() {
+	// setup and loop run in the same task.
+	metrics.watchTask("loopTask", xTaskGetCurrentTaskHandle());
+
 	Serial.begin(115200);
 	while (!Serial) {
 		delay(10);
@@ -125,12 +128,15 @@ void setupOTA() {
 
 	ArduinoOTA.begin();
 
-	xTaskCreate([](void *params) {
+	TaskHandle_t ota_task;
+	if (xTaskCreate([](void *params) {
 		while (true) {
 			ArduinoOTA.handle();
 			delay(50);
 		}
-	}, "OTA handler", 2500, NULL, 1, NULL);
+	}, "OTA handler", 2500, NULL, 1, &ota_task) == pdPASS) {
+		metrics.watchTask("OTA handler", ota_task);
+	}
 }
 
 void tryConnect() {
@@ -30,13 +30,13 @@ static const IPAddress GATEWAY(192, 168, 2, 1);
 
 static constexpr char HOSTNAME[] = "esp-accelerometer";
 
-static const uint MAX_MEASUREMENTS = 90000; // 90000 measurements * 10 values * 4 bytes per float
+static Metrics metrics;
 
-static LSM9DS1Handler sensorHandler(MAX_MEASUREMENTS);
+static LSM9DS1Handler sensorHandler(&metrics);
 
 static const uint PORT = 80;
 
-static WebserverHandler server(&sensorHandler, PORT);
+static WebserverHandler server(&sensorHandler, &metrics, PORT);
 
 /**
  * The first method called when the ESP starts.
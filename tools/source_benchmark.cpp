@@ -0,0 +1,326 @@
+/*
+ * source_benchmark.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmarks the acquisition and export paths of the firmware on the host, using a synthetic or replayed sensor source.
+ * Feeds the samples through the same sample stream, overview pyramid, and event index as the firmware,
+ * and formats them like the measurement csvs. Prints a checksum of the csv, so runs with the same input can be compared.
+ *
+ * This file only depends on the C++ standard library, see README.md in this directory for how to build it.
+ */
+
+#include "../src/RecordingSession.h"
+#include "../src/ReplaySource.h"
+#include "../src/SyntheticSource.h"
+#include <chrono>
+#include <fstream>
+#include <math.h>
+#include <memory>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * The scales of the ranges the firmware configures the LSM9DS1 with.
+ */
+static const SensorScales SCALES = { 0.061f / 1000 * 9.80665f, 0.00875f
+		* 0.017453292f, 0.14f / 10 };
+
+/**
+ * The column headers of the sensor values in the csvs exported by the firmware, in the order of their channels.
+ */
+static const char *CSV_HEADERS[3] = { "Acceleration X(m/s^2)",
+		"Rotation X(rad/s)", "Magnetic X(uT)" };
+
+/**
+ * The size of the buffer the csv is generated into, like a response chunk of the web server.
+ */
+static const size_t CSV_BUFFER_SIZE = 4096;
+
+/**
+ * The memory all sessions of the benchmark are allocated from.
+ */
+static SlotAllocator allocator;
+
+/**
+ * Creates a session with all the streams and indexes the firmware uses, without a separate magnetometer stream.
+ *
+ * @param id			The id of the new session.
+ * @param channels		The bit mask of the SensorChannels of the session.
+ * @param measurements	The capacity of the session.
+ * @return	The new session, or NULL if it didn't fit into the memory.
+ */
+static std::shared_ptr<RecordingSession> create_session(const uint32_t id,
+		const uint8_t channels, const uint32_t measurements) {
+	uint8_t values = 1;
+	for (uint8_t channel = CHANNEL_ACCELEROMETER; channel <= CHANNEL_MAGNETOMETER;
+			channel <<= 1) {
+		if (channels & channel) {
+			values += 3;
+		}
+	}
+
+	const size_t size = SampleStream::getSize(measurements, values)
+			+ OverviewPyramid::getSize(measurements, values)
+			+ EventIndex::getSize(1024);
+	float *slot = allocator.allocate(size);
+	if (slot == NULL) {
+		return nullptr;
+	}
+
+	std::shared_ptr<RecordingSession> session = std::make_shared<
+			RecordingSession>(id, &allocator, slot, size);
+	session->channels = channels;
+	session->measurements = measurements;
+	session->samples.reset(slot, values, measurements);
+	float *overview = slot + SampleStream::getSize(measurements, values);
+	session->overview.reset(overview, &session->samples);
+	session->events.reset(
+			overview + OverviewPyramid::getSize(measurements, values), 1024,
+			{ { 9.80665f, 5, 0 }, 0.2 });
+	return session;
+}
+
+/**
+ * Loads a measurements csv exported by the firmware, like the all.csv, as a session.
+ * The linear acceleration columns of the all.csv are skipped.
+ *
+ * @param path	The path of the csv to load.
+ * @return	The loaded session, or NULL if loading failed.
+ */
+static std::shared_ptr<RecordingSession> load_csv(const char *path) {
+	std::ifstream file(path);
+	std::string line;
+	if (!file || !std::getline(file, line)) {
+		fprintf(stderr, "Failed to read %s.\n", path);
+		return nullptr;
+	}
+
+	// Find the first column of each recorded sensor.
+	int columns[3] = { -1, -1, -1 };
+	uint8_t channels = 0;
+	std::istringstream header(line);
+	std::string name;
+	for (int column = 0; std::getline(header, name, ','); column++) {
+		for (uint8_t sensor = 0; sensor < 3; sensor++) {
+			if (name == CSV_HEADERS[sensor]) {
+				columns[sensor] = column;
+				channels |= 1 << sensor;
+			}
+		}
+	}
+
+	if (channels == 0) {
+		fprintf(stderr, "%s contains no sensor values.\n", path);
+		return nullptr;
+	}
+
+	std::vector<std::vector<float>> rows;
+	while (std::getline(file, line)) {
+		std::vector<float> row;
+		std::istringstream fields(line);
+		std::string field;
+		while (std::getline(fields, field, ',')) {
+			row.push_back(field.empty() ? NAN : strtof(field.c_str(), NULL));
+		}
+		rows.push_back(row);
+	}
+
+	std::shared_ptr<RecordingSession> session = create_session(1, channels,
+			rows.size());
+	if (!session) {
+		fprintf(stderr, "%s doesn't fit into the memory.\n", path);
+		return nullptr;
+	}
+
+	for (const std::vector<float> &row : rows) {
+		float measurement[10] = { row.empty() ? 0 : row[0] };
+		uint8_t index = 1;
+		for (uint8_t sensor = 0; sensor < 3; sensor++) {
+			if (columns[sensor] >= 0) {
+				for (uint8_t i = 0; i < 3; i++) {
+					const size_t column = columns[sensor] + i;
+					measurement[index++] = column < row.size() ? row[column] : 0;
+				}
+			}
+		}
+		session->samples.append(measurement);
+	}
+
+	const uint32_t stored = session->samples.getStored();
+	if (stored > 1) {
+		session->frequency = round(
+				(stored - 1) * 1000.0
+						/ (session->samples.getTimestamp(stored - 1)
+								- session->samples.getTimestamp(0)));
+	}
+	return session;
+}
+
+/**
+ * Reads measurements from a source into a session, like the reader and storage tasks of the firmware.
+ *
+ * @param source	The source to read.
+ * @param session	The session to store the measurements in.
+ * @param frequency	The measurement frequency, used for the timestamps.
+ */
+static void acquire(SensorSource &source, RecordingSession &session,
+		const uint16_t frequency) {
+	const uint8_t channels = session.channels;
+	source.setDataRate(channels, frequency);
+	int16_t raw[9] = { };
+	float measurement[10];
+	for (uint32_t i = 0; i < session.measurements; i++) {
+		source.read(channels, raw, raw + 3, raw + 6);
+
+		measurement[0] = i * 1000.0f / frequency;
+		uint8_t index = 1;
+		const float scales[3] = { SCALES.accel, SCALES.gyro, SCALES.mag };
+		for (uint8_t sensor = 0; sensor < 3; sensor++) {
+			if (!(channels & (1 << sensor))) {
+				continue;
+			}
+
+			float magnitude = 0;
+			for (uint8_t j = 0; j < 3; j++) {
+				const float value = raw[sensor * 3 + j] * scales[sensor];
+				measurement[index++] = value;
+				magnitude += value * value;
+			}
+
+			magnitude = sqrtf(magnitude);
+			if (sensor == 0) {
+				magnitude = fabsf(magnitude - 9.80665f);
+			}
+			if (session.events.getSettings().thresholds[sensor] > 0) {
+				session.events.update(sensor, i, measurement[0], magnitude);
+			}
+		}
+
+		session.samples.append(measurement);
+		session.overview.update();
+	}
+}
+
+/**
+ * Formats all measurements of a session like the all.csv, without the linear acceleration.
+ *
+ * @param session	The session to export.
+ * @param bytes		A reference to write the size of the csv to.
+ * @return	The FNV-1a hash of the csv.
+ */
+static uint32_t export_csv(const RecordingSession &session, size_t &bytes) {
+	char buffer[CSV_BUFFER_SIZE];
+	const SampleStream &samples = session.samples;
+	const uint8_t values = samples.getStride() - 1;
+	float measurement[10];
+	uint32_t hash = 2166136261u;
+	bytes = 0;
+
+	uint32_t position = 0;
+	while (position < samples.getStored()) {
+		size_t length = 0;
+		while (length < CSV_BUFFER_SIZE - 13 * (values + 1)
+				&& position < samples.getStored()) {
+			length += sprintf(buffer + length, "%d",
+					(uint32_t) samples.getTimestamp(position));
+			samples.getValues(position, 1, values, measurement);
+			for (uint8_t i = 0; i < values; i++) {
+				length += sprintf(buffer + length, ",%f", measurement[i]);
+			}
+			buffer[length++] = '\n';
+			position++;
+		}
+
+		for (size_t i = 0; i < length; i++) {
+			hash = (hash ^ (uint8_t) buffer[i]) * 16777619u;
+		}
+		bytes += length;
+	}
+	return hash;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s synthetic|CSV_FILE [MEASUREMENTS] [RATE]\n",
+				argv[0]);
+		return 1;
+	}
+
+	const uint32_t measurements = argc > 2 ? atol(argv[2]) : 100000;
+	uint16_t frequency = argc > 3 ? atoi(argv[3]) : 952;
+	if (measurements == 0 || frequency == 0) {
+		fprintf(stderr, "The measurements and rate have to be positive.\n");
+		return 1;
+	}
+
+	// Sized like the recording memory of a module with 4 MB PSRAM, plus room for a loaded csv.
+	const size_t memory_size = 8 * 1024 * 1024 / sizeof(float);
+	std::unique_ptr<float[]> memory(new float[memory_size]);
+	allocator.reset(memory.get(), memory_size);
+
+	SyntheticSource synthetic(SCALES);
+	ReplaySource replay(SCALES);
+	SensorSource *source = &synthetic;
+	uint8_t channels = CHANNEL_ALL;
+	if (strcmp(argv[1], "synthetic") != 0) {
+		const std::shared_ptr<RecordingSession> loaded = load_csv(argv[1]);
+		if (!loaded) {
+			return 1;
+		}
+		printf("Loaded %u measurements at %u Hz from %s.\n",
+				loaded->samples.getStored(), loaded->frequency, argv[1]);
+		channels = loaded->channels;
+		replay.setSession(loaded);
+		source = &replay;
+	}
+
+	std::shared_ptr<RecordingSession> session = create_session(2, channels,
+			measurements);
+	if (!session) {
+		fprintf(stderr, "%u measurements don't fit into the memory.\n",
+				measurements);
+		return 1;
+	}
+
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start = clock::now();
+	acquire(*source, *session, frequency);
+	const double acquire_s =
+			std::chrono::duration<double>(clock::now() - start).count();
+
+	start = clock::now();
+	size_t bytes;
+	const uint32_t hash = export_csv(*session, bytes);
+	const double export_s =
+			std::chrono::duration<double>(clock::now() - start).count();
+
+	printf("Acquisition: %u measurements from the %s source in %.1f ms, %.0f measurements/s.\n",
+			measurements, source->getName(), acquire_s * 1000,
+			measurements / acquire_s);
+	printf("Events: %u detected.\n", session->events.getCount());
+	printf("Export: %zu bytes in %.1f ms, %.0f lines/s, %.2f MB/s.\n", bytes,
+			export_s * 1000, measurements / export_s, bytes / export_s / 1e6);
+	printf("Checksum: %08x\n", hash);
+	return 0;
+}
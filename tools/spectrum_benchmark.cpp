@@ -0,0 +1,208 @@
+/*
+ * spectrum_benchmark.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmarks and checks the spectrum calculation of the firmware on the host.
+ * Compares the FFT to a naive DFT of random samples, checks the Welch estimate of a known tone,
+ * and prints how long transforming a segment and estimating a density take.
+ *
+ * This file only depends on the C++ standard library, see README.md in this directory for how to build it.
+ */
+
+#include "../src/Spectrum.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * The max difference between the FFT and the naive DFT, relative to the largest bin.
+ */
+static const double DFT_TOLERANCE = 1e-4;
+
+/**
+ * The max difference between the power of the tone and the integrated density, relative to the power of the tone.
+ */
+static const double POWER_TOLERANCE = 0.02;
+
+/**
+ * The frequency, amplitude, and offset of the test tone.
+ * The frequency isn't centered on a bin, so the window leaks it into its neighbours.
+ */
+static const float TONE_FREQUENCY = 50.3f;
+static const float TONE_AMPLITUDE = 2;
+static const float TONE_OFFSET = 9.80665f;
+
+/**
+ * Calculates the squared magnitude of each frequency bin of the given samples using a naive DFT.
+ *
+ * @param samples	The real samples to transform.
+ * @return	The samples.size() / 2 + 1 squared magnitudes.
+ */
+static std::vector<double> naive_power_spectrum(
+		const std::vector<float> &samples) {
+	const size_t size = samples.size();
+	std::vector<double> power(size / 2 + 1);
+	for (size_t k = 0; k <= size / 2; k++) {
+		double real = 0;
+		double imag = 0;
+		for (size_t i = 0; i < size; i++) {
+			const double angle = -2 * M_PI * ((k * i) % size) / size;
+			real += samples[i] * cos(angle);
+			imag += samples[i] * sin(angle);
+		}
+		power[k] = real * real + imag * imag;
+	}
+	return power;
+}
+
+/**
+ * Compares RealFFT::powerSpectrum to a naive DFT of random samples.
+ *
+ * @param size	The number of samples to transform.
+ * @return	The max difference, relative to the largest bin.
+ */
+static double check_fft(const uint16_t size) {
+	RealFFT fft(size);
+	std::vector<float> samples(size);
+	for (uint16_t i = 0; i < size; i++) {
+		samples[i] = rand() / (float) RAND_MAX * 2 - 1;
+	}
+
+	const std::vector<double> expected = naive_power_spectrum(samples);
+	std::vector<float> power(size / 2 + 1);
+	fft.powerSpectrum(samples.data(), power.data());
+
+	double max = 0;
+	double error = 0;
+	for (uint16_t k = 0; k <= size / 2; k++) {
+		max = fmax(max, expected[k]);
+		error = fmax(error, fabs(power[k] - expected[k]));
+	}
+	return error / max;
+}
+
+/**
+ * Writes a segment of the test tone to the given buffer.
+ *
+ * @param buffer		The buffer to write the segment to.
+ * @param size			The number of samples to write.
+ * @param first			The index of the first sample of the segment.
+ * @param sample_rate	The rate at which the tone is sampled.
+ */
+static void write_tone(float *buffer, const uint16_t size, const uint32_t first,
+		const float sample_rate) {
+	for (uint16_t i = 0; i < size; i++) {
+		buffer[i] = TONE_OFFSET
+				+ TONE_AMPLITUDE
+						* sin(2 * M_PI * TONE_FREQUENCY * (first + i) / sample_rate);
+	}
+}
+
+int main(int argc, char **argv) {
+	const uint16_t size = argc > 1 ? atoi(argv[1]) : 1024;
+	const uint32_t segments = argc > 2 ? atol(argv[2]) : 1000;
+	const float sample_rate = argc > 3 ? atof(argv[3]) : 952;
+	PowerSpectralDensity psd(size);
+	// The tone has to be below the nyquist frequency, and a few bins above DC to be told apart from it.
+	if (!psd.isValid() || segments == 0 || sample_rate <= TONE_FREQUENCY * 2
+			|| TONE_FREQUENCY * size / sample_rate < 2) {
+		fprintf(stderr,
+				"Usage: %s [SEGMENT_SIZE] [SEGMENTS] [RATE]\n"
+						"The segment size has to be a power of two, and large enough to resolve the %.1f Hz test tone.\n"
+						"The rate has to be more than twice the test tone.\n",
+				argv[0], TONE_FREQUENCY);
+		return 1;
+	}
+
+	bool passed = true;
+	const double fft_error = check_fft(size);
+	printf("FFT: max difference to the naive DFT %.2e of the largest bin.\n",
+			fft_error);
+	if (fft_error > DFT_TOLERANCE) {
+		printf("FAILED: The FFT differs from the naive DFT.\n");
+		passed = false;
+	}
+
+	// Welch's method with half overlapping segments, like the firmware.
+	for (uint32_t segment = 0; segment < segments; segment++) {
+		write_tone(psd.getSegmentBuffer(), size, segment * size / 2,
+				sample_rate);
+		psd.addSegment();
+	}
+
+	std::vector<float> density(size / 2 + 1);
+	psd.getDensity(density.data(), sample_rate);
+	uint16_t peak = 0;
+	double power = 0;
+	for (uint16_t k = 0; k <= size / 2; k++) {
+		if (density[k] > density[peak]) {
+			peak = k;
+		}
+		power += density[k] * sample_rate / size;
+	}
+
+	// The offset is removed, so only the power of the sine remains.
+	const uint16_t expected_peak = round(TONE_FREQUENCY * size / sample_rate);
+	const double expected_power = TONE_AMPLITUDE * TONE_AMPLITUDE / 2;
+	printf("Welch: peak at %.2f Hz in bin %u, total power %.4f.\n",
+			peak * sample_rate / size, peak, power);
+	if (peak != expected_peak) {
+		printf("FAILED: Expected the peak in bin %u.\n", expected_peak);
+		passed = false;
+	}
+	if (fabs(power - expected_power) > expected_power * POWER_TOLERANCE) {
+		printf("FAILED: Expected a total power of %.4f.\n", expected_power);
+		passed = false;
+	}
+
+	typedef std::chrono::steady_clock clock;
+	RealFFT fft(size);
+	std::vector<float> samples(size);
+	std::vector<float> spectrum(size / 2 + 1);
+	double fft_s = 0;
+	for (uint32_t segment = 0; segment < segments; segment++) {
+		write_tone(samples.data(), size, segment * size / 2, sample_rate);
+		const clock::time_point start = clock::now();
+		fft.powerSpectrum(samples.data(), spectrum.data());
+		fft_s += std::chrono::duration<double>(clock::now() - start).count();
+	}
+
+	PowerSpectralDensity timed(size);
+	double psd_s = 0;
+	for (uint32_t segment = 0; segment < segments; segment++) {
+		write_tone(timed.getSegmentBuffer(), size, segment * size / 2,
+				sample_rate);
+		const clock::time_point start = clock::now();
+		timed.addSegment();
+		psd_s += std::chrono::duration<double>(clock::now() - start).count();
+	}
+	clock::time_point start = clock::now();
+	timed.getDensity(density.data(), sample_rate);
+	psd_s += std::chrono::duration<double>(clock::now() - start).count();
+
+	printf("RealFFT: %u samples in %.2f us per segment.\n", size,
+			fft_s * 1e6 / segments);
+	printf("PowerSpectralDensity: %u segments of %u samples in %.1f ms, %.2f us per segment.\n",
+			segments, size, psd_s * 1000, psd_s * 1e6 / segments);
+	printf(passed ? "All checks passed.\n" : "Some checks failed.\n");
+	return passed ? 0 : 1;
+}
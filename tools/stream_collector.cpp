@@ -0,0 +1,279 @@
+/*
+ * stream_collector.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The host side collector for the sample stream of /stream.json.
+ * Accepts connections from the device, writes the received samples to a csv file,
+ * and reports the throughput and losses of the stream once per second.
+ *
+ * This file only depends on POSIX, see README.md in this directory for how to build it.
+ */
+
+#include "../src/StreamFrame.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * The statistics of the received stream.
+ */
+struct CollectorStatistics {
+	uint64_t bytes = 0;
+	uint64_t frames = 0;
+	uint64_t samples = 0;
+
+	/**
+	 * The number of frames missing between received frames.
+	 */
+	uint64_t sequence_gaps = 0;
+
+	/**
+	 * The number of samples missing between received frames, including those dropped by the device.
+	 */
+	uint64_t lost_samples = 0;
+
+	/**
+	 * The number of samples the device reported as dropped because its backlog was full.
+	 */
+	uint32_t dropped = 0;
+
+	/**
+	 * The number of frames received twice, because the connection broke while sending them.
+	 */
+	uint64_t duplicates = 0;
+
+	/**
+	 * The number of bytes skipped to find the next frame.
+	 */
+	uint64_t skipped = 0;
+
+	uint32_t connections = 0;
+	uint32_t streams = 0;
+};
+
+static volatile sig_atomic_t stopped = 0;
+
+static void on_signal(int) {
+	stopped = 1;
+}
+
+static double now() {
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**
+ * Handles a single complete frame.
+ *
+ * @param frame		The frame, starting with its header.
+ * @param header	The header of the frame.
+ * @param output	The csv file to write the samples to.
+ * @param stats		The statistics to update.
+ * @param next_sequence	The expected sequence number of the next frame.
+ * @param next_sample	The expected index of the first sample of the next frame.
+ */
+static void handle_frame(const uint8_t *frame, const StreamFrameHeader &header,
+		FILE *output, CollectorStatistics &stats, uint64_t &next_sequence,
+		uint64_t &next_sample) {
+	// A stream restarted on the device starts counting from 0 again, and the collector may join a running stream.
+	if (stats.frames == 0
+			|| (header.sequence == 0 && header.first_sample == 0)) {
+		stats.streams++;
+		next_sequence = header.sequence;
+		next_sample = header.first_sample;
+	}
+
+	if (header.sequence < next_sequence) {
+		stats.duplicates++;
+		return;
+	}
+
+	stats.sequence_gaps += header.sequence - next_sequence;
+	if (header.first_sample > next_sample) {
+		stats.lost_samples += header.first_sample - next_sample;
+	}
+	next_sequence = header.sequence + 1;
+	next_sample = header.first_sample + header.samples;
+	stats.dropped = header.dropped;
+	stats.frames++;
+	stats.samples += header.samples;
+
+	const uint8_t *sample = frame + sizeof(StreamFrameHeader);
+	for (uint16_t i = 0; i < header.samples; i++) {
+		uint32_t offset;
+		memcpy(&offset, sample, sizeof(offset));
+		sample += sizeof(offset);
+		if (output) {
+			fprintf(output, "%llu,%llu",
+					(unsigned long long) (header.first_sample + i),
+					(unsigned long long) (header.start_us + offset));
+		}
+		for (uint8_t j = 0; j < header.values; j++) {
+			float value;
+			memcpy(&value, sample, sizeof(value));
+			sample += sizeof(value);
+			if (output) {
+				fprintf(output, ",%.6g", value);
+			}
+		}
+		if (output) {
+			fputc('\n', output);
+		}
+	}
+}
+
+static void print_statistics(const char *prefix, const CollectorStatistics &stats,
+		const CollectorStatistics &last, const double interval) {
+	printf("%s%.1f kB/s, %.0f frames/s, %.0f samples/s, total %llu samples,"
+			" %llu lost, %u dropped by the device, %llu sequence gaps,"
+			" %llu duplicates, %llu bytes skipped, %u connections\n", prefix,
+			(stats.bytes - last.bytes) / interval / 1000,
+			(stats.frames - last.frames) / interval,
+			(stats.samples - last.samples) / interval,
+			(unsigned long long) stats.samples,
+			(unsigned long long) stats.lost_samples, stats.dropped,
+			(unsigned long long) stats.sequence_gaps,
+			(unsigned long long) stats.duplicates,
+			(unsigned long long) stats.skipped, stats.connections);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s PORT [OUTPUT_CSV]\n", argv[0]);
+		return 1;
+	}
+
+	const int port = atoi(argv[1]);
+	FILE *output = NULL;
+	if (argc > 2) {
+		output = fopen(argv[2], "w");
+		if (!output) {
+			perror("Failed to open the output file");
+			return 1;
+		}
+		fputs("sample,time_us,values...\n", output);
+	}
+
+	const int server = socket(AF_INET, SOCK_STREAM, 0);
+	const int reuse = 1;
+	setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	sockaddr_in address = { };
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(server, (sockaddr*) &address, sizeof(address)) != 0
+			|| listen(server, 1) != 0) {
+		perror("Failed to listen");
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	printf("Listening on port %d.\n", port);
+	fflush(stdout);
+
+	CollectorStatistics stats;
+	CollectorStatistics last;
+	uint64_t next_sequence = 0;
+	uint64_t next_sample = 0;
+	const double start = now();
+	double last_report = start;
+	int client = -1;
+	std::vector<uint8_t> buffer;
+
+	while (!stopped) {
+		pollfd fd = { client >= 0 ? client : server, POLLIN, 0 };
+		poll(&fd, 1, 200);
+
+		if (client < 0 && (fd.revents & POLLIN)) {
+			client = accept(server, NULL, NULL);
+			if (client >= 0) {
+				stats.connections++;
+				// The device sends a frame again if the connection broke while sending it.
+				buffer.clear();
+			}
+		} else if (client >= 0 && (fd.revents & (POLLIN | POLLHUP | POLLERR))) {
+			uint8_t data[16384];
+			const ssize_t received = recv(client, data, sizeof(data), 0);
+			if (received <= 0) {
+				close(client);
+				client = -1;
+			} else {
+				stats.bytes += received;
+				buffer.insert(buffer.end(), data, data + received);
+			}
+
+			size_t position = 0;
+			while (buffer.size() - position >= sizeof(StreamFrameHeader)) {
+				StreamFrameHeader header;
+				memcpy(&header, buffer.data() + position, sizeof(header));
+				if (header.magic != STREAM_FRAME_MAGIC
+						|| header.version != STREAM_FRAME_VERSION
+						|| header.values > StreamFrameWriter::MAX_VALUES
+						|| header.samples > StreamFrameWriter::MAX_SAMPLES) {
+					position++;
+					stats.skipped++;
+					continue;
+				}
+
+				const size_t size = StreamFrameWriter::getFrameSize(
+						header.samples, header.values);
+				if (buffer.size() - position < size) {
+					break;
+				}
+
+				handle_frame(buffer.data() + position, header, output, stats,
+						next_sequence, next_sample);
+				position += size;
+			}
+			buffer.erase(buffer.begin(), buffer.begin() + position);
+		}
+
+		const double time = now();
+		if (time - last_report >= 1) {
+			print_statistics("", stats, last, time - last_report);
+			last = stats;
+			last_report = time;
+		}
+	}
+
+	if (client >= 0) {
+		close(client);
+	}
+	close(server);
+	if (output) {
+		fclose(output);
+	}
+
+	const double duration = now() - start;
+	printf("Summary after %.1f s: ", duration);
+	print_statistics("average ", stats, CollectorStatistics(), duration);
+	return 0;
+}
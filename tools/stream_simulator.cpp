@@ -0,0 +1,179 @@
+/*
+ * stream_simulator.cpp
+ *
+ * Created on: 19.10.2026
+ *
+ * Copyright 2026 ToMe25
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulates the sample stream of the device, to test the stream collector without the hardware.
+ * Uses the same frame writer and backlog as the firmware, with a synthetic sensor producing sine waves.
+ * Stalls of the sender can be simulated to exercise the backlog and its overflow reporting.
+ *
+ * This file only depends on POSIX, see README.md in this directory for how to build it.
+ */
+
+#include "../src/FrameBacklog.h"
+#include "../src/StreamFrame.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static std::atomic<bool> stopped(false);
+
+static void on_signal(int) {
+	stopped = true;
+}
+
+/**
+ * Connects to the collector.
+ *
+ * @param host	The host name or IP address of the collector.
+ * @param port	The port of the collector.
+ * @return	The socket of the connection, or -1 if connecting failed.
+ */
+static int connect_collector(const char *host, const char *port) {
+	addrinfo hints = { };
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo *addresses;
+	if (getaddrinfo(host, port, &hints, &addresses) != 0) {
+		return -1;
+	}
+
+	int connection = -1;
+	for (addrinfo *address = addresses; address; address = address->ai_next) {
+		connection = socket(address->ai_family, address->ai_socktype,
+				address->ai_protocol);
+		if (connection >= 0
+				&& connect(connection, address->ai_addr, address->ai_addrlen)
+						== 0) {
+			break;
+		}
+		if (connection >= 0) {
+			close(connection);
+			connection = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	return connection;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		fprintf(stderr,
+				"Usage: %s HOST PORT [RATE] [SECONDS] [STALL_EVERY_S] [STALL_MS] [BACKLOG_KIB]\n",
+				argv[0]);
+		return 1;
+	}
+
+	const char *host = argv[1];
+	const char *port = argv[2];
+	const uint16_t rate = argc > 3 ? atoi(argv[3]) : 952;
+	const double seconds = argc > 4 ? atof(argv[4]) : 10;
+	const double stall_every = argc > 5 ? atof(argv[5]) : 0;
+	const uint32_t stall_ms = argc > 6 ? atoi(argv[6]) : 0;
+	const size_t backlog_size = (argc > 7 ? atoi(argv[7]) : 768) * 1024;
+
+	signal(SIGINT, on_signal);
+	signal(SIGPIPE, SIG_IGN);
+
+	std::vector<uint8_t> memory(backlog_size);
+	FrameBacklog backlog;
+	backlog.reset(memory.data(), memory.size());
+	StreamFrameWriter writer;
+	// Accelerometer, gyroscope, and magnetometer, like a stream of all channels.
+	writer.reset(&backlog, 7, 9, rate);
+
+	std::atomic<bool> producing(true);
+	std::atomic<uint64_t> sent_bytes(0);
+	std::atomic<uint32_t> connections(0);
+
+	// The sender mirrors the sender task of the firmware, a frame is only consumed once it was written completely.
+	std::thread sender([&]() {
+		uint8_t frame[StreamFrameWriter::MAX_FRAME_SIZE];
+		int connection = -1;
+		auto next_stall = std::chrono::steady_clock::now()
+				+ std::chrono::milliseconds((uint32_t) (stall_every * 1000));
+		while (!stopped && (producing || backlog.getUsed() > 0)) {
+			if (connection < 0) {
+				connection = connect_collector(host, port);
+				if (connection < 0) {
+					std::this_thread::sleep_for(std::chrono::seconds(1));
+					continue;
+				}
+				connections++;
+			}
+
+			if (stall_every > 0 && std::chrono::steady_clock::now() >= next_stall) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(stall_ms));
+				next_stall += std::chrono::milliseconds(
+						(uint32_t) (stall_every * 1000));
+			}
+
+			const size_t size = StreamFrameWriter::peekFrame(backlog, frame);
+			if (size == 0) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				continue;
+			}
+
+			if (send(connection, frame, size, 0) != (ssize_t) size) {
+				close(connection);
+				connection = -1;
+				continue;
+			}
+			backlog.consume(size);
+			sent_bytes += size;
+		}
+		if (connection >= 0) {
+			close(connection);
+		}
+	});
+
+	// The synthetic sensor produces samples at the target rate, and flushes partial frames like the firmware.
+	const auto start = std::chrono::steady_clock::now();
+	const uint64_t interval_us = 1000000 / rate;
+	uint64_t time_us = 0;
+	while (!stopped && time_us < seconds * 1000000) {
+		std::this_thread::sleep_until(start + std::chrono::microseconds(time_us));
+		float values[9];
+		for (uint8_t i = 0; i < 9; i++) {
+			values[i] = sinf(2 * M_PI * (i + 1) * time_us / 1e6f) * (i / 3 + 1);
+		}
+		writer.add(time_us, values);
+		time_us += interval_us;
+	}
+	writer.flush();
+	producing = false;
+	sender.join();
+
+	printf("Produced %llu samples in %u frames, dropped %u samples, sent %llu bytes"
+			" over %u connections, backlog high water %zu of %zu bytes.\n",
+			(unsigned long long) writer.getSamples(), writer.getFrames(),
+			writer.getDropped(), (unsigned long long) sent_bytes.load(),
+			connections.load(), backlog.getHighWater(), backlog.getSize());
+	return 0;
+}
@@ -0,0 +1,99 @@
+#!/usr/bin/python3
+# Turns a trace dump from /trace.bin of the esp32dev_profile build into per span percentiles,
+# and a Chrome trace event file that can be opened in Perfetto, speedscope, or chrome://tracing.
+import json
+import struct
+import sys
+
+HEADER_FORMAT = "<IBBHIII"
+TRACE_DUMP_MAGIC = 0x45435254
+RECORD_FORMAT = "<IIIBBH"
+
+
+def parse_dump(data):
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, version, span_count, record_size, cpu_mhz, record_count, total = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != TRACE_DUMP_MAGIC or version != 1:
+        raise ValueError("Not a trace dump, or an unsupported version.")
+
+    position = header_size
+    names = []
+    for _ in range(span_count):
+        end = data.index(b"\0", position)
+        names.append(data[position:end].decode())
+        position = end + 1
+
+    records = []
+    for _ in range(record_count):
+        start, cycles, task, span, core, _ = struct.unpack_from(RECORD_FORMAT, data, position)
+        records.append((start, cycles, task, span, core))
+        position += record_size
+
+    return names, cpu_mhz, total, records
+
+
+def percentile(values, fraction):
+    index = min(len(values) - 1, int(round(fraction * (len(values) - 1))))
+    return values[index]
+
+
+def print_percentiles(names, cpu_mhz, records):
+    durations = {}
+    for _, cycles, _, span, _ in records:
+        durations.setdefault(span, []).append(cycles / cpu_mhz)
+
+    print("%-20s %8s %10s %10s %10s %10s %10s" % ("span", "count", "mean us", "p50 us", "p90 us", "p99 us", "max us"))
+    for span in sorted(durations):
+        values = sorted(durations[span])
+        name = names[span] if span < len(names) else str(span)
+        print("%-20s %8d %10.2f %10.2f %10.2f %10.2f %10.2f" % (name, len(values), sum(values) / len(values),
+                percentile(values, 0.5), percentile(values, 0.9), percentile(values, 0.99), values[-1]))
+
+
+def write_chrome_trace(names, cpu_mhz, records, path):
+    # Each core has its own 32 bit cycle counter, so the end times are unwrapped per core.
+    # The records are stored in the order they ended in, so the end times of a core only wrap forwards.
+    last_end = {}
+    offset = {}
+    events = []
+    for start, cycles, task, span, core in records:
+        end = (start + cycles) & 0xFFFFFFFF
+        if core in last_end and end < last_end[core] and last_end[core] - end > 0x80000000:
+            offset[core] = offset.get(core, 0) + 0x100000000
+        last_end[core] = end
+        unwrapped_end = end + offset.get(core, 0)
+        events.append({
+            "name": names[span] if span < len(names) else str(span),
+            "ph": "X",
+            "ts": (unwrapped_end - cycles) / cpu_mhz,
+            "dur": cycles / cpu_mhz,
+            "pid": core,
+            "tid": "0x%08x" % task,
+        })
+
+    for core in last_end:
+        events.append({"name": "process_name", "ph": "M", "pid": core, "args": {"name": "core %d" % core}})
+
+    with open(path, "w") as file:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, file)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: %s TRACE_BIN [CHROME_TRACE_JSON]" % sys.argv[0])
+        sys.exit(1)
+
+    with open(sys.argv[1], "rb") as file:
+        data = file.read()
+
+    names, cpu_mhz, total, records = parse_dump(data)
+    print("%d records at %d MHz, %d overwritten." % (len(records), cpu_mhz, total - len(records)))
+    print_percentiles(names, cpu_mhz, records)
+
+    if len(sys.argv) > 2:
+        write_chrome_trace(names, cpu_mhz, records, sys.argv[2])
+        print("Wrote the flame chart to %s." % sys.argv[2])
+
+
+if __name__ == "__main__":
+    main()